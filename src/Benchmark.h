@@ -0,0 +1,302 @@
+#ifndef AISDI_MAPS_BENCHMARK_H
+#define AISDI_MAPS_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "PerfCounters.h"
+
+namespace aisdi
+{
+
+// Summary of repeated runs, in nanoseconds per operation.
+struct BenchmarkStats
+{
+  double median;
+  double min;
+  double mean;
+  double stddev;
+  std::size_t runs;
+};
+
+inline BenchmarkStats summarize(std::vector<double> samples)
+{
+  BenchmarkStats s={0,0,0,0,samples.size()};
+  if(samples.empty())
+  {
+    return s;
+  }
+  std::sort(samples.begin(),samples.end());
+  std::size_t mid=samples.size()/2;
+  s.median=samples.size()%2 ? samples[mid] : (samples[mid-1]+samples[mid])/2;
+  s.min=samples.front();
+  for(double x : samples)
+  {
+    s.mean+=x;
+  }
+  s.mean/=samples.size();
+  for(double x : samples)
+  {
+    s.stddev+=(x-s.mean)*(x-s.mean);
+  }
+  s.stddev=samples.size()>1 ? std::sqrt(s.stddev/(samples.size()-1)) : 0;
+  return s;
+}
+
+struct BenchmarkResult
+{
+  std::string engine;
+  std::string operation;
+  std::size_t size;
+  BenchmarkStats stats;
+  // Empty unless latencies were measured.
+  LatencyHistogram latency;
+  // Per operation; none valid unless counted.
+  PerfSample counters;
+};
+
+// Times a batch of operations repeatedly. Every round first calls prepare()
+// untimed (to build a fresh map, say) and then times body(); the first
+// warmup rounds are discarded. With counters set, hardware events are
+// counted over the same timed bodies.
+class Benchmark
+{
+  std::size_t warmup;
+  std::size_t runs;
+  PerfCounters* counters;
+
+public:
+  using clock = std::chrono::steady_clock;
+
+  Benchmark(std::size_t warmupRounds=1, std::size_t timedRounds=5)
+  : warmup(warmupRounds), runs(timedRounds < 1 ? 1 : timedRounds), counters(nullptr)
+  {}
+
+  // c must outlive the measurements; nullptr stops counting.
+  void setCounters(PerfCounters* c)
+  {
+    counters=c && c->available() ? c : nullptr;
+  }
+
+  // Also gives the mean hardware event counts per operation in perOp.
+  template <typename Prepare, typename Body>
+  BenchmarkStats measure(std::size_t ops, Prepare prepare, Body body, PerfSample& perOp) const
+  {
+    std::vector<double> samples;
+    std::vector<PerfSample> events;
+    for(std::size_t round=0; round<warmup+runs; round++)
+    {
+      prepare();
+      if(counters)
+      {
+        counters->start();
+      }
+      auto start=clock::now();
+      body();
+      auto time=std::chrono::duration<double,std::nano>(clock::now()-start).count();
+      PerfSample sample=counters ? counters->stop() : PerfSample();
+      if(round>=warmup)
+      {
+        samples.push_back(time/(ops ? ops : 1));
+        events.push_back(sample);
+      }
+    }
+    perOp=counters ? PerfSample::perOperation(events,ops) : PerfSample();
+    return summarize(samples);
+  }
+
+  template <typename Prepare, typename Body>
+  BenchmarkStats measure(std::size_t ops, Prepare prepare, Body body) const
+  {
+    PerfSample ignored;
+    return measure(ops,prepare,body,ignored);
+  }
+
+  template <typename Body>
+  BenchmarkStats measure(std::size_t ops, Body body) const
+  {
+    return measure(ops,[](){},body);
+  }
+
+  // Runs one more round with every op(i) timed on its own, for the latency
+  // distribution. The cost of reading the clock is taken off each sample,
+  // but the round is still slower than the ones measure() times.
+  template <typename Prepare, typename Op>
+  LatencyHistogram latencies(std::size_t ops, Prepare prepare, Op op) const
+  {
+    LatencyHistogram histogram;
+    const clock::duration overhead=clockOverhead();
+    prepare();
+    for(std::size_t i=0; i<ops; i++)
+    {
+      auto start=clock::now();
+      op(i);
+      auto time=clock::now()-start;
+      histogram.record(time>overhead ? time-overhead : clock::duration::zero());
+    }
+    return histogram;
+  }
+
+  // Shortest time between two clock reads.
+  static clock::duration clockOverhead()
+  {
+    static const clock::duration overhead=[]()
+    {
+      clock::duration best=clock::duration::max();
+      for(int i=0; i<1000; i++)
+      {
+        auto start=clock::now();
+        auto time=clock::now()-start;
+        best=time<best ? time : best;
+      }
+      return best;
+    }();
+    return overhead;
+  }
+};
+
+// Prints results with the engines side by side for each size and operation.
+inline void printTable(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+  std::vector<std::string> engines;
+  for(const auto& r : results)
+  {
+    if(std::find(engines.begin(),engines.end(),r.engine)==engines.end())
+    {
+      engines.push_back(r.engine);
+    }
+  }
+  os << std::left << std::setw(10) << "size" << std::setw(12) << "operation";
+  for(const auto& e : engines)
+  {
+    os << std::setw(34) << e;
+  }
+  os << "\n" << std::setw(22) << "";
+  for(std::size_t i=0; i<engines.size(); i++)
+  {
+    os << std::setw(34) << "median / min / stddev [ns/op]";
+  }
+  os << "\n";
+
+  std::vector<bool> printed(results.size(),false);
+  for(std::size_t i=0; i<results.size(); i++)
+  {
+    if(printed[i])
+    {
+      continue;
+    }
+    os << std::setw(10) << results[i].size << std::setw(12) << results[i].operation;
+    for(const auto& e : engines)
+    {
+      std::string cell="-";
+      for(std::size_t j=i; j<results.size(); j++)
+      {
+        const BenchmarkResult& r=results[j];
+        if(!printed[j] && r.engine==e && r.size==results[i].size && r.operation==results[i].operation)
+        {
+          std::ostringstream c;
+          c << std::fixed << std::setprecision(1) << r.stats.median << " / " << r.stats.min
+            << " / " << r.stats.stddev;
+          cell=c.str();
+          printed[j]=true;
+          break;
+        }
+      }
+      os << std::setw(34) << cell;
+    }
+    os << "\n";
+  }
+  os << std::right;
+}
+
+// Prints the latency percentiles of the results that have them, one row
+// per size, operation and engine.
+inline void printLatencies(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+  os << std::left << std::setw(10) << "size" << std::setw(12) << "operation" << std::setw(24) << "engine"
+     << std::right;
+  const char* columns[]={"p50", "p90", "p99", "p99.9", "max [ns]"};
+  for(const char* c : columns)
+  {
+    os << std::setw(10) << c;
+  }
+  os << "\n";
+  for(const auto& r : results)
+  {
+    const LatencyHistogram& h=r.latency;
+    if(h.getCount()==0)
+    {
+      continue;
+    }
+    os << std::left << std::setw(10) << r.size << std::setw(12) << r.operation << std::setw(24) << r.engine
+       << std::right << std::setw(10) << h.percentile(50) << std::setw(10) << h.percentile(90)
+       << std::setw(10) << h.percentile(99) << std::setw(10) << h.percentile(99.9)
+       << std::setw(10) << h.getMax() << "\n";
+  }
+}
+
+// Prints the hardware event counts per operation of the results that have
+// them; prints nothing if none has.
+inline void printCounters(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+  bool any=false;
+  for(const auto& r : results)
+  {
+    any=any || r.counters.any();
+  }
+  if(!any)
+  {
+    return;
+  }
+  os << std::left << std::setw(10) << "size" << std::setw(12) << "operation" << std::setw(24) << "engine"
+     << std::right;
+  for(int e=0; e<PerfSample::numOfEvents; e++)
+  {
+    os << std::setw(15) << PerfSample::name(e);
+  }
+  os << std::setw(8) << "IPC" << "   [per op]\n";
+  for(const auto& r : results)
+  {
+    const PerfSample& c=r.counters;
+    if(!c.any())
+    {
+      continue;
+    }
+    os << std::left << std::setw(10) << r.size << std::setw(12) << r.operation << std::setw(24) << r.engine
+       << std::right << std::fixed << std::setprecision(2);
+    for(int e=0; e<PerfSample::numOfEvents; e++)
+    {
+      if(c.valid[e])
+      {
+        os << std::setw(15) << c.values[e];
+      }
+      else
+      {
+        os << std::setw(15) << "-";
+      }
+    }
+    if(c.valid[PerfSample::Cycles] && c.valid[PerfSample::Instructions] && c.values[PerfSample::Cycles]>0)
+    {
+      os << std::setw(8) << c.values[PerfSample::Instructions]/c.values[PerfSample::Cycles];
+    }
+    else
+    {
+      os << std::setw(8) << "-";
+    }
+    os << "\n";
+  }
+  os.unsetf(std::ios::floatfield);
+  os << std::setprecision(6);
+}
+
+}
+
+#endif /* AISDI_MAPS_BENCHMARK_H */
@@ -0,0 +1,481 @@
+#ifndef AISDI_MAPS_BENCHMARKREPORT_H
+#define AISDI_MAPS_BENCHMARKREPORT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace aisdi
+{
+
+// What produced a set of results: the build and the benchmark settings.
+struct RunInfo
+{
+  std::string compiler;
+  bool optimized;
+  std::string timestamp;
+  std::string distribution;
+  std::uint64_t seed;
+  std::size_t warmup;
+  std::size_t runs;
+
+  static RunInfo current(const std::string& distribution, std::uint64_t seed, std::size_t warmup,
+                         std::size_t runs)
+  {
+#if defined(__clang__)
+    std::string compiler="clang "+std::string(__clang_version__);
+#elif defined(__GNUC__)
+    std::string compiler="gcc "+std::string(__VERSION__);
+#else
+    std::string compiler="unknown";
+#endif
+#if defined(__OPTIMIZE__)
+    bool optimized=true;
+#else
+    bool optimized=false;
+#endif
+    char timestamp[32];
+    std::time_t now=std::time(nullptr);
+    std::strftime(timestamp,sizeof(timestamp),"%Y-%m-%dT%H:%M:%SZ",std::gmtime(&now));
+    return RunInfo{compiler,optimized,timestamp,distribution,seed,warmup,runs};
+  }
+};
+
+// One line of a results file, as read back for comparison.
+struct BenchmarkRecord
+{
+  std::string engine;
+  std::string operation;
+  std::size_t size;
+  std::string distribution;
+  BenchmarkStats stats;
+};
+
+namespace report
+{
+
+inline std::string csvField(const std::string& s)
+{
+  if(s.find_first_of(",\"\n")==std::string::npos)
+  {
+    return s;
+  }
+  std::string quoted="\"";
+  for(char c : s)
+  {
+    quoted+=c;
+    if(c=='"')
+    {
+      quoted+='"';
+    }
+  }
+  return quoted+"\"";
+}
+
+inline std::vector<std::string> splitCsvLine(const std::string& line)
+{
+  std::vector<std::string> fields(1);
+  bool quoted=false;
+  for(std::size_t i=0; i<line.size(); i++)
+  {
+    char c=line[i];
+    if(quoted && c=='"' && i+1<line.size() && line[i+1]=='"')
+    {
+      fields.back()+='"';
+      i++;
+    }
+    else if(c=='"')
+    {
+      quoted=!quoted;
+    }
+    else if(c==',' && !quoted)
+    {
+      fields.push_back("");
+    }
+    else if(c!='\r')
+    {
+      fields.back()+=c;
+    }
+  }
+  return fields;
+}
+
+inline std::string jsonString(const std::string& s)
+{
+  std::ostringstream out;
+  out << '"';
+  for(char c : s)
+  {
+    if(c=='"' || c=='\\')
+    {
+      out << '\\' << c;
+    }
+    else if(static_cast<unsigned char>(c)<0x20)
+    {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+          << std::dec << std::setfill(' ');
+    }
+    else
+    {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+inline double parseNumber(const std::string& s)
+{
+  std::istringstream in(s);
+  double x;
+  if(!(in >> x) || !(in >> std::ws).eof())
+  {
+    throw std::runtime_error("Bad number in results file: "+s);
+  }
+  return x;
+}
+
+}
+
+// One row per result, each carrying the run information, so that files
+// can be concatenated. Percentiles and event counts per operation are left
+// empty when not measured.
+inline void writeCsv(std::ostream& os, const RunInfo& info, const std::vector<BenchmarkResult>& results)
+{
+  using report::csvField;
+  os << "engine,operation,size,distribution,median_ns,min_ns,mean_ns,stddev_ns,runs,"
+     << "p50_ns,p99_ns,p999_ns,max_ns,";
+  for(int e=0; e<PerfSample::numOfEvents; e++)
+  {
+    os << PerfSample::name(e) << ',';
+  }
+  os << "seed,warmup,compiler,optimized,timestamp\n";
+  std::ostringstream row;
+  row.precision(std::numeric_limits<double>::digits10);
+  for(const auto& r : results)
+  {
+    row.str("");
+    row << csvField(r.engine) << ',' << csvField(r.operation) << ',' << r.size << ','
+        << csvField(info.distribution) << ',' << r.stats.median << ',' << r.stats.min << ','
+        << r.stats.mean << ',' << r.stats.stddev << ',' << r.stats.runs << ',';
+    const LatencyHistogram& h=r.latency;
+    if(h.getCount()>0)
+    {
+      row << h.percentile(50) << ',' << h.percentile(99) << ',' << h.percentile(99.9) << ',' << h.getMax();
+    }
+    else
+    {
+      row << ",,,";
+    }
+    for(int e=0; e<PerfSample::numOfEvents; e++)
+    {
+      row << ',';
+      if(r.counters.valid[e])
+      {
+        row << r.counters.values[e];
+      }
+    }
+    row << ',' << info.seed << ',' << info.warmup << ',' << csvField(info.compiler) << ','
+        << (info.optimized ? "true" : "false") << ',' << info.timestamp << '\n';
+    os << row.str();
+  }
+}
+
+inline void writeJson(std::ostream& os, const RunInfo& info, const std::vector<BenchmarkResult>& results)
+{
+  using report::jsonString;
+  std::ostringstream out;
+  out.precision(std::numeric_limits<double>::digits10);
+  out << "{\n  \"build\": {\"compiler\": " << jsonString(info.compiler)
+      << ", \"optimized\": " << (info.optimized ? "true" : "false") << "},\n"
+      << "  \"settings\": {\"timestamp\": " << jsonString(info.timestamp)
+      << ", \"distribution\": " << jsonString(info.distribution) << ", \"seed\": " << info.seed
+      << ", \"warmup\": " << info.warmup << ", \"runs\": " << info.runs << "},\n"
+      << "  \"results\": [";
+  for(std::size_t i=0; i<results.size(); i++)
+  {
+    const BenchmarkResult& r=results[i];
+    out << (i ? "," : "") << "\n    {\"engine\": " << jsonString(r.engine)
+        << ", \"operation\": " << jsonString(r.operation) << ", \"size\": " << r.size
+        << ", \"distribution\": " << jsonString(info.distribution)
+        << ", \"median_ns\": " << r.stats.median << ", \"min_ns\": " << r.stats.min
+        << ", \"mean_ns\": " << r.stats.mean << ", \"stddev_ns\": " << r.stats.stddev
+        << ", \"runs\": " << r.stats.runs;
+    const LatencyHistogram& h=r.latency;
+    if(h.getCount()>0)
+    {
+      out << ", \"latency_ns\": {\"p50\": " << h.percentile(50) << ", \"p90\": " << h.percentile(90)
+          << ", \"p99\": " << h.percentile(99) << ", \"p99.9\": " << h.percentile(99.9)
+          << ", \"max\": " << h.getMax() << "}";
+    }
+    if(r.counters.any())
+    {
+      out << ", \"counters_per_op\": {";
+      const char* separator="";
+      for(int e=0; e<PerfSample::numOfEvents; e++)
+      {
+        if(r.counters.valid[e])
+        {
+          out << separator << jsonString(PerfSample::name(e)) << ": " << r.counters.values[e];
+          separator=", ";
+        }
+      }
+      out << "}";
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+  os << out.str();
+}
+
+// Reads what writeCsv() writes; columns are found by name, and repeated
+// header lines (from concatenated files) are skipped.
+inline std::vector<BenchmarkRecord> readCsv(std::istream& is)
+{
+  const char* required[]={"engine", "operation", "size", "distribution", "median_ns", "min_ns",
+                          "mean_ns", "stddev_ns", "runs"};
+  std::vector<BenchmarkRecord> records;
+  std::vector<std::size_t> column;
+  std::string line;
+  while(std::getline(is,line))
+  {
+    if(line.empty() || line=="\r")
+    {
+      continue;
+    }
+    std::vector<std::string> fields=report::splitCsvLine(line);
+    if(fields[0]=="engine")
+    {
+      column.clear();
+      for(const char* name : required)
+      {
+        std::size_t i=0;
+        while(i<fields.size() && fields[i]!=name)
+        {
+          i++;
+        }
+        if(i==fields.size())
+        {
+          throw std::runtime_error("Missing column in results file: "+std::string(name));
+        }
+        column.push_back(i);
+      }
+      continue;
+    }
+    if(column.empty())
+    {
+      throw std::runtime_error("Results file has no header");
+    }
+    for(std::size_t c : column)
+    {
+      if(c>=fields.size())
+      {
+        throw std::runtime_error("Short line in results file: "+line);
+      }
+    }
+    BenchmarkRecord r;
+    r.engine=fields[column[0]];
+    r.operation=fields[column[1]];
+    r.size=static_cast<std::size_t>(report::parseNumber(fields[column[2]]));
+    r.distribution=fields[column[3]];
+    r.stats.median=report::parseNumber(fields[column[4]]);
+    r.stats.min=report::parseNumber(fields[column[5]]);
+    r.stats.mean=report::parseNumber(fields[column[6]]);
+    r.stats.stddev=report::parseNumber(fields[column[7]]);
+    r.stats.runs=static_cast<std::size_t>(report::parseNumber(fields[column[8]]));
+    records.push_back(r);
+  }
+  return records;
+}
+
+// A result present in both files. Every row of the result in a file is
+// pooled, one sample per process that wrote it: the median is the median
+// of the rows' medians, mean and stddev are taken over those medians and
+// runs counts the rows. change is the relative change of the median (0.1
+// is 10% slower). The difference is significant when Welch's t-test on the
+// per-process medians rejects equality (see compareResults()); with fewer
+// than two rows on a side there is no spread between processes to test,
+// and only the threshold decides.
+struct BenchmarkChange
+{
+  BenchmarkRecord baseline;
+  BenchmarkRecord candidate;
+  double change;
+  bool significant;
+  bool regression;
+  bool improvement;
+};
+
+// Whether two rows measure the same thing.
+inline bool sameResult(const BenchmarkRecord& a, const BenchmarkRecord& b)
+{
+  return a.engine==b.engine && a.operation==b.operation && a.size==b.size && a.distribution==b.distribution;
+}
+
+// Regularized incomplete beta function I_x(a, b), by its continued
+// fraction (modified Lentz).
+inline double incompleteBeta(double a, double b, double x)
+{
+  if(x<=0 || x>=1)
+  {
+    return x<=0 ? 0 : 1;
+  }
+  if(x>(a+1)/(a+b+2))
+  {
+    return 1-incompleteBeta(b,a,1-x);
+  }
+  const double tiny=1e-300;
+  double front=std::exp(std::lgamma(a+b)-std::lgamma(a)-std::lgamma(b)+a*std::log(x)+b*std::log(1-x))/a;
+  double c=1, d=1-(a+b)*x/(a+1);
+  d=std::fabs(d)<tiny ? 1/tiny : 1/d;
+  double f=d;
+  for(int m=1; m<200; m++)
+  {
+    for(int odd=0; odd<2; odd++)
+    {
+      double n=odd ? -(a+m)*(a+b+m)*x/((a+2*m)*(a+2*m+1)) : m*(b-m)*x/((a+2*m-1)*(a+2*m));
+      d=1+n*d;
+      d=std::fabs(d)<tiny ? 1/tiny : 1/d;
+      c=1+n/c;
+      c=std::fabs(c)<tiny ? tiny : c;
+      f*=c*d;
+    }
+    if(std::fabs(c*d-1)<1e-12)
+    {
+      break;
+    }
+  }
+  return front*f;
+}
+
+// Two-sided p-value of Welch's t-test on the means; 0 when a side has
+// fewer than two runs, as there is nothing to test.
+inline double welchPValue(const BenchmarkStats& a, const BenchmarkStats& b)
+{
+  if(a.runs<2 || b.runs<2)
+  {
+    return 0;
+  }
+  double va=a.stddev*a.stddev/a.runs;
+  double vb=b.stddev*b.stddev/b.runs;
+  if(va+vb==0)
+  {
+    return a.mean!=b.mean ? 0 : 1;
+  }
+  double t=std::fabs(a.mean-b.mean)/std::sqrt(va+vb);
+  double df=(va+vb)*(va+vb)/(va*va/(a.runs-1)+vb*vb/(b.runs-1));
+  return incompleteBeta(df/2,0.5,df/(df+t*t));
+}
+
+// Every row of records measuring the same as the given one, as one record
+// whose stats are over the rows' medians.
+inline BenchmarkRecord pooledResult(const std::vector<BenchmarkRecord>& records, const BenchmarkRecord& like)
+{
+  BenchmarkRecord pooled=like;
+  pooled.stats.min=std::numeric_limits<double>::infinity();
+  std::vector<double> medians;
+  for(const auto& r : records)
+  {
+    if(sameResult(r,like))
+    {
+      medians.push_back(r.stats.median);
+      pooled.stats.min=std::min(pooled.stats.min,r.stats.min);
+    }
+  }
+  pooled.stats.runs=medians.size();
+  if(medians.empty())
+  {
+    return pooled;
+  }
+  std::sort(medians.begin(),medians.end());
+  std::size_t n=medians.size();
+  pooled.stats.median=n%2 ? medians[n/2] : (medians[n/2-1]+medians[n/2])/2;
+  double sum=0;
+  for(double m : medians)
+  {
+    sum+=m;
+  }
+  pooled.stats.mean=sum/n;
+  double squares=0;
+  for(double m : medians)
+  {
+    squares+=(m-pooled.stats.mean)*(m-pooled.stats.mean);
+  }
+  pooled.stats.stddev=n>1 ? std::sqrt(squares/(n-1)) : 0;
+  return pooled;
+}
+
+// Pairs up results by engine, operation, size and distribution, pooling
+// the rows of each (files of several runs can be concatenated); a change is
+// a regression (or improvement) when it is significant and the median
+// moved by more than threshold, e.g. 0.05 for 5%. Significance is decided
+// by Holm's method over all the results tested, so that comparing many
+// results keeps a 5% chance of flagging any unchanged one.
+inline std::vector<BenchmarkChange> compareResults(const std::vector<BenchmarkRecord>& baseline,
+                                                   const std::vector<BenchmarkRecord>& candidate,
+                                                   double threshold)
+{
+  if(threshold<0)
+  {
+    throw std::invalid_argument("Negative regression threshold");
+  }
+  std::vector<BenchmarkChange> changes;
+  std::vector<std::pair<double, std::size_t>> tested;
+  for(std::size_t i=0; i<baseline.size(); i++)
+  {
+    const BenchmarkRecord& first=baseline[i];
+    bool seen=false;
+    for(std::size_t j=0; j<i && !seen; j++)
+    {
+      seen=sameResult(baseline[j],first);
+    }
+    bool matched=false;
+    for(std::size_t j=0; j<candidate.size() && !matched; j++)
+    {
+      matched=sameResult(candidate[j],first);
+    }
+    if(seen || !matched)
+    {
+      continue;
+    }
+    const BenchmarkRecord b=pooledResult(baseline,first);
+    const BenchmarkRecord c=pooledResult(candidate,first);
+    BenchmarkChange change{b,c,0,true,false,false};
+    change.change=b.stats.median>0 ? c.stats.median/b.stats.median-1 : 0;
+    if(b.stats.runs>=2 && c.stats.runs>=2)
+    {
+      tested.push_back(std::make_pair(welchPValue(b.stats,c.stats),changes.size()));
+    }
+    changes.push_back(change);
+  }
+  std::sort(tested.begin(),tested.end());
+  bool rejecting=true;
+  for(std::size_t k=0; k<tested.size(); k++)
+  {
+    rejecting=rejecting && tested[k].first<=0.05/(tested.size()-k);
+    changes[tested[k].second].significant=rejecting;
+  }
+  for(auto& change : changes)
+  {
+    change.regression=change.significant && change.change>threshold;
+    change.improvement=change.significant && change.change< -threshold;
+  }
+  return changes;
+}
+
+}
+
+#endif /* AISDI_MAPS_BENCHMARKREPORT_H */
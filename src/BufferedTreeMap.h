@@ -0,0 +1,1235 @@
+#ifndef AISDI_MAPS_BUFFEREDTREEMAP_H
+#define AISDI_MAPS_BUFFEREDTREEMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// Write-optimized ordered map (a B-epsilon tree). Entries live in sorted
+// leaves of up to leafCapacity entries; internal nodes have up to fanout
+// children and a buffer of pending messages (upserts and erasures). A blind
+// insert() or erase() only appends a message to the root buffer; a full
+// buffer is flushed one level down in a batch, so a message costs a small
+// fraction of a random descent. Every buffer keeps an index of its messages
+// in key order, so lookups probe each level in O(log bufferCapacity) on the
+// way down, newest message first.
+//
+// Reads through a const map (find(), valueOf(), iteration, getSize()) never
+// change the tree: they see the pending messages where they are. operator[]
+// brings the messages for its key down to the leaf, and a non-const begin()
+// or getSize() applies all of them first, which makes the walk afterwards a
+// plain pass over the leaves. Any change invalidates iterators and
+// references. Nodes are not merged after erasures; empty leaves are dropped.
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class BufferedTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+  // Keys and values are stored apart, so iterators hand out pairs of references.
+  using reference = std::pair<const key_type&, mapped_type&>;
+  using const_reference = std::pair<const key_type&, const mapped_type&>;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const size_type leafCapacity=256;
+  static const size_type fanout=32;
+  static const size_type bufferCapacity=2048;
+  // Messages appended to a buffer since its index was last sorted; probes
+  // scan these few linearly.
+  static const size_type tailCapacity=32;
+
+  struct Message
+  {
+    key_type key;
+    mapped_type value;
+    bool erase;
+  };
+
+  // A leaf holds its entries in keys/values and is chained to its
+  // neighbours. An internal node holds pivots in keys (children[i+1] starts
+  // at keys[i]), its children and its message buffer, oldest first. order
+  // lists the positions in the buffer by key, older first among messages
+  // for the same key; it covers a prefix of the buffer, and the messages
+  // after it (under tailCapacity) are not sorted yet.
+  struct Node
+  {
+    bool leaf;
+    std::vector<key_type> keys;
+    std::vector<mapped_type> values;
+    std::vector<Node*> children;
+    std::vector<Message> buffer;
+    std::vector<size_type> order;
+    Node* prev;
+    Node* next;
+
+    explicit Node(bool isLeaf)
+    : leaf(isLeaf), keys(), values(), children(), buffer(), order(), prev(nullptr), next(nullptr) {}
+  };
+
+  // Where an entry is seen: a leaf slot, or the newest message for its key
+  // in a buffer. node is nullptr past the end.
+  struct Place
+  {
+    Node* node;
+    size_type index;
+    bool buffered;
+  };
+
+  template <typename Ref>
+  struct ArrowProxy
+  {
+    Ref entry;
+
+    const Ref* operator->() const
+    {
+      return &entry;
+    }
+  };
+
+  Node* root;
+  Node* first;
+  Node* last;
+  // Entries in the leaves; messages waiting in buffers.
+  size_type numOfNodes;
+  size_type pending;
+  // Storage reused by batches and by operator[], so that they do not
+  // allocate: a leaf's keys and values are swapped with these while merging
+  // into it.
+  std::vector<key_type> scratchKeys;
+  std::vector<mapped_type> scratchValues;
+  std::vector<size_type> scratchOrder;
+  std::vector<std::pair<Node*, size_type>> scratchPath;
+  std::vector<Message> scratchMessages;
+  Compare comp;
+
+  bool equal(const key_type& a, const key_type& b) const
+  {
+    return !comp(a,b) && !comp(b,a);
+  }
+
+  size_type childIndex(const Node* n, const key_type& key) const
+  {
+    return std::upper_bound(n->keys.begin(),n->keys.end(),key,comp)-n->keys.begin();
+  }
+
+  size_type leafIndex(const Node* n, const key_type& key) const
+  {
+    return std::lower_bound(n->keys.begin(),n->keys.end(),key,comp)-n->keys.begin();
+  }
+
+  static bool overflows(const Node* n)
+  {
+    return n->leaf ? n->keys.size()>leafCapacity : n->children.size()>fanout;
+  }
+
+  // Sorts the positions of the messages appended to n since the last call
+  // into its order.
+  void sortTail(Node* n)
+  {
+    const std::vector<Message>& buf=n->buffer;
+    const size_type mid=n->order.size();
+    if(mid==buf.size())
+    {
+      return;
+    }
+    auto byKey=[this, &buf](size_type a, size_type b)
+    {
+      return comp(buf[a].key,buf[b].key) || (!comp(buf[b].key,buf[a].key) && a<b);
+    };
+    for(size_type p=mid; p<buf.size(); p++)
+    {
+      n->order.push_back(p);
+    }
+    std::sort(n->order.begin()+mid,n->order.end(),byKey);
+    scratchOrder.clear();
+    std::merge(n->order.begin(),n->order.begin()+mid,n->order.begin()+mid,n->order.end(),
+               std::back_inserter(scratchOrder),byKey);
+    n->order.swap(scratchOrder);
+  }
+
+  void limitTail(Node* n)
+  {
+    if(n->buffer.size()-n->order.size()>=tailCapacity)
+    {
+      sortTail(n);
+    }
+  }
+
+  // Position of the newest message for key in the buffer of n, or the size
+  // of the buffer when there is none.
+  size_type newestIn(const Node* n, const key_type& key) const
+  {
+    const std::vector<Message>& buf=n->buffer;
+    for(size_type p=buf.size(); p-->n->order.size();)
+    {
+      if(equal(buf[p].key,key))
+      {
+        return p;
+      }
+    }
+    auto it=std::upper_bound(n->order.begin(),n->order.end(),key,[this, &buf](const key_type& k, size_type p)
+    {
+      return comp(k,buf[p].key);
+    });
+    if(it!=n->order.begin() && !comp(buf[*(it-1)].key,key))
+    {
+      return *(it-1);
+    }
+    return buf.size();
+  }
+
+  // Where the current value of key is; a null place if it is absent.
+  Place resolve(const key_type& key) const
+  {
+    Node* n=root;
+    while(!n->leaf)
+    {
+      size_type p=newestIn(n,key);
+      if(p<n->buffer.size())
+      {
+        return n->buffer[p].erase ? Place{nullptr,0,false} : Place{n,p,true};
+      }
+      n=n->children[childIndex(n,key)];
+    }
+    size_type i=leafIndex(n,key);
+    if(i<n->keys.size() && !comp(key,n->keys[i]))
+    {
+      return Place{n,i,false};
+    }
+    return Place{nullptr,0,false};
+  }
+
+  // Current value of key, read through the pending messages; nullptr when absent.
+  const mapped_type* lookup(const key_type& key) const
+  {
+    Place at=resolve(key);
+    if(at.node==nullptr)
+    {
+      return nullptr;
+    }
+    return at.buffered ? &at.node->buffer[at.index].value : &at.node->values[at.index];
+  }
+
+  // Smallest key above *key (or smallest at all for nullptr) held below n,
+  // in a leaf or a message, whether it is current or not; nullptr if none.
+  const key_type* keyAfter(const Node* n, const key_type* key) const
+  {
+    if(n->leaf)
+    {
+      size_type i=(key!=nullptr ? std::upper_bound(n->keys.begin(),n->keys.end(),*key,comp)-n->keys.begin() : 0);
+      return i<n->keys.size() ? &n->keys[i] : nullptr;
+    }
+    const std::vector<Message>& buf=n->buffer;
+    const key_type* best=nullptr;
+    auto it=n->order.begin();
+    if(key!=nullptr)
+    {
+      it=std::upper_bound(n->order.begin(),n->order.end(),*key,[this, &buf](const key_type& k, size_type p)
+      {
+        return comp(k,buf[p].key);
+      });
+    }
+    if(it!=n->order.end())
+    {
+      best=&buf[*it].key;
+    }
+    for(size_type p=n->order.size(); p<buf.size(); p++)
+    {
+      if((key==nullptr || comp(*key,buf[p].key)) && (best==nullptr || comp(buf[p].key,*best)))
+      {
+        best=&buf[p].key;
+      }
+    }
+    // Children hold disjoint, increasing key ranges: the first one with a
+    // key above *key has the smallest.
+    for(size_type i=(key!=nullptr ? childIndex(n,*key) : 0); i<n->children.size(); i++)
+    {
+      if(best!=nullptr && i>0 && !comp(n->keys[i-1],*best))
+      {
+        break;
+      }
+      const key_type* found=keyAfter(n->children[i],key);
+      if(found!=nullptr)
+      {
+        if(best==nullptr || comp(*found,*best))
+        {
+          best=found;
+        }
+        break;
+      }
+    }
+    return best;
+  }
+
+  // As keyAfter(), for the largest key below *key (largest at all for nullptr).
+  const key_type* keyBefore(const Node* n, const key_type* key) const
+  {
+    if(n->leaf)
+    {
+      size_type i=(key!=nullptr ? leafIndex(n,*key) : n->keys.size());
+      return i>0 ? &n->keys[i-1] : nullptr;
+    }
+    const std::vector<Message>& buf=n->buffer;
+    const key_type* best=nullptr;
+    auto it=n->order.end();
+    if(key!=nullptr)
+    {
+      it=std::lower_bound(n->order.begin(),n->order.end(),*key,[this, &buf](size_type p, const key_type& k)
+      {
+        return comp(buf[p].key,k);
+      });
+    }
+    if(it!=n->order.begin())
+    {
+      best=&buf[*(it-1)].key;
+    }
+    for(size_type p=n->order.size(); p<buf.size(); p++)
+    {
+      if((key==nullptr || comp(buf[p].key,*key)) && (best==nullptr || comp(*best,buf[p].key)))
+      {
+        best=&buf[p].key;
+      }
+    }
+    size_type i=(key!=nullptr ? childIndex(n,*key) : n->children.size()-1);
+    for(size_type j=i+1; j-->0;)
+    {
+      if(best!=nullptr && j<n->keys.size() && !comp(*best,n->keys[j]))
+      {
+        break;
+      }
+      const key_type* found=keyBefore(n->children[j],key);
+      if(found!=nullptr)
+      {
+        if(best==nullptr || comp(*best,*found))
+        {
+          best=found;
+        }
+        break;
+      }
+    }
+    return best;
+  }
+
+  // The first entry after *key (the first of all for nullptr) and the last
+  // one before it, as seen through the pending messages. Keys whose newest
+  // message is an erasure are stepped over.
+  Place placeAfter(const key_type* key) const
+  {
+    for(const key_type* k=keyAfter(root,key); k!=nullptr; k=keyAfter(root,k))
+    {
+      Place at=resolve(*k);
+      if(at.node!=nullptr)
+      {
+        return at;
+      }
+    }
+    return Place{nullptr,0,false};
+  }
+
+  Place placeBefore(const key_type* key) const
+  {
+    for(const key_type* k=keyBefore(root,key); k!=nullptr; k=keyBefore(root,k))
+    {
+      Place at=resolve(*k);
+      if(at.node!=nullptr)
+      {
+        return at;
+      }
+    }
+    return Place{nullptr,0,false};
+  }
+
+  void applyOne(Node* leaf, Message&& m)
+  {
+    size_type i=leafIndex(leaf,m.key);
+    bool present=i<leaf->keys.size() && !comp(m.key,leaf->keys[i]);
+    if(m.erase)
+    {
+      if(present)
+      {
+        leaf->keys.erase(leaf->keys.begin()+i);
+        leaf->values.erase(leaf->values.begin()+i);
+        numOfNodes--;
+      }
+    }
+    else if(present)
+    {
+      leaf->values[i]=std::move(m.value);
+    }
+    else
+    {
+      leaf->keys.insert(leaf->keys.begin()+i,std::move(m.key));
+      leaf->values.insert(leaf->values.begin()+i,std::move(m.value));
+      numOfNodes++;
+    }
+  }
+
+  // Merges msgs[b, e), sorted with one message per key, into the leaf.
+  void applyBatch(Node* leaf, std::vector<Message>& msgs, size_type b, size_type e)
+  {
+    std::vector<key_type>& keys=scratchKeys;
+    std::vector<mapped_type>& values=scratchValues;
+    keys.clear();
+    values.clear();
+    keys.reserve(leaf->keys.size()+(e-b));
+    values.reserve(leaf->keys.size()+(e-b));
+    size_type i=0;
+    for(size_type j=b; j<e; j++)
+    {
+      Message& m=msgs[j];
+      for(; i<leaf->keys.size() && comp(leaf->keys[i],m.key); i++)
+      {
+        keys.push_back(std::move(leaf->keys[i]));
+        values.push_back(std::move(leaf->values[i]));
+      }
+      if(i<leaf->keys.size() && !comp(m.key,leaf->keys[i]))
+      {
+        i++;
+        numOfNodes--;
+      }
+      if(!m.erase)
+      {
+        keys.push_back(std::move(m.key));
+        values.push_back(std::move(m.value));
+        numOfNodes++;
+      }
+    }
+    for(; i<leaf->keys.size(); i++)
+    {
+      keys.push_back(std::move(leaf->keys[i]));
+      values.push_back(std::move(leaf->values[i]));
+    }
+    leaf->keys.swap(keys);
+    leaf->values.swap(values);
+    pending-=e-b;
+  }
+
+  // Moves the whole buffer of n one level down: into the leaves, or into
+  // the child buffers, flushing those that fill up in turn. The index gives
+  // the messages in key order; only the newest one for each key goes on.
+  void flush(Node* n)
+  {
+    sortTail(n);
+    std::vector<Message> msgs;
+    msgs.reserve(n->order.size());
+    for(size_type k=0; k<n->order.size(); k++)
+    {
+      Message& m=n->buffer[n->order[k]];
+      if(k+1<n->order.size() && !comp(m.key,n->buffer[n->order[k+1]].key))
+      {
+        pending--;
+        continue;
+      }
+      msgs.push_back(std::move(m));
+    }
+    n->buffer.clear();
+    n->order.clear();
+    std::vector<size_type> bounds(1,0);
+    size_type e=0;
+    for(size_type i=0; i+1<n->children.size(); i++)
+    {
+      while(e<msgs.size() && comp(msgs[e].key,n->keys[i]))
+      {
+        e++;
+      }
+      bounds.push_back(e);
+    }
+    bounds.push_back(msgs.size());
+    for(size_type i=n->children.size(); i-->0;)
+    {
+      if(bounds[i]==bounds[i+1])
+      {
+        continue;
+      }
+      Node* c=n->children[i];
+      if(c->leaf)
+      {
+        applyBatch(c,msgs,bounds[i],bounds[i+1]);
+      }
+      else
+      {
+        for(size_type j=bounds[i]; j<bounds[i+1]; j++)
+        {
+          c->buffer.push_back(std::move(msgs[j]));
+        }
+        limitTail(c);
+        if(c->buffer.size()>=bufferCapacity)
+        {
+          flush(c);
+        }
+      }
+      fixChild(n,i);
+    }
+  }
+
+  // Applies every pending message below n.
+  void drain(Node* n)
+  {
+    if(n->leaf)
+    {
+      return;
+    }
+    if(!n->buffer.empty())
+    {
+      flush(n);
+    }
+    for(size_type i=n->children.size(); i-->0;)
+    {
+      drain(n->children[i]);
+      fixChild(n,i);
+    }
+  }
+
+  void flushAll()
+  {
+    if(pending>0)
+    {
+      drain(root);
+      growRoot();
+    }
+  }
+
+  // Restores the limits of the i-th child of p after it changed: drops it
+  // if it is an empty leaf with siblings, and splits it into evenly filled
+  // nodes if it overflows.
+  void fixChild(Node* p, size_type i)
+  {
+    Node* c=p->children[i];
+    if(c->leaf && c->keys.empty() && p->children.size()>1)
+    {
+      unlinkLeaf(c);
+      delete c;
+      p->children.erase(p->children.begin()+i);
+      p->keys.erase(p->keys.begin()+(i>0 ? i-1 : 0));
+      return;
+    }
+    if(!overflows(c))
+    {
+      return;
+    }
+    const size_type n=(c->leaf ? c->keys.size() : c->children.size());
+    const size_type cap=(c->leaf ? leafCapacity : fanout);
+    const size_type pieces=(n+cap-1)/cap;
+    std::vector<Node*> parts;
+    std::vector<key_type> seps;
+    for(size_type k=1; k<pieces; k++)
+    {
+      const size_type from=n*k/pieces;
+      const size_type to=n*(k+1)/pieces;
+      Node* part=new Node(c->leaf);
+      if(c->leaf)
+      {
+        seps.push_back(c->keys[from]);
+        part->keys.assign(std::make_move_iterator(c->keys.begin()+from),
+                          std::make_move_iterator(c->keys.begin()+to));
+        part->values.assign(std::make_move_iterator(c->values.begin()+from),
+                            std::make_move_iterator(c->values.begin()+to));
+      }
+      else
+      {
+        seps.push_back(c->keys[from-1]);
+        part->children.assign(c->children.begin()+from,c->children.begin()+to);
+        part->keys.assign(std::make_move_iterator(c->keys.begin()+from),
+                          std::make_move_iterator(c->keys.begin()+(to-1)));
+      }
+      parts.push_back(part);
+    }
+    const size_type keep=n/pieces;
+    if(c->leaf)
+    {
+      c->keys.erase(c->keys.begin()+keep,c->keys.end());
+      c->values.erase(c->values.begin()+keep,c->values.end());
+      Node* prevLeaf=c;
+      for(Node* part : parts)
+      {
+        part->prev=prevLeaf;
+        part->next=prevLeaf->next;
+        if(prevLeaf->next!=nullptr)
+        {
+          prevLeaf->next->prev=part;
+        }
+        else
+        {
+          last=part;
+        }
+        prevLeaf->next=part;
+        prevLeaf=part;
+      }
+    }
+    else
+    {
+      c->children.erase(c->children.begin()+keep,c->children.end());
+      c->keys.erase(c->keys.begin()+(keep-1),c->keys.end());
+      std::vector<Message> stay;
+      for(Message& m : c->buffer)
+      {
+        size_type k=std::upper_bound(seps.begin(),seps.end(),m.key,comp)-seps.begin();
+        (k==0 ? stay : parts[k-1]->buffer).push_back(std::move(m));
+      }
+      c->buffer.swap(stay);
+      c->order.clear();
+      sortTail(c);
+      for(Node* part : parts)
+      {
+        sortTail(part);
+      }
+    }
+    p->children.insert(p->children.begin()+(i+1),parts.begin(),parts.end());
+    p->keys.insert(p->keys.begin()+i,seps.begin(),seps.end());
+  }
+
+  // Adds levels above an overflowing root and drops internal roots left
+  // with a single child and nothing pending.
+  void growRoot()
+  {
+    while(overflows(root))
+    {
+      Node* r=new Node(false);
+      r->children.push_back(root);
+      root=r;
+      fixChild(r,0);
+    }
+    while(!root->leaf && root->children.size()==1 && root->buffer.empty())
+    {
+      Node* c=root->children.front();
+      delete root;
+      root=c;
+    }
+  }
+
+  void unlinkLeaf(Node* n)
+  {
+    if(n->prev!=nullptr)
+    {
+      n->prev->next=n->next;
+    }
+    else
+    {
+      first=n->next;
+    }
+    if(n->next!=nullptr)
+    {
+      n->next->prev=n->prev;
+    }
+    else
+    {
+      last=n->prev;
+    }
+  }
+
+  Node* leafFor(const key_type& key) const
+  {
+    Node* n=root;
+    while(!n->leaf)
+    {
+      n=n->children[childIndex(n,key)];
+    }
+    return n;
+  }
+
+  // Drops every message for key from the buffer of n, keeping the order
+  // of the rest; the newest one is moved to scratchMessages if that is
+  // still empty.
+  void takeMessages(Node* n, const key_type& key, size_type newest)
+  {
+    std::vector<Message>& buf=n->buffer;
+    std::vector<size_type>& moved=scratchOrder;
+    const size_type dropped=buf.size();
+    moved.assign(buf.size(),dropped);
+    size_type kept=0;
+    for(size_type j=0; j<buf.size(); j++)
+    {
+      if(j==newest || equal(buf[j].key,key))
+      {
+        if(j==newest && scratchMessages.empty())
+        {
+          scratchMessages.push_back(std::move(buf[j]));
+        }
+        pending--;
+        continue;
+      }
+      if(kept!=j)
+      {
+        buf[kept]=std::move(buf[j]);
+      }
+      moved[j]=kept++;
+    }
+    buf.erase(buf.begin()+kept,buf.end());
+    size_type out=0;
+    for(size_type p : n->order)
+    {
+      if(moved[p]!=dropped)
+      {
+        n->order[out++]=moved[p];
+      }
+    }
+    n->order.resize(out);
+  }
+
+  // Brings the newest pending message for key down to its leaf and drops
+  // the older ones, so that the leaf holds the current state of the key;
+  // with create, an absent key is added with a default value. Returns the
+  // leaf the key belongs to.
+  Node* settle(const key_type& key, bool create)
+  {
+    scratchPath.clear();
+    scratchMessages.clear();
+    Node* n=root;
+    while(!n->leaf)
+    {
+      size_type newest=newestIn(n,key);
+      if(newest<n->buffer.size())
+      {
+        takeMessages(n,key,newest);
+      }
+      size_type i=childIndex(n,key);
+      scratchPath.push_back(std::make_pair(n,i));
+      n=n->children[i];
+    }
+    if(!scratchMessages.empty())
+    {
+      applyOne(n,std::move(scratchMessages.front()));
+      scratchMessages.clear();
+    }
+    if(create)
+    {
+      size_type i=leafIndex(n,key);
+      if(i==n->keys.size() || comp(key,n->keys[i]))
+      {
+        n->keys.insert(n->keys.begin()+i,key);
+        n->values.insert(n->values.begin()+i,mapped_type());
+        numOfNodes++;
+      }
+    }
+    for(auto it=scratchPath.rbegin(); it!=scratchPath.rend(); ++it)
+    {
+      fixChild(it->first,it->second);
+    }
+    growRoot();
+    return leafFor(key);
+  }
+
+  void push(Message&& m)
+  {
+    if(root->leaf)
+    {
+      applyOne(root,std::move(m));
+      growRoot();
+      return;
+    }
+    root->buffer.push_back(std::move(m));
+    pending++;
+    limitTail(root);
+    if(root->buffer.size()>=bufferCapacity)
+    {
+      flush(root);
+      growRoot();
+    }
+  }
+
+  Node* cloneNode(const Node* src, Node*& tail)
+  {
+    Node* n=new Node(src->leaf);
+    n->keys=src->keys;
+    n->values=src->values;
+    n->buffer=src->buffer;
+    n->order=src->order;
+    if(src->leaf)
+    {
+      n->prev=tail;
+      if(tail!=nullptr)
+      {
+        tail->next=n;
+      }
+      else
+      {
+        first=n;
+      }
+      tail=n;
+    }
+    for(const Node* child : src->children)
+    {
+      n->children.push_back(cloneNode(child,tail));
+    }
+    return n;
+  }
+
+  static void deleteNodes(Node* n)
+  {
+    for(Node* child : n->children)
+    {
+      deleteNodes(child);
+    }
+    delete n;
+  }
+
+  void reset()
+  {
+    root=new Node(true);
+    first=root;
+    last=root;
+    numOfNodes=0;
+    pending=0;
+  }
+
+  void swapWith(BufferedTreeMap& other)
+  {
+    std::swap(root,other.root);
+    std::swap(first,other.first);
+    std::swap(last,other.last);
+    std::swap(numOfNodes,other.numOfNodes);
+    std::swap(pending,other.pending);
+    std::swap(comp,other.comp);
+  }
+
+public:
+  BufferedTreeMap()
+  : BufferedTreeMap(Compare())
+  {}
+
+  explicit BufferedTreeMap(const Compare& c)
+  : root(nullptr), first(nullptr), last(nullptr), numOfNodes(0), pending(0),
+    scratchKeys(), scratchValues(), scratchOrder(), scratchPath(), scratchMessages(), comp(c)
+  {
+    reset();
+  }
+
+  BufferedTreeMap(std::initializer_list<value_type> list)
+  : BufferedTreeMap()
+  {
+    for(auto it=list.begin(); it!=list.end(); it++)
+    {
+      insert(it->first,it->second);
+    }
+  }
+
+  BufferedTreeMap(const BufferedTreeMap& other)
+  : root(nullptr), first(nullptr), last(nullptr), numOfNodes(other.numOfNodes),
+    pending(other.pending), scratchKeys(), scratchValues(), scratchOrder(), scratchPath(),
+    scratchMessages(), comp(other.comp)
+  {
+    Node* tail=nullptr;
+    root=cloneNode(other.root,tail);
+    last=tail;
+  }
+
+  BufferedTreeMap(BufferedTreeMap&& other)
+  : root(other.root), first(other.first), last(other.last), numOfNodes(other.numOfNodes),
+    pending(other.pending), scratchKeys(), scratchValues(), scratchOrder(), scratchPath(),
+    scratchMessages(), comp(other.comp)
+  {
+    other.reset();
+  }
+
+  ~BufferedTreeMap()
+  {
+    deleteNodes(root);
+  }
+
+  BufferedTreeMap& operator=(const BufferedTreeMap& other)
+  {
+    if(this!=&other)
+    {
+      BufferedTreeMap copy(other);
+      swapWith(copy);
+    }
+    return *this;
+  }
+
+  BufferedTreeMap& operator=(BufferedTreeMap&& other)
+  {
+    if(this!=&other)
+    {
+      swapWith(other);
+    }
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return pending==0 ? numOfNodes==0 : cbegin()==cend();
+  }
+
+  // Sets the value of key, adding it if needed, without looking it up.
+  void insert(const key_type& key, const mapped_type& value)
+  {
+    push(Message{key,value,false});
+  }
+
+  // Removes key if present, without looking it up.
+  void erase(const key_type& key)
+  {
+    push(Message{key,mapped_type(),true});
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    Node* leaf=settle(key,true);
+    return leaf->values[leafIndex(leaf,key)];
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(root->leaf && root->keys.empty())
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    const mapped_type* value=lookup(key);
+    if(value==nullptr)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return *value;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    auto it=find(key);
+    if(it==end())
+    {
+      throw std::out_of_range("No such key");
+    }
+    return it->second;
+  }
+
+  // The entry may still be a pending message; its value can be changed in
+  // place all the same.
+  const_iterator find(const key_type& key) const
+  {
+    Place at=resolve(key);
+    return ConstIterator(this,at.node,at.index,at.buffered);
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(static_cast<const BufferedTreeMap*>(this)->find(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    if(lookup(key)==nullptr)
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    erase(key);
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it==cend())
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    key_type key=it->first;
+    erase(key);
+  }
+
+  // O(1) with nothing pending; otherwise a const map counts its entries
+  // through the buffers, while a non-const one applies the messages first.
+  size_type getSize() const
+  {
+    if(pending==0)
+    {
+      return numOfNodes;
+    }
+    size_type counted=0;
+    for(auto it=cbegin(); it!=cend(); ++it)
+    {
+      counted++;
+    }
+    return counted;
+  }
+
+  size_type getSize()
+  {
+    flushAll();
+    return numOfNodes;
+  }
+
+  bool operator==(const BufferedTreeMap& other) const
+  {
+    if(getSize()!=other.getSize())
+    {
+      return false;
+    }
+    for(auto it=begin(), otherIt=other.begin(); it!=end(); ++it, ++otherIt)
+    {
+      if(comp(it->first,otherIt->first) || comp(otherIt->first,it->first)
+         || it->second!=otherIt->second)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const BufferedTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    flushAll();
+    return Iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return Iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    if(pending>0)
+    {
+      Place at=placeAfter(nullptr);
+      return ConstIterator(this,at.node,at.index,at.buffered);
+    }
+    Node* leaf=first;
+    while(leaf!=nullptr && leaf->keys.empty())
+    {
+      leaf=leaf->next;
+    }
+    return ConstIterator(this,leaf,0);
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this,nullptr,0);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename BufferedTreeMap<KeyType, ValueType, Compare>::size_type
+BufferedTreeMap<KeyType, ValueType, Compare>::leafCapacity;
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename BufferedTreeMap<KeyType, ValueType, Compare>::size_type
+BufferedTreeMap<KeyType, ValueType, Compare>::fanout;
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename BufferedTreeMap<KeyType, ValueType, Compare>::size_type
+BufferedTreeMap<KeyType, ValueType, Compare>::bufferCapacity;
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename BufferedTreeMap<KeyType, ValueType, Compare>::size_type
+BufferedTreeMap<KeyType, ValueType, Compare>::tailCapacity;
+
+// Points at a leaf slot or, while messages are pending, possibly at the
+// message that makes an entry current. Stepping is a walk along the leaves
+// while the tree has nothing pending, and a search through the buffers
+// otherwise.
+template <typename KeyType, typename ValueType, typename Compare>
+class BufferedTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+  friend class BufferedTreeMap;
+
+protected:
+  const BufferedTreeMap* treePtr;
+  Node* nodePtr;
+  size_type index;
+  bool buffered;
+
+  const key_type& key() const
+  {
+    return buffered ? nodePtr->buffer[index].key : nodePtr->keys[index];
+  }
+
+  mapped_type& value() const
+  {
+    return buffered ? nodePtr->buffer[index].value : nodePtr->values[index];
+  }
+
+  void moveTo(const Place& at)
+  {
+    nodePtr=at.node;
+    index=at.index;
+    buffered=at.buffered;
+  }
+
+public:
+  using reference = typename BufferedTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename BufferedTreeMap::value_type;
+  using pointer = ArrowProxy<reference>;
+
+  explicit ConstIterator(const BufferedTreeMap* t, Node* node, size_type i, bool inBuffer=false)
+  : treePtr(t), nodePtr(node), index(i), buffered(inBuffer)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(nodePtr==nullptr)
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    if(treePtr->pending>0 || buffered)
+    {
+      moveTo(treePtr->placeAfter(&key()));
+      return *this;
+    }
+    if(++index==nodePtr->keys.size())
+    {
+      index=0;
+      do
+      {
+        nodePtr=nodePtr->next;
+      } while(nodePtr!=nullptr && nodePtr->keys.empty());
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(treePtr->pending>0 || buffered)
+    {
+      Place at=treePtr->placeBefore(nodePtr!=nullptr ? &key() : nullptr);
+      if(at.node==nullptr)
+      {
+        throw std::out_of_range("Cannot decrement");
+      }
+      moveTo(at);
+      return *this;
+    }
+    if(nodePtr!=nullptr && index>0)
+    {
+      index--;
+      return *this;
+    }
+    Node* leaf=(nodePtr!=nullptr ? nodePtr->prev : treePtr->last);
+    while(leaf!=nullptr && leaf->keys.empty())
+    {
+      leaf=leaf->prev;
+    }
+    if(leaf==nullptr)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    nodePtr=leaf;
+    index=leaf->keys.size()-1;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(nodePtr==nullptr)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return reference(key(),value());
+  }
+
+  pointer operator->() const
+  {
+    return pointer{this->operator*()};
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return treePtr==other.treePtr && nodePtr==other.nodePtr && index==other.index
+           && buffered==other.buffered;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class BufferedTreeMap<KeyType, ValueType, Compare>::Iterator
+  : public BufferedTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename BufferedTreeMap::reference;
+  using pointer = ArrowProxy<reference>;
+
+  Iterator(const ConstIterator& other)
+  : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  reference operator*() const
+  {
+    if(this->nodePtr==nullptr)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return reference(this->key(),this->value());
+  }
+
+  pointer operator->() const
+  {
+    return pointer{this->operator*()};
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_BUFFEREDTREEMAP_H */
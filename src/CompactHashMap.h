@@ -0,0 +1,560 @@
+#ifndef AISDI_MAPS_COMPACTHASHMAP_H
+#define AISDI_MAPS_COMPACTHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// HashMap with a compact layout: entries live in one contiguous arena, the
+// buckets and the chains hold 32-bit indices into it, and chains are singly
+// linked (a chain is short, so the rare step back walks it from the head).
+// An entry costs the pair plus a 4-byte link and a flag, and a bucket 4
+// bytes, with no per-entry allocation; the map holds up to 2^32-1 entries.
+//
+// Removed slots are kept on a free list and reused. Iterators stay valid
+// until their entry is removed, but like std::vector the arena may move
+// when it grows, so a reference to a value is invalidated by inserting.
+template <typename KeyType, typename ValueType>
+class CompactHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using index_type = std::uint32_t;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const index_type nil=static_cast<index_type>(-1);
+
+  // The entry lives in raw storage inside the node: a node itself is never
+  // rebuilt, so the arena's elements stay valid while the entry in a freed
+  // slot is destroyed and a new one constructed there.
+  struct Node
+  {
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+    index_type next;
+    bool live;
+
+    Node(const key_type& k, mapped_type&& m)
+    : storage(), next(nil), live(false)
+    {
+      emplace(k,std::move(m));
+    }
+
+    Node(const Node& other)
+    : storage(), next(other.next), live(false)
+    {
+      if(other.live)
+      {
+        new (&storage) value_type(other.data());
+        live=true;
+      }
+    }
+
+    Node(Node&& other) noexcept(std::is_nothrow_move_constructible<value_type>::value)
+    : storage(), next(other.next), live(false)
+    {
+      if(other.live)
+      {
+        new (&storage) value_type(std::move(other.data()));
+        live=true;
+      }
+    }
+
+    Node& operator=(const Node&) = delete;
+
+    ~Node()
+    {
+      destroy();
+    }
+
+    void emplace(const key_type& k, mapped_type&& m)
+    {
+      new (&storage) value_type(k,std::move(m));
+      live=true;
+    }
+
+    void destroy()
+    {
+      if(live)
+      {
+        live=false;
+        data().~value_type();
+      }
+    }
+
+    value_type& data()
+    {
+      return *reinterpret_cast<value_type*>(&storage);
+    }
+
+    const value_type& data() const
+    {
+      return *reinterpret_cast<const value_type*>(&storage);
+    }
+  };
+
+  std::vector<index_type> table;
+  std::vector<Node> arena;
+  // Freed slots, chained through their next links.
+  index_type freeList;
+  size_type numOfNodes;
+
+  size_type bucketOf(const key_type& key) const
+  {
+    return key%table.size();
+  }
+
+  index_type allocate(const key_type& key, mapped_type&& value)
+  {
+    if(freeList!=nil)
+    {
+      index_type i=freeList;
+      arena[i].emplace(key,std::move(value));
+      freeList=arena[i].next;
+      return i;
+    }
+    if(arena.size()>=static_cast<size_type>(nil))
+    {
+      throw std::length_error("CompactHashMap is full");
+    }
+    arena.emplace_back(key,std::move(value));
+    return static_cast<index_type>(arena.size()-1);
+  }
+
+  index_type findNode(const key_type& key) const
+  {
+    if(table.empty())
+    {
+      return nil;
+    }
+    index_type i=table[bucketOf(key)];
+    while(i!=nil && !(arena[i].data().first==key))
+    {
+      i=arena[i].next;
+    }
+    return i;
+  }
+
+  void removeNode(index_type remNode)
+  {
+    index_type* link=&table[bucketOf(arena[remNode].data().first)];
+    while(*link!=remNode)
+    {
+      link=&arena[*link].next;
+    }
+    *link=arena[remNode].next;
+    arena[remNode].destroy();
+    arena[remNode].next=freeList;
+    freeList=remNode;
+    numOfNodes--;
+    if(numOfNodes==0)
+    {
+      arena.clear();
+      freeList=nil;
+    }
+  }
+
+  // First entry in bucket b or a later one; nil with b==table size past the end.
+  index_type firstFrom(size_type& b) const
+  {
+    while(b<table.size() && table[b]==nil)
+    {
+      b++;
+    }
+    return b<table.size() ? table[b] : nil;
+  }
+
+  index_type successor(index_type i, size_type& b) const
+  {
+    if(arena[i].next!=nil)
+    {
+      return arena[i].next;
+    }
+    b++;
+    return firstFrom(b);
+  }
+
+  // Entry before i (nil meaning end) and its bucket; nil before the first.
+  index_type predecessor(index_type i, size_type& b) const
+  {
+    if(i!=nil && table[b]!=i)
+    {
+      index_type p=table[b];
+      while(arena[p].next!=i)
+      {
+        p=arena[p].next;
+      }
+      return p;
+    }
+    while(b>0)
+    {
+      b--;
+      if(table[b]!=nil)
+      {
+        index_type p=table[b];
+        while(arena[p].next!=nil)
+        {
+          p=arena[p].next;
+        }
+        return p;
+      }
+    }
+    return nil;
+  }
+
+public:
+  CompactHashMap(size_type tabSize=1000)
+  : table(tabSize,nil), arena(), freeList(nil), numOfNodes(0)
+  {}
+
+  CompactHashMap(std::initializer_list<value_type> list)
+  : CompactHashMap()
+  {
+    for(auto it=list.begin(); it!=list.end(); it++)
+    {
+      (*this)[it->first]=it->second;
+    }
+  }
+
+  // Chains refer to entries by index, so copying the arena copies the map.
+  CompactHashMap(const CompactHashMap& other) = default;
+
+  CompactHashMap(CompactHashMap&& other)
+  : table(std::move(other.table)), arena(std::move(other.arena)),
+    freeList(other.freeList), numOfNodes(other.numOfNodes)
+  {
+    other.table.clear();
+    other.arena.clear();
+    other.freeList=nil;
+    other.numOfNodes=0;
+  }
+
+  // Entries cannot be assigned (their keys are const), so the arena is
+  // replaced rather than assigned element by element.
+  CompactHashMap& operator=(const CompactHashMap& other)
+  {
+    if(this!=&other)
+    {
+      *this=CompactHashMap(other);
+    }
+    return *this;
+  }
+
+  CompactHashMap& operator=(CompactHashMap&& other)
+  {
+    if(this!=&other)
+    {
+      table=std::move(other.table);
+      arena=std::move(other.arena);
+      freeList=other.freeList;
+      numOfNodes=other.numOfNodes;
+      other.table.clear();
+      other.arena.clear();
+      other.freeList=nil;
+      other.numOfNodes=0;
+    }
+    return *this;
+  }
+
+  // Makes room for n entries, so that inserting them moves nothing.
+  void reserve(size_type n)
+  {
+    arena.reserve(n);
+  }
+
+  bool isEmpty() const
+  {
+    return numOfNodes==0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    if(table.empty())
+    {
+      throw std::out_of_range("Hash table was moved from");
+    }
+    index_type found=findNode(key);
+    if(found!=nil)
+    {
+      return arena[found].data().second;
+    }
+    index_type newNode=allocate(key,mapped_type());
+    index_type& head=table[bucketOf(key)];
+    arena[newNode].next=head;
+    head=newNode;
+    numOfNodes++;
+    return arena[newNode].data().second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(numOfNodes==0)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    index_type n=findNode(key);
+    if(n==nil)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return arena[n].data().second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(static_cast<const CompactHashMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    index_type n=findNode(key);
+    return ConstIterator(this,n,n==nil ? table.size() : bucketOf(key));
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(static_cast<const CompactHashMap*>(this)->find(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    remove(find(key));
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(numOfNodes==0)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    if(it==end())
+    {
+      throw std::out_of_range("No key found in hash");
+    }
+    removeNode(it.getIndex());
+  }
+
+  size_type getSize() const
+  {
+    return numOfNodes;
+  }
+
+  size_type getTabSize() const
+  {
+    return table.size();
+  }
+
+  bool operator==(const CompactHashMap& other) const
+  {
+    if(numOfNodes!=other.numOfNodes)
+    {
+      return false;
+    }
+    for(auto it=begin(); it!=end(); ++it)
+    {
+      index_type n=other.findNode(it->first);
+      if(n==nil || other.arena[n].data().second!=it->second)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const CompactHashMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return Iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return Iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    size_type b=0;
+    index_type n=firstFrom(b);
+    return ConstIterator(this,n,b);
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this,nil,table.size());
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+const typename CompactHashMap<KeyType, ValueType>::index_type CompactHashMap<KeyType, ValueType>::nil;
+
+template <typename KeyType, typename ValueType>
+class CompactHashMap<KeyType, ValueType>::ConstIterator
+{
+  friend class CompactHashMap;
+
+  const CompactHashMap* mapPtr;
+  index_type nodeIndex;
+  size_type bucket;
+
+public:
+  using reference = typename CompactHashMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename CompactHashMap::value_type;
+  using pointer = const typename CompactHashMap::value_type*;
+
+  explicit ConstIterator(const CompactHashMap* h, index_type i, size_type b)
+  : mapPtr(h), nodeIndex(i), bucket(b)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(nodeIndex==nil)
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    nodeIndex=mapPtr->successor(nodeIndex,bucket);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    size_type b=bucket;
+    index_type i=mapPtr->predecessor(nodeIndex,b);
+    if(i==nil)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    nodeIndex=i;
+    bucket=b;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(nodeIndex==nil)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return mapPtr->arena[nodeIndex].data();
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return mapPtr==other.mapPtr && nodeIndex==other.nodeIndex;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+  index_type getIndex() const
+  {
+    return nodeIndex;
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class CompactHashMap<KeyType, ValueType>::Iterator
+  : public CompactHashMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename CompactHashMap::reference;
+  using pointer = typename CompactHashMap::value_type*;
+
+  Iterator(const ConstIterator& other)
+  : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_COMPACTHASHMAP_H */
@@ -0,0 +1,668 @@
+#ifndef AISDI_MAPS_COMPACTTREEMAP_H
+#define AISDI_MAPS_COMPACTTREEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// The same unbalanced binary search tree as TreeMap, laid out compactly:
+// nodes live in one contiguous arena and refer to each other by 32-bit
+// indices instead of pointers, and there are no prev/next threads (the
+// iterators walk parent links instead). A node costs the entry plus 12
+// bytes of links and a flag, with no per-node allocation, so the map holds
+// up to 2^32-1 entries in about half the memory of a TreeMap.
+//
+// Removed slots are kept on a free list and reused. Iterators stay valid
+// until their entry is removed, but like std::vector the arena may move
+// when it grows, so a reference to a value is invalidated by inserting.
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class CompactTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using key_compare = Compare;
+  using index_type = std::uint32_t;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const index_type nil=static_cast<index_type>(-1);
+
+  // The entry lives in raw storage inside the node: a node itself is never
+  // rebuilt, so the arena's elements stay valid while the entry in a freed
+  // slot is destroyed and a new one constructed there.
+  struct Node
+  {
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+    index_type parent;
+    index_type left;
+    index_type right;
+    bool live;
+
+    Node(const key_type& k, mapped_type&& m)
+    : storage(), parent(nil), left(nil), right(nil), live(false)
+    {
+      emplace(k,std::move(m));
+    }
+
+    Node(const Node& other)
+    : storage(), parent(other.parent), left(other.left), right(other.right), live(false)
+    {
+      if(other.live)
+      {
+        new (&storage) value_type(other.data());
+        live=true;
+      }
+    }
+
+    Node(Node&& other) noexcept(std::is_nothrow_move_constructible<value_type>::value)
+    : storage(), parent(other.parent), left(other.left), right(other.right), live(false)
+    {
+      if(other.live)
+      {
+        new (&storage) value_type(std::move(other.data()));
+        live=true;
+      }
+    }
+
+    Node& operator=(const Node&) = delete;
+
+    ~Node()
+    {
+      destroy();
+    }
+
+    void emplace(const key_type& k, mapped_type&& m)
+    {
+      new (&storage) value_type(k,std::move(m));
+      live=true;
+    }
+
+    void destroy()
+    {
+      if(live)
+      {
+        live=false;
+        data().~value_type();
+      }
+    }
+
+    value_type& data()
+    {
+      return *reinterpret_cast<value_type*>(&storage);
+    }
+
+    const value_type& data() const
+    {
+      return *reinterpret_cast<const value_type*>(&storage);
+    }
+  };
+
+  std::vector<Node> arena;
+  index_type root;
+  // Freed slots, chained through their right links.
+  index_type freeList;
+  size_type numOfNodes;
+  Compare comp;
+
+  bool less(const key_type& a, const key_type& b) const
+  {
+    return comp(a,b);
+  }
+
+  Node& node(index_type i)
+  {
+    return arena[i];
+  }
+
+  const Node& node(index_type i) const
+  {
+    return arena[i];
+  }
+
+  index_type leftmost(index_type i) const
+  {
+    while(node(i).left!=nil)
+    {
+      i=node(i).left;
+    }
+    return i;
+  }
+
+  index_type rightmost(index_type i) const
+  {
+    while(node(i).right!=nil)
+    {
+      i=node(i).right;
+    }
+    return i;
+  }
+
+  index_type successor(index_type i) const
+  {
+    if(node(i).right!=nil)
+    {
+      return leftmost(node(i).right);
+    }
+    index_type p=node(i).parent;
+    while(p!=nil && node(p).right==i)
+    {
+      i=p;
+      p=node(p).parent;
+    }
+    return p;
+  }
+
+  index_type predecessor(index_type i) const
+  {
+    if(node(i).left!=nil)
+    {
+      return rightmost(node(i).left);
+    }
+    index_type p=node(i).parent;
+    while(p!=nil && node(p).left==i)
+    {
+      i=p;
+      p=node(p).parent;
+    }
+    return p;
+  }
+
+  // Takes a slot from the free list, or a new one at the end of the arena.
+  index_type allocate(const key_type& key, mapped_type&& value)
+  {
+    if(freeList!=nil)
+    {
+      index_type i=freeList;
+      node(i).emplace(key,std::move(value));
+      freeList=node(i).right;
+      node(i).right=nil;
+      return i;
+    }
+    if(arena.size()>=static_cast<size_type>(nil))
+    {
+      throw std::length_error("CompactTreeMap is full");
+    }
+    arena.emplace_back(key,std::move(value));
+    return static_cast<index_type>(arena.size()-1);
+  }
+
+  // The entry of a freed slot is destroyed, so that it does not hold on to
+  // resources.
+  void release(index_type i)
+  {
+    node(i).destroy();
+    node(i).parent=nil;
+    node(i).left=nil;
+    node(i).right=freeList;
+    freeList=i;
+  }
+
+  index_type findNode(const key_type& key) const
+  {
+    index_type temp=root;
+    while(temp!=nil)
+    {
+      if(less(key,node(temp).data().first))
+      {
+        temp=node(temp).left;
+      }
+      else if(less(node(temp).data().first,key))
+      {
+        temp=node(temp).right;
+      }
+      else break;
+    }
+    return temp;
+  }
+
+  void attach(index_type n, index_type parentNode)
+  {
+    if(parentNode==nil)
+    {
+      root=n;
+    }
+    else if(less(node(n).data().first,node(parentNode).data().first))
+    {
+      node(parentNode).left=n;
+    }
+    else
+    {
+      node(parentNode).right=n;
+    }
+    node(n).parent=parentNode;
+    numOfNodes++;
+  }
+
+  void replace(index_type delNode, index_type repNode)
+  {
+    index_type p=node(delNode).parent;
+    if(p==nil)
+    {
+      root=repNode;
+    }
+    else if(node(p).left==delNode)
+    {
+      node(p).left=repNode;
+    }
+    else
+    {
+      node(p).right=repNode;
+    }
+    if(repNode!=nil)
+    {
+      node(repNode).parent=p;
+      index_type l=node(delNode).left;
+      index_type r=node(delNode).right;
+      if(l!=nil && l!=repNode)
+      {
+        node(repNode).left=l;
+        node(l).parent=repNode;
+      }
+      if(r!=nil && r!=repNode)
+      {
+        node(repNode).right=r;
+        node(r).parent=repNode;
+      }
+    }
+  }
+
+  void removeNode(index_type remNode)
+  {
+    if(node(remNode).right==nil)
+    {
+      replace(remNode,node(remNode).left);
+    }
+    else if(node(remNode).left==nil)
+    {
+      replace(remNode,node(remNode).right);
+    }
+    else
+    {
+      index_type tmp=leftmost(node(remNode).right);
+      replace(tmp,node(tmp).right);
+      replace(remNode,tmp);
+    }
+    release(remNode);
+    numOfNodes--;
+    if(numOfNodes==0)
+    {
+      arena.clear();
+      freeList=nil;
+    }
+  }
+
+public:
+  CompactTreeMap()
+  : CompactTreeMap(Compare())
+  {}
+
+  explicit CompactTreeMap(const Compare& c)
+  : arena(), root(nil), freeList(nil), numOfNodes(0), comp(c)
+  {}
+
+  CompactTreeMap(std::initializer_list<value_type> list)
+  : CompactTreeMap()
+  {
+    for(auto it=list.begin(); it!=list.end(); it++)
+    {
+      (*this)[it->first]=it->second;
+    }
+  }
+
+  // Nodes refer to each other by index, so copying the arena copies the tree.
+  CompactTreeMap(const CompactTreeMap& other) = default;
+
+  CompactTreeMap(CompactTreeMap&& other)
+  : arena(std::move(other.arena)), root(other.root), freeList(other.freeList),
+    numOfNodes(other.numOfNodes), comp(other.comp)
+  {
+    other.arena.clear();
+    other.root=nil;
+    other.freeList=nil;
+    other.numOfNodes=0;
+  }
+
+  // Entries cannot be assigned (their keys are const), so the arena is
+  // replaced rather than assigned element by element.
+  CompactTreeMap& operator=(const CompactTreeMap& other)
+  {
+    if(this!=&other)
+    {
+      *this=CompactTreeMap(other);
+    }
+    return *this;
+  }
+
+  CompactTreeMap& operator=(CompactTreeMap&& other)
+  {
+    if(this!=&other)
+    {
+      arena=std::move(other.arena);
+      root=other.root;
+      freeList=other.freeList;
+      numOfNodes=other.numOfNodes;
+      comp=other.comp;
+      other.arena.clear();
+      other.root=nil;
+      other.freeList=nil;
+      other.numOfNodes=0;
+    }
+    return *this;
+  }
+
+  // Makes room for n entries, so that inserting them moves nothing.
+  void reserve(size_type n)
+  {
+    arena.reserve(n);
+  }
+
+  bool isEmpty() const
+  {
+    return numOfNodes==0;
+  }
+
+  key_compare keyComp() const
+  {
+    return comp;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    index_type parentNode=nil;
+    index_type temp=root;
+    while(temp!=nil)
+    {
+      parentNode=temp;
+      if(less(key,node(temp).data().first))
+      {
+        temp=node(temp).left;
+      }
+      else if(less(node(temp).data().first,key))
+      {
+        temp=node(temp).right;
+      }
+      else
+      {
+        return node(temp).data().second;
+      }
+    }
+    index_type newNode=allocate(key,mapped_type());
+    attach(newNode,parentNode);
+    return node(newNode).data().second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(root==nil)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    index_type n=findNode(key);
+    if(n==nil)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return node(n).data().second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(static_cast<const CompactTreeMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return ConstIterator(this,findNode(key));
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(this,findNode(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    remove(find(key));
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(root==nil)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    if(it==cend())
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    removeNode(it.getIndex());
+  }
+
+  size_type getSize() const
+  {
+    return numOfNodes;
+  }
+
+  bool operator==(const CompactTreeMap& other) const
+  {
+    if(numOfNodes!=other.numOfNodes)
+    {
+      return false;
+    }
+    for(auto it=begin(), otherIt=other.begin(); it!=end(); ++it, ++otherIt)
+    {
+      if(less(it->first,otherIt->first) || less(otherIt->first,it->first)
+         || it->second!=otherIt->second)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const CompactTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return Iterator(this,root==nil ? nil : leftmost(root));
+  }
+
+  iterator end()
+  {
+    return Iterator(this,nil);
+  }
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator(this,root==nil ? nil : leftmost(root));
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this,nil);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+const typename CompactTreeMap<KeyType, ValueType, Compare>::index_type CompactTreeMap<KeyType, ValueType, Compare>::nil;
+
+template <typename KeyType, typename ValueType, typename Compare>
+class CompactTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+  friend class CompactTreeMap;
+
+  const CompactTreeMap* treePtr;
+  index_type nodeIndex;
+
+public:
+  using reference = typename CompactTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename CompactTreeMap::value_type;
+  using pointer = const typename CompactTreeMap::value_type*;
+
+  explicit ConstIterator(const CompactTreeMap* t, index_type i)
+  : treePtr(t), nodeIndex(i)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(nodeIndex==nil)
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    nodeIndex=treePtr->successor(nodeIndex);
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(treePtr->root==nil)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    if(nodeIndex==nil)
+    {
+      nodeIndex=treePtr->rightmost(treePtr->root);
+      return *this;
+    }
+    index_type i=treePtr->predecessor(nodeIndex);
+    if(i==nil)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    nodeIndex=i;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(nodeIndex==nil)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return treePtr->node(nodeIndex).data();
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return treePtr==other.treePtr && nodeIndex==other.nodeIndex;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+
+  index_type getIndex() const
+  {
+    return nodeIndex;
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class CompactTreeMap<KeyType, ValueType, Compare>::Iterator
+  : public CompactTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+public:
+  using reference = typename CompactTreeMap::reference;
+  using pointer = typename CompactTreeMap::value_type*;
+
+  explicit Iterator(CompactTreeMap* t, index_type i)
+  : ConstIterator(t,i)
+  {}
+
+  Iterator(const ConstIterator& other)
+  : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_COMPACTTREEMAP_H */
@@ -0,0 +1,967 @@
+#ifndef AISDI_MAPS_CONCURRENTSKIPLISTMAP_H
+#define AISDI_MAPS_CONCURRENTSKIPLISTMAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// Epoch-based reclamation. A thread pins the current epoch for the duration
+// of an operation by taking a record; memory unlinked from a shared structure
+// is retired into that record and freed once the global epoch has moved on
+// twice, i.e. once no pinned thread can still hold a pointer to it. Records
+// are only held while an operation runs, so there are about as many as
+// threads using the domain at once; when all are taken pin() adds one rather
+// than wait for another thread.
+class EpochDomain
+{
+  struct Retired
+  {
+    void* ptr;
+    void (*deleter)(void*);
+    std::uint64_t epoch;
+  };
+
+public:
+  struct Record
+  {
+    std::atomic<std::uint64_t> epoch;
+    std::atomic<bool> taken;
+    std::vector<Retired> retired;
+    Record* next;
+    char padding[64];
+
+    Record()
+    : epoch(0), taken(true), retired(), next(nullptr)
+    {}
+  };
+
+  EpochDomain()
+  : globalEpoch(1), records(nullptr)
+  {}
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  ~EpochDomain()
+  {
+    Record* r=records.load();
+    while(r!=nullptr)
+    {
+      for(auto& item : r->retired)
+      {
+        item.deleter(item.ptr);
+      }
+      Record* nextRecord=r->next;
+      delete r;
+      r=nextRecord;
+    }
+  }
+
+  // Takes a free record, or a new one, announcing the current epoch in it.
+  Record* pin()
+  {
+    Record* r=records.load(std::memory_order_acquire);
+    for(; r!=nullptr; r=r->next)
+    {
+      bool expected=false;
+      if(!r->taken.load(std::memory_order_relaxed)
+         && r->taken.compare_exchange_strong(expected,true))
+      {
+        break;
+      }
+    }
+    if(r==nullptr)
+    {
+      r=new Record();
+      Record* head=records.load(std::memory_order_relaxed);
+      do
+      {
+        r->next=head;
+      } while(!records.compare_exchange_weak(head,r));
+    }
+    r->epoch.store(globalEpoch.load());
+    return r;
+  }
+
+  void unpin(Record* r)
+  {
+    r->epoch.store(0,std::memory_order_release);
+    r->taken.store(false,std::memory_order_release);
+  }
+
+  // Only the holder of the record may retire through it.
+  void retire(Record* r, void* ptr, void (*deleter)(void*))
+  {
+    Retired item;
+    item.ptr=ptr;
+    item.deleter=deleter;
+    item.epoch=globalEpoch.load();
+    r->retired.push_back(item);
+    if(r->retired.size()>=retireThreshold)
+    {
+      tryAdvance();
+      std::uint64_t safe=globalEpoch.load();
+      std::size_t kept=0;
+      for(std::size_t i=0; i<r->retired.size(); i++)
+      {
+        if(r->retired[i].epoch+2<=safe)
+        {
+          r->retired[i].deleter(r->retired[i].ptr);
+        }
+        else
+        {
+          r->retired[kept++]=r->retired[i];
+        }
+      }
+      r->retired.resize(kept);
+    }
+  }
+
+private:
+  static const std::size_t retireThreshold=64;
+
+  void tryAdvance()
+  {
+    std::uint64_t current=globalEpoch.load();
+    for(Record* r=records.load(); r!=nullptr; r=r->next)
+    {
+      std::uint64_t e=r->epoch.load();
+      if(e!=0 && e!=current)
+      {
+        return;
+      }
+    }
+    globalEpoch.compare_exchange_strong(current,current+1);
+  }
+
+  std::atomic<std::uint64_t> globalEpoch;
+  char padding[64];
+  std::atomic<Record*> records;
+};
+
+// Keeps an epoch pinned while alive; meant to live for one operation.
+class EpochGuard
+{
+  EpochDomain* domain;
+  EpochDomain::Record* record;
+public:
+  explicit EpochGuard(EpochDomain& d)
+  : domain(&d), record(d.pin())
+  {}
+
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+
+  EpochGuard(EpochGuard&& other) noexcept
+  : domain(other.domain), record(other.record)
+  {
+    other.domain=nullptr;
+    other.record=nullptr;
+  }
+
+  ~EpochGuard()
+  {
+    if(domain!=nullptr)
+    {
+      domain->unpin(record);
+    }
+  }
+
+  void retire(void* ptr, void (*deleter)(void*))
+  {
+    domain->retire(record,ptr,deleter);
+  }
+};
+
+// Lock-free ordered map (skip list with marked successor pointers) that can
+// be shared between threads without a mutex. find, operator[], valueOf and
+// remove are safe to call concurrently; iteration is weakly consistent: it
+// sees every entry present for its whole duration and may or may not see
+// concurrent updates.
+//
+// Entries are never modified in place by the map, but the mapped value is a
+// plain object: concurrent writes to the value of the same key must be
+// synchronized by the caller. References returned by operator[] and valueOf,
+// and iterators, may be dereferenced only while their entry is in the map;
+// visit() and forEachFrom() hand out entries that another thread may be
+// removing meanwhile.
+template <typename KeyType, typename ValueType>
+class ConcurrentSkipListMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static const int maxLevel=32;
+
+  enum NodeState
+  {
+    INSERTING=1,
+    DELETED=2
+  };
+
+  // The tower of successor links is allocated right behind the node, so a
+  // search touches one allocation per visited node.
+  struct Node
+  {
+    value_type data;
+    int height;
+    std::atomic<int> state;
+    std::atomic<std::uintptr_t>* next;
+
+    static Node* create(const key_type& k, const mapped_type& m, int h)
+    {
+      void* memory=::operator new(sizeof(Node)+h*sizeof(std::atomic<std::uintptr_t>));
+      Node* n=new (memory) Node(k,m,h);
+      return n;
+    }
+
+    static void destroy(Node* n)
+    {
+      if(n!=nullptr)
+      {
+        n->~Node();
+        ::operator delete(n);
+      }
+    }
+
+  private:
+    Node(const key_type& k, const mapped_type& m, int h)
+    : data(k,m), height(h), state(INSERTING),
+      next(reinterpret_cast<std::atomic<std::uintptr_t>*>(this+1))
+    {
+      for(int i=0; i<h; i++)
+      {
+        new (&next[i]) std::atomic<std::uintptr_t>(0);
+      }
+    }
+
+    ~Node() {}
+  };
+
+  struct Core
+  {
+    std::atomic<std::uintptr_t> head[maxLevel];
+    // Levels at or above topLevel are empty; an inserter raises it before
+    // searching, so searches never need to start any higher.
+    std::atomic<int> topLevel;
+    std::atomic<size_type> numOfNodes;
+    EpochDomain epochs;
+
+    Core()
+    : topLevel(1), numOfNodes(0)
+    {
+      for(int i=0; i<maxLevel; i++)
+      {
+        head[i].store(0);
+      }
+    }
+  };
+
+  std::unique_ptr<Core> core;
+
+  static Node* ptrOf(std::uintptr_t link)
+  {
+    return reinterpret_cast<Node*>(link & ~static_cast<std::uintptr_t>(1));
+  }
+
+  static bool isMarked(std::uintptr_t link)
+  {
+    return (link & 1)!=0;
+  }
+
+  static std::uintptr_t addressOf(Node* n)
+  {
+    return reinterpret_cast<std::uintptr_t>(n);
+  }
+
+  static void deleteNode(void* n)
+  {
+    Node::destroy(static_cast<Node*>(n));
+  }
+
+  // Outgoing link of pred at the given level; nullptr stands for the head.
+  std::atomic<std::uintptr_t>& link(Node* pred, int level) const
+  {
+    return pred==nullptr ? core->head[level] : pred->next[level];
+  }
+
+  static int randomHeight()
+  {
+    static thread_local std::uint32_t seed=0;
+    if(seed==0)
+    {
+      seed=static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&seed))|1u;
+    }
+    seed^=seed<<13;
+    seed^=seed>>17;
+    seed^=seed<<5;
+    int height=1;
+    std::uint32_t bits=seed;
+    while(height<maxLevel && (bits & 1))
+    {
+      height++;
+      bits>>=1;
+    }
+    return height;
+  }
+
+  // Fills preds/succs with the neighbours of key on every level, unlinking
+  // logically deleted nodes met on the way. Returns whether succs[0] holds key.
+  bool findPosition(const key_type& key, Node** preds, Node** succs) const
+  {
+    bool restart=true;
+    while(restart)
+    {
+      restart=false;
+      Node* pred=nullptr;
+      int top=core->topLevel.load();
+      for(int level=maxLevel-1; level>=top; level--)
+      {
+        preds[level]=nullptr;
+        succs[level]=nullptr;
+      }
+      for(int level=top-1; level>=0 && !restart; level--)
+      {
+        Node* curr=ptrOf(link(pred,level).load());
+        while(curr!=nullptr)
+        {
+          std::uintptr_t succ=curr->next[level].load();
+          while(isMarked(succ))
+          {
+            std::uintptr_t expected=addressOf(curr);
+            if(!link(pred,level).compare_exchange_strong(expected,addressOf(ptrOf(succ))))
+            {
+              restart=true;
+              break;
+            }
+            curr=ptrOf(succ);
+            if(curr==nullptr)
+            {
+              break;
+            }
+            succ=curr->next[level].load();
+          }
+          if(restart || curr==nullptr || !(curr->data.first<key))
+          {
+            break;
+          }
+          pred=curr;
+          curr=ptrOf(succ);
+        }
+        preds[level]=pred;
+        succs[level]=curr;
+      }
+    }
+    return succs[0]!=nullptr && !(key<succs[0]->data.first);
+  }
+
+  // Last live node with key less than the given one (or the last node at all
+  // when key is nullptr).
+  Node* findBefore(const key_type* key) const
+  {
+    Node* pred=nullptr;
+    for(int level=core->topLevel.load()-1; level>=0; level--)
+    {
+      Node* curr=ptrOf(link(pred,level).load());
+      while(curr!=nullptr && (key==nullptr || curr->data.first<*key))
+      {
+        if(!isMarked(curr->next[0].load()))
+        {
+          pred=curr;
+        }
+        curr=ptrOf(curr->next[level].load());
+      }
+    }
+    return pred;
+  }
+
+  static Node* firstLiveFrom(Node* n)
+  {
+    while(n!=nullptr && isMarked(n->next[0].load()))
+    {
+      n=ptrOf(n->next[0].load());
+    }
+    return n;
+  }
+
+  Node* insertOrGet(EpochGuard& guard, const key_type& key, const mapped_type& value,
+                    bool& inserted)
+  {
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    Node* n=nullptr;
+    inserted=false;
+    while(true)
+    {
+      if(findPosition(key,preds,succs))
+      {
+        Node::destroy(n);
+        return succs[0];
+      }
+      if(n==nullptr)
+      {
+        n=Node::create(key,value,randomHeight());
+        int top=core->topLevel.load();
+        while(top<n->height && !core->topLevel.compare_exchange_weak(top,n->height))
+        {
+        }
+        if(top<n->height)
+        {
+          continue;
+        }
+      }
+      for(int level=0; level<n->height; level++)
+      {
+        n->next[level].store(addressOf(succs[level]),std::memory_order_relaxed);
+      }
+      std::uintptr_t expected=addressOf(succs[0]);
+      if(link(preds[0],0).compare_exchange_strong(expected,addressOf(n)))
+      {
+        break;
+      }
+    }
+    inserted=true;
+    core->numOfNodes++;
+
+    for(int level=1; level<n->height; level++)
+    {
+      bool linked=false;
+      while(!linked)
+      {
+        std::uintptr_t expected=addressOf(succs[level]);
+        if(link(preds[level],level).compare_exchange_strong(expected,addressOf(n)))
+        {
+          linked=true;
+          break;
+        }
+        findPosition(key,preds,succs);
+        std::uintptr_t current=n->next[level].load();
+        if(succs[0]!=n || isMarked(current)
+           || !n->next[level].compare_exchange_strong(current,addressOf(succs[level])))
+        {
+          break;
+        }
+      }
+      if(!linked)
+      {
+        break;
+      }
+    }
+
+    // A remover that raced with the upper-level linking leaves the node to us.
+    if(n->state.fetch_and(~INSERTING) & DELETED)
+    {
+      findPosition(key,preds,succs);
+      guard.retire(n,&deleteNode);
+    }
+    return n;
+  }
+
+  bool removeKey(EpochGuard& guard, const key_type& key)
+  {
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    if(!findPosition(key,preds,succs))
+    {
+      return false;
+    }
+    Node* victim=succs[0];
+    for(int level=victim->height-1; level>=1; level--)
+    {
+      std::uintptr_t succ=victim->next[level].load();
+      while(!isMarked(succ))
+      {
+        victim->next[level].compare_exchange_weak(succ,succ|1);
+      }
+    }
+    std::uintptr_t succ=victim->next[0].load();
+    while(true)
+    {
+      if(isMarked(succ))
+      {
+        return false;
+      }
+      if(victim->next[0].compare_exchange_strong(succ,succ|1))
+      {
+        break;
+      }
+    }
+    core->numOfNodes--;
+    int previousState=victim->state.fetch_or(DELETED);
+    findPosition(key,preds,succs);
+    if(!(previousState & INSERTING))
+    {
+      guard.retire(victim,&deleteNode);
+    }
+    return true;
+  }
+
+  void deleteAll()
+  {
+    if(!core)
+    {
+      return;
+    }
+    Node* n=ptrOf(core->head[0].load());
+    while(n!=nullptr)
+    {
+      Node* nextNode=ptrOf(n->next[0].load());
+      Node::destroy(n);
+      n=nextNode;
+    }
+    for(int i=0; i<maxLevel; i++)
+    {
+      core->head[i].store(0);
+    }
+    core->topLevel.store(1);
+    core->numOfNodes.store(0);
+  }
+
+public:
+  ConcurrentSkipListMap()
+  : core(new Core())
+  {}
+
+  ConcurrentSkipListMap(std::initializer_list<value_type> list)
+  : ConcurrentSkipListMap()
+  {
+    EpochGuard guard(core->epochs);
+    for(auto it=list.begin(); it!=list.end(); it++)
+    {
+      bool inserted;
+      insertOrGet(guard,it->first,it->second,inserted);
+    }
+  }
+
+  // Copies a weakly consistent view of other.
+  ConcurrentSkipListMap(const ConcurrentSkipListMap& other)
+  : ConcurrentSkipListMap()
+  {
+    EpochGuard guard(core->epochs);
+    EpochGuard otherGuard(other.core->epochs);
+    for(Node* n=other.firstLiveFrom(ptrOf(other.core->head[0].load())); n!=nullptr;
+        n=firstLiveFrom(ptrOf(n->next[0].load())))
+    {
+      bool inserted;
+      insertOrGet(guard,n->data.first,n->data.second,inserted);
+    }
+  }
+
+  ConcurrentSkipListMap(ConcurrentSkipListMap&& other)
+  : core(std::move(other.core))
+  {
+    other.core.reset(new Core());
+  }
+
+  ~ConcurrentSkipListMap()
+  {
+    deleteAll();
+  }
+
+  ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap& other)
+  {
+    if(this!=&other)
+    {
+      ConcurrentSkipListMap copy(other);
+      *this=std::move(copy);
+    }
+    return *this;
+  }
+
+  ConcurrentSkipListMap& operator=(ConcurrentSkipListMap&& other)
+  {
+    if(this!=&other)
+    {
+      deleteAll();
+      core.swap(other.core);
+    }
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return firstLiveFrom(ptrOf(core->head[0].load()))==nullptr;
+  }
+
+  // A new entry becomes visible to other threads with a default-constructed
+  // value; use insert() to publish the value together with the key.
+  mapped_type& operator[](const key_type& key)
+  {
+    EpochGuard guard(core->epochs);
+    bool inserted;
+    return insertOrGet(guard,key,mapped_type(),inserted)->data.second;
+  }
+
+  // Adds the entry unless the key is already present; returns whether it did.
+  bool insert(const key_type& key, const mapped_type& value)
+  {
+    EpochGuard guard(core->epochs);
+    bool inserted;
+    insertOrGet(guard,key,value,inserted);
+    return inserted;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    auto it=find(key);
+    if(it==end())
+    {
+      throw std::out_of_range("No such key");
+    }
+    return it->second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    auto it=find(key);
+    if(it==end())
+    {
+      throw std::out_of_range("No such key");
+    }
+    return it->second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    EpochGuard guard(core->epochs);
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    if(!findPosition(key,preds,succs))
+    {
+      return cend();
+    }
+    return ConstIterator(this,succs[0]);
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(const_cast<const ConcurrentSkipListMap*>(this)->find(key));
+  }
+
+  // First entry with key not less than the given one; together with
+  // iteration this gives a weakly consistent range scan.
+  const_iterator lowerBound(const key_type& key) const
+  {
+    EpochGuard guard(core->epochs);
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    findPosition(key,preds,succs);
+    return ConstIterator(this,firstLiveFrom(succs[0]));
+  }
+
+  // Calls fn with the value of key, if present, and returns whether it was.
+  // The value stays valid for the call even if another thread removes the
+  // entry meanwhile.
+  template <typename Function>
+  bool visit(const key_type& key, Function fn)
+  {
+    EpochGuard guard(core->epochs);
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    if(!findPosition(key,preds,succs))
+    {
+      return false;
+    }
+    fn(succs[0]->data.second);
+    return true;
+  }
+
+  template <typename Function>
+  bool visit(const key_type& key, Function fn) const
+  {
+    return const_cast<ConcurrentSkipListMap*>(this)->visit(key,[&fn](const mapped_type& value)
+    {
+      fn(value);
+    });
+  }
+
+  // Calls fn for the entries with key not less than the given one, in key
+  // order, for as long as it returns true. Like visit(), but one epoch stays
+  // pinned for the whole walk, so keep it short.
+  template <typename Function>
+  void forEachFrom(const key_type& key, Function fn) const
+  {
+    EpochGuard guard(core->epochs);
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    findPosition(key,preds,succs);
+    for(Node* n=firstLiveFrom(succs[0]); n!=nullptr && fn(static_cast<const value_type&>(n->data));
+        n=firstLiveFrom(ptrOf(n->next[0].load())))
+    {
+    }
+  }
+
+  // Calls fn for every entry with lo <= key < hi, in key order.
+  template <typename Function>
+  void forEachInRange(const key_type& lo, const key_type& hi, Function fn) const
+  {
+    forEachFrom(lo,[&hi, &fn](const value_type& entry)
+    {
+      if(!(entry.first<hi))
+      {
+        return false;
+      }
+      fn(entry);
+      return true;
+    });
+  }
+
+  void remove(const key_type& key)
+  {
+    EpochGuard guard(core->epochs);
+    if(!removeKey(guard,key))
+    {
+      throw std::out_of_range("No key found in map");
+    }
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(it==cend())
+    {
+      throw std::out_of_range("No key found in map");
+    }
+    remove(it.key);
+  }
+
+  // Exact when the map is not being modified, approximate otherwise.
+  size_type getSize() const
+  {
+    return core->numOfNodes.load();
+  }
+
+  bool operator==(const ConcurrentSkipListMap& other) const
+  {
+    EpochGuard guard(core->epochs);
+    EpochGuard otherGuard(other.core->epochs);
+    Node* a=firstLiveFrom(ptrOf(core->head[0].load()));
+    Node* b=firstLiveFrom(ptrOf(other.core->head[0].load()));
+    for(; a!=nullptr && b!=nullptr;
+        a=firstLiveFrom(ptrOf(a->next[0].load())), b=firstLiveFrom(ptrOf(b->next[0].load())))
+    {
+      if(!(a->data.first==b->data.first) || a->data.second!=b->data.second)
+      {
+        return false;
+      }
+    }
+    return a==nullptr && b==nullptr;
+  }
+
+  bool operator!=(const ConcurrentSkipListMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return Iterator(cbegin());
+  }
+
+  iterator end()
+  {
+    return Iterator(cend());
+  }
+
+  const_iterator cbegin() const
+  {
+    EpochGuard guard(core->epochs);
+    return ConstIterator(this,firstLiveFrom(ptrOf(core->head[0].load())));
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this,nullptr);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+// Iterators keep no epoch pinned between steps, so any number of them may be
+// kept around without holding up reclamation. Each one remembers the key of
+// its entry and every step searches again from that key, which costs
+// O(log n) but works even after the entry has been removed.
+template <typename KeyType, typename ValueType>
+class ConcurrentSkipListMap<KeyType, ValueType>::ConstIterator
+{
+  friend class ConcurrentSkipListMap;
+
+  const ConcurrentSkipListMap* mapPtr;
+  Node* nodePtr;
+  key_type key;
+
+  // Only while an epoch is pinned, as n is read.
+  void moveTo(Node* n)
+  {
+    nodePtr=n;
+    if(n!=nullptr)
+    {
+      key=n->data.first;
+    }
+  }
+
+public:
+  using reference = typename ConcurrentSkipListMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename ConcurrentSkipListMap::value_type;
+  using pointer = const typename ConcurrentSkipListMap::value_type*;
+
+  explicit ConstIterator(const ConcurrentSkipListMap* m, Node* n)
+  : mapPtr(m), nodePtr(nullptr), key()
+  {
+    moveTo(n);
+  }
+
+  ConstIterator& operator++()
+  {
+    if(nodePtr==nullptr)
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    EpochGuard guard(mapPtr->core->epochs);
+    Node* preds[maxLevel];
+    Node* succs[maxLevel];
+    // Past the entry if it is still there, else to the first one after its key.
+    Node* n=(mapPtr->findPosition(key,preds,succs) ? ptrOf(succs[0]->next[0].load()) : succs[0]);
+    moveTo(firstLiveFrom(n));
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    EpochGuard guard(mapPtr->core->epochs);
+    Node* n=mapPtr->findBefore(nodePtr!=nullptr ? &key : nullptr);
+    if(n==nullptr)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    moveTo(n);
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(nodePtr==nullptr)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return nodePtr->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    if(mapPtr==other.mapPtr&&nodePtr==other.nodePtr)
+    {
+      return true;
+    }
+    return false;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class ConcurrentSkipListMap<KeyType, ValueType>::Iterator : public ConcurrentSkipListMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename ConcurrentSkipListMap::reference;
+  using pointer = typename ConcurrentSkipListMap::value_type*;
+
+  Iterator(const ConstIterator& other)
+  : ConstIterator(other)
+  {}
+
+  Iterator(ConstIterator&& other)
+  : ConstIterator(std::move(other))
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_CONCURRENTSKIPLISTMAP_H */
@@ -0,0 +1,428 @@
+#ifndef AISDI_MAPS_ENGINES_H
+#define AISDI_MAPS_ENGINES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BufferedTreeMap.h"
+#include "CompactHashMap.h"
+#include "CompactTreeMap.h"
+#include "ConcurrentSkipListMap.h"
+#include "FrozenTreeMap.h"
+#include "HashMap.h"
+#include "PersistentTreeMap.h"
+#include "RadixTreeMap.h"
+#include "TreeMap.h"
+#include "Workload.h"
+
+namespace aisdi
+{
+
+// The map engines behind one interface, so that a benchmark driver can run
+// the same workload against any of them. Keys come in as 64-bit integers
+// and go through keyOf(); put() inserts or overwrites, get() and scan() copy
+// values out, and scan() walks in key order from an existing key. An engine
+// is used by one thread at a time unless threadSafe says otherwise.
+template <typename Map>
+class BasicMapEngine
+{
+protected:
+  Map map;
+
+public:
+  using map_type = Map;
+  using key_type = typename Map::key_type;
+  using mapped_type = typename Map::mapped_type;
+
+  static const bool ordered=true;
+  static const bool writable=true;
+  static const bool threadSafe=false;
+
+  template <typename... Args>
+  explicit BasicMapEngine(Args&&... args)
+  : map(std::forward<Args>(args)...)
+  {}
+
+  static key_type keyOf(std::uint64_t key)
+  {
+    return key;
+  }
+
+  void put(const key_type& key, const mapped_type& value)
+  {
+    map[key]=value;
+  }
+
+  // Called once after the initial records have been put.
+  void finishLoad()
+  {}
+
+  bool contains(const key_type& key)
+  {
+    return map.find(key)!=map.end();
+  }
+
+  bool get(const key_type& key, mapped_type& out)
+  {
+    auto it=map.find(key);
+    if(it==map.end())
+    {
+      return false;
+    }
+    out=it->second;
+    return true;
+  }
+
+  bool remove(const key_type& key)
+  {
+    auto it=map.find(key);
+    if(it==map.end())
+    {
+      return false;
+    }
+    map.remove(it);
+    return true;
+  }
+
+  // Returns how many entries were read.
+  std::size_t scan(const key_type& start, std::size_t length, mapped_type& out)
+  {
+    std::size_t n=0;
+    for(auto it=map.find(start); n<length && it!=map.end(); ++it, n++)
+    {
+      out=it->second;
+    }
+    return n;
+  }
+
+  template <typename Function>
+  void forEach(Function fn)
+  {
+    for(auto it=map.begin(); it!=map.end(); ++it)
+    {
+      fn(it->first,it->second);
+    }
+  }
+
+  std::size_t size() const
+  {
+    return map.getSize();
+  }
+};
+
+template <typename Map>
+class MapEngine : public BasicMapEngine<Map>
+{
+public:
+  explicit MapEngine(std::size_t)
+  {}
+};
+
+// HashMap never rehashes, so its table is sized to the expected records.
+template <typename ValueType>
+class MapEngine<HashMap<std::uint64_t, ValueType>>
+  : public BasicMapEngine<HashMap<std::uint64_t, ValueType>>
+{
+public:
+  static const bool ordered=false;
+
+  explicit MapEngine(std::size_t capacity)
+  : BasicMapEngine<HashMap<std::uint64_t, ValueType>>(capacity>0 ? capacity : 1)
+  {}
+};
+
+template <typename ValueType>
+class MapEngine<CompactHashMap<std::uint64_t, ValueType>>
+  : public BasicMapEngine<CompactHashMap<std::uint64_t, ValueType>>
+{
+public:
+  static const bool ordered=false;
+
+  explicit MapEngine(std::size_t capacity)
+  : BasicMapEngine<CompactHashMap<std::uint64_t, ValueType>>(capacity>0 ? capacity : 1)
+  {
+    this->map.reserve(capacity);
+  }
+};
+
+// Blind writes are what this engine is built for. A scan applies the
+// pending messages first, so that it walks the leaves instead of searching
+// the buffers for every step.
+template <typename ValueType>
+class MapEngine<BufferedTreeMap<std::uint64_t, ValueType>>
+  : public BasicMapEngine<BufferedTreeMap<std::uint64_t, ValueType>>
+{
+  using Base = BasicMapEngine<BufferedTreeMap<std::uint64_t, ValueType>>;
+
+public:
+  explicit MapEngine(std::size_t)
+  {}
+
+  void put(const std::uint64_t& key, const ValueType& value)
+  {
+    this->map.insert(key,value);
+  }
+
+  std::size_t scan(const std::uint64_t& start, std::size_t length, ValueType& out)
+  {
+    this->map.begin();
+    return Base::scan(start,length,out);
+  }
+};
+
+// The skip list is safe for concurrent use, but a value is a plain object,
+// so values are written and copied under one of a set of striped locks.
+template <typename ValueType>
+class MapEngine<ConcurrentSkipListMap<std::uint64_t, ValueType>>
+  : public BasicMapEngine<ConcurrentSkipListMap<std::uint64_t, ValueType>>
+{
+  static const std::size_t numOfStripes=64;
+  std::mutex stripes[numOfStripes];
+
+  std::mutex& stripeOf(std::uint64_t key)
+  {
+    return stripes[(key*0x9E3779B97F4A7C15ull)>>58];
+  }
+
+public:
+  static const bool threadSafe=true;
+
+  explicit MapEngine(std::size_t)
+  {}
+
+  void put(const std::uint64_t& key, const ValueType& value)
+  {
+    if(!this->map.insert(key,value))
+    {
+      this->map.visit(key,[this, &key, &value](ValueType& v)
+      {
+        std::lock_guard<std::mutex> guard(stripeOf(key));
+        v=value;
+      });
+    }
+  }
+
+  // Through visit(), as a value read from an iterator may be freed by a
+  // concurrent remove.
+  bool get(const std::uint64_t& key, ValueType& out)
+  {
+    return this->map.visit(key,[this, &key, &out](const ValueType& v)
+    {
+      std::lock_guard<std::mutex> guard(stripeOf(key));
+      out=v;
+    });
+  }
+
+  bool remove(const std::uint64_t& key)
+  {
+    try
+    {
+      this->map.remove(key);
+    }
+    catch(const std::out_of_range&)
+    {
+      // missing, or removed concurrently by another thread
+      return false;
+    }
+    return true;
+  }
+
+  // Starts at the entry with the start key, as find(start) does in every
+  // other engine, so that a scan from a missing key reads nothing here either.
+  std::size_t scan(const std::uint64_t& start, std::size_t length, ValueType& out)
+  {
+    std::size_t n=0;
+    using Entry = std::pair<const std::uint64_t, ValueType>;
+    this->map.forEachFrom(start,[this, &start, length, &out, &n](const Entry& entry)
+    {
+      if(n==length || (n==0 && entry.first!=start))
+      {
+        return false;
+      }
+      std::lock_guard<std::mutex> guard(stripeOf(entry.first));
+      out=entry.second;
+      n++;
+      return true;
+    });
+    return n;
+  }
+};
+
+template <typename ValueType>
+const std::size_t MapEngine<ConcurrentSkipListMap<std::uint64_t, ValueType>>::numOfStripes;
+
+template <typename ValueType>
+class MapEngine<RadixTreeMap<ValueType>> : public BasicMapEngine<RadixTreeMap<ValueType>>
+{
+public:
+  explicit MapEngine(std::size_t)
+  {}
+
+  static std::string keyOf(std::uint64_t key)
+  {
+    return WorkloadGenerator::stringKey(key,WorkloadGenerator::keyDigits);
+  }
+};
+
+// Read-only: the records put before finishLoad() are staged and frozen.
+template <typename ValueType>
+class MapEngine<FrozenTreeMap<std::uint64_t, ValueType>>
+  : public BasicMapEngine<FrozenTreeMap<std::uint64_t, ValueType>>
+{
+  std::map<std::uint64_t, ValueType> staged;
+  bool frozen;
+
+public:
+  static const bool writable=false;
+
+  explicit MapEngine(std::size_t)
+  : staged(), frozen(false)
+  {}
+
+  void put(const std::uint64_t& key, const ValueType& value)
+  {
+    if(frozen)
+    {
+      throw std::logic_error("FrozenTreeMap is read-only");
+    }
+    staged[key]=value;
+  }
+
+  void finishLoad()
+  {
+    this->map=FrozenTreeMap<std::uint64_t, ValueType>(staged.begin(),staged.end());
+    staged.clear();
+    frozen=true;
+  }
+
+  bool remove(const std::uint64_t&)
+  {
+    throw std::logic_error("FrozenTreeMap is read-only");
+  }
+};
+
+template <typename ValueType>
+class MapEngine<std::map<std::uint64_t, ValueType>>
+  : public BasicMapEngine<std::map<std::uint64_t, ValueType>>
+{
+public:
+  explicit MapEngine(std::size_t)
+  {}
+
+  bool remove(const std::uint64_t& key)
+  {
+    return this->map.erase(key)>0;
+  }
+
+  std::size_t size() const
+  {
+    return this->map.size();
+  }
+};
+
+template <typename ValueType>
+class MapEngine<std::unordered_map<std::uint64_t, ValueType>>
+  : public BasicMapEngine<std::unordered_map<std::uint64_t, ValueType>>
+{
+public:
+  static const bool ordered=false;
+
+  explicit MapEngine(std::size_t)
+  {}
+
+  bool remove(const std::uint64_t& key)
+  {
+    return this->map.erase(key)>0;
+  }
+
+  std::size_t size() const
+  {
+    return this->map.size();
+  }
+};
+
+inline const std::vector<std::string>& engineNames()
+{
+  static const std::vector<std::string> names={
+    "TreeMap", "SplayTreeMap", "ScapegoatTreeMap", "HashMap", "CompactTreeMap",
+    "CompactHashMap", "BufferedTreeMap", "PersistentTreeMap", "ConcurrentSkipListMap",
+    "RadixTreeMap", "FrozenTreeMap", "std::map", "std::unordered_map"
+  };
+  return names;
+}
+
+// Calls visitor.template run<Engine>(name) with the MapEngine called name,
+// holding values of type Value; returns false if there is no such engine.
+template <typename Value, typename Visitor>
+bool visitEngine(const std::string& name, Visitor& visitor)
+{
+  using Key = std::uint64_t;
+  if(name=="TreeMap")
+  {
+    visitor.template run<MapEngine<TreeMap<Key, Value>>>(name);
+  }
+  else if(name=="SplayTreeMap")
+  {
+    visitor.template run<MapEngine<TreeMap<Key, Value, std::less<Key>, NoAggregate, SplayAccess>>>(name);
+  }
+  else if(name=="ScapegoatTreeMap")
+  {
+    visitor.template run<MapEngine<TreeMap<Key, Value, std::less<Key>, NoAggregate, ScapegoatAccess>>>(name);
+  }
+  else if(name=="HashMap")
+  {
+    visitor.template run<MapEngine<HashMap<Key, Value>>>(name);
+  }
+  else if(name=="CompactTreeMap")
+  {
+    visitor.template run<MapEngine<CompactTreeMap<Key, Value>>>(name);
+  }
+  else if(name=="CompactHashMap")
+  {
+    visitor.template run<MapEngine<CompactHashMap<Key, Value>>>(name);
+  }
+  else if(name=="BufferedTreeMap")
+  {
+    visitor.template run<MapEngine<BufferedTreeMap<Key, Value>>>(name);
+  }
+  else if(name=="PersistentTreeMap")
+  {
+    visitor.template run<MapEngine<PersistentTreeMap<Key, Value>>>(name);
+  }
+  else if(name=="ConcurrentSkipListMap")
+  {
+    visitor.template run<MapEngine<ConcurrentSkipListMap<Key, Value>>>(name);
+  }
+  else if(name=="RadixTreeMap")
+  {
+    visitor.template run<MapEngine<RadixTreeMap<Value>>>(name);
+  }
+  else if(name=="FrozenTreeMap")
+  {
+    visitor.template run<MapEngine<FrozenTreeMap<Key, Value>>>(name);
+  }
+  else if(name=="std::map")
+  {
+    visitor.template run<MapEngine<std::map<Key, Value>>>(name);
+  }
+  else if(name=="std::unordered_map")
+  {
+    visitor.template run<MapEngine<std::unordered_map<Key, Value>>>(name);
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+}
+
+#endif /* AISDI_MAPS_ENGINES_H */
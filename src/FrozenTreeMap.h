@@ -0,0 +1,348 @@
+#ifndef AISDI_MAPS_FROZENTREEMAP_H
+#define AISDI_MAPS_FROZENTREEMAP_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// Immutable ordered map built once from sorted entries (see
+// TreeMap::freeze()). Keys are stored in Eytzinger (breadth-first) order:
+// the children of slot k are slots 2k and 2k+1, so the top levels of the
+// implicit tree share a few cache lines and a search walks down without
+// pointers and without a data-dependent branch. Values live in a parallel
+// array at the same slots.
+//
+// Slots are numbered from 1; slot k is stored at index k-1 and slot 0
+// stands for end().
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class FrozenTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+  // Entries are not stored as pairs, so iterators hand out pairs of references.
+  using const_reference = std::pair<const key_type&, const mapped_type&>;
+  using reference = const_reference;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  std::vector<key_type> keys;
+  std::vector<mapped_type> values;
+  Compare comp;
+
+  // Navigation over the implicit tree of n slots.
+  static size_type leftmost(size_type k, size_type n)
+  {
+    while(2*k<=n)
+    {
+      k=2*k;
+    }
+    return k;
+  }
+
+  static size_type rightmost(size_type k, size_type n)
+  {
+    while(2*k+1<=n)
+    {
+      k=2*k+1;
+    }
+    return k;
+  }
+
+  // In-order successor of slot k; 0 after the last one.
+  static size_type successor(size_type k, size_type n)
+  {
+    if(2*k+1<=n)
+    {
+      return leftmost(2*k+1,n);
+    }
+    return k>>(trailingOnes(k)+1);
+  }
+
+  // In-order predecessor of slot k; 0 before the first one.
+  static size_type predecessor(size_type k, size_type n)
+  {
+    if(2*k<=n)
+    {
+      return rightmost(2*k,n);
+    }
+    while(!(k&1))
+    {
+      k>>=1;
+    }
+    return k>>1;
+  }
+
+  static size_type trailingOnes(size_type k)
+  {
+#if defined(__GNUC__)
+    return ~k==0 ? sizeof(size_type)*8 : __builtin_ctzll(static_cast<unsigned long long>(~k));
+#else
+    size_type count=0;
+    while(k&1)
+    {
+      k>>=1;
+      count++;
+    }
+    return count;
+#endif
+  }
+
+  // Slot of the first key not less than the given one, or 0. Every level
+  // costs one comparison whose result is added to the index; the slot
+  // sixteen positions ahead (four levels down) is prefetched meanwhile.
+  size_type lowerBoundSlot(const key_type& key) const
+  {
+    const size_type n=keys.size();
+    const key_type* base=keys.data();
+    size_type k=1;
+    while(k<=n)
+    {
+#if defined(__GNUC__)
+      if(16*k<=n)
+      {
+        __builtin_prefetch(base+16*k-1);
+      }
+#endif
+      k=2*k+static_cast<size_type>(comp(base[k-1],key));
+    }
+    return k>>(trailingOnes(k)+1);
+  }
+
+  size_type findSlot(const key_type& key) const
+  {
+    size_type k=lowerBoundSlot(key);
+    if(k!=0 && comp(key,keys[k-1]))
+    {
+      k=0;
+    }
+    return k;
+  }
+
+public:
+  FrozenTreeMap()
+  : keys(), values(), comp()
+  {}
+
+  // Builds the map from a range of entries sorted by key (with no duplicates).
+  template <typename InputIt>
+  FrozenTreeMap(InputIt firstIt, InputIt lastIt, const Compare& c = Compare())
+  : keys(), values(), comp(c)
+  {
+    std::vector<InputIt> sorted;
+    for(InputIt it=firstIt; it!=lastIt; ++it)
+    {
+      sorted.push_back(it);
+    }
+    const size_type n=sorted.size();
+    if(n==0)
+    {
+      return;
+    }
+    // an in-order walk over the slots visits them in key order
+    std::vector<size_type> rankOf(n);
+    size_type k=leftmost(1,n);
+    for(size_type rank=0; rank<n; ++rank)
+    {
+      rankOf[k-1]=rank;
+      k=successor(k,n);
+    }
+    keys.reserve(n);
+    values.reserve(n);
+    for(size_type slot=0; slot<n; ++slot)
+    {
+      keys.push_back(sorted[rankOf[slot]]->first);
+      values.push_back(sorted[rankOf[slot]]->second);
+    }
+  }
+
+  bool isEmpty() const
+  {
+    return keys.empty();
+  }
+
+  size_type getSize() const
+  {
+    return keys.size();
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(keys.empty())
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    size_type k=findSlot(key);
+    if(k==0)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return values[k-1];
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return ConstIterator(this,findSlot(key));
+  }
+
+  // First entry whose key is not less than the given one.
+  const_iterator lowerBound(const key_type& key) const
+  {
+    return ConstIterator(this,lowerBoundSlot(key));
+  }
+
+  bool operator==(const FrozenTreeMap& other) const
+  {
+    if(getSize()!=other.getSize())
+    {
+      return false;
+    }
+    for(auto it=begin(), otherIt=other.begin(); it!=end(); ++it, ++otherIt)
+    {
+      if(comp(it->first,otherIt->first) || comp(otherIt->first,it->first)
+         || it->second!=otherIt->second)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const FrozenTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator(this,keys.empty() ? 0 : leftmost(1,keys.size()));
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this,0);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Compare>
+class FrozenTreeMap<KeyType, ValueType, Compare>::ConstIterator
+{
+  friend class FrozenTreeMap;
+
+  const FrozenTreeMap* treePtr;
+  size_type slot;
+
+  struct ArrowProxy
+  {
+    const_reference entry;
+
+    const const_reference* operator->() const
+    {
+      return &entry;
+    }
+  };
+
+public:
+  using reference = typename FrozenTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename FrozenTreeMap::value_type;
+  using pointer = ArrowProxy;
+
+  explicit ConstIterator(const FrozenTreeMap* t, size_type k)
+  : treePtr(t), slot(k)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(slot==0)
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    slot=FrozenTreeMap::successor(slot,treePtr->keys.size());
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(treePtr->keys.empty())
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    if(slot==0)
+    {
+      slot=FrozenTreeMap::rightmost(1,treePtr->keys.size());
+      return *this;
+    }
+    size_type k=FrozenTreeMap::predecessor(slot,treePtr->keys.size());
+    if(k==0)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    slot=k;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(slot==0)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return reference(treePtr->keys[slot-1],treePtr->values[slot-1]);
+  }
+
+  pointer operator->() const
+  {
+    return ArrowProxy{this->operator*()};
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return treePtr==other.treePtr && slot==other.slot;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_FROZENTREEMAP_H */
@@ -5,6 +5,9 @@
 #include <initializer_list>
 #include <stdexcept>
 #include <utility>
+#include <vector>
+
+#include "WorkStealingPool.h"
 
 namespace aisdi
 {
@@ -107,6 +110,23 @@ private:
     return nullptr;
   }
 
+  // Splits the table into about 8 bucket ranges per thread for a parallel
+  // scan; returns the range boundaries.
+  std::vector<size_type> scanRanges(unsigned threads) const
+  {
+    size_type pieces=8*static_cast<size_type>(threads);
+    if(pieces>TAB_SIZE)
+    {
+      pieces=TAB_SIZE;
+    }
+    std::vector<size_type> bounds;
+    for(size_type i=0; i<=pieces; i++)
+    {
+      bounds.push_back(TAB_SIZE*i/pieces);
+    }
+    return bounds;
+  }
+
   void deleteHash()
   {
     for(size_type index=0; index<TAB_SIZE; index++)
@@ -358,6 +378,89 @@ public:
     return cend();
   }
 
+  // Calls fn for every entry, from several threads at once (threads==0
+  // picks the number of hardware threads), in no particular order. fn must
+  // be safe to call concurrently; the map must not change meanwhile.
+  template <typename Function>
+  void parallelForEach(Function fn, unsigned threads=0) const
+  {
+    if(numOfNodes==0)
+    {
+      return;
+    }
+    WorkStealingPool pool(threads);
+    std::vector<size_type> bounds=scanRanges(pool.getThreads());
+    std::vector<WorkStealingPool::Task> tasks;
+    for(size_type i=0; i+1<bounds.size(); i++)
+    {
+      size_type from=bounds[i];
+      size_type to=bounds[i+1];
+      tasks.push_back([this, from, to, &fn]()
+      {
+        for(size_type index=from; index<to; index++)
+        {
+          for(const Node* n=table[index]; n!=nullptr; n=n->next)
+          {
+            fn(n->data);
+          }
+        }
+      });
+    }
+    pool.run(tasks);
+  }
+
+  // Returns init combined with transform(entry) of every entry, computed on
+  // several threads. Partial results are combined in iteration order, so
+  // combine needs to be associative but not commutative.
+  template <typename T, typename Transform, typename Combine>
+  T parallelReduce(T init, Transform transform, Combine combine, unsigned threads=0) const
+  {
+    if(numOfNodes==0)
+    {
+      return init;
+    }
+    WorkStealingPool pool(threads);
+    std::vector<size_type> bounds=scanRanges(pool.getThreads());
+    std::vector<std::pair<bool, T>> partial(bounds.size()-1,std::make_pair(false,init));
+    std::vector<WorkStealingPool::Task> tasks;
+    for(size_type i=0; i+1<bounds.size(); i++)
+    {
+      size_type from=bounds[i];
+      size_type to=bounds[i+1];
+      std::pair<bool, T>* out=&partial[i];
+      tasks.push_back([this, from, to, out, &transform, &combine]()
+      {
+        bool found=false;
+        T acc=out->second;
+        for(size_type index=from; index<to; index++)
+        {
+          for(const Node* n=table[index]; n!=nullptr; n=n->next)
+          {
+            if(found)
+            {
+              acc=combine(acc,transform(n->data));
+            }
+            else
+            {
+              acc=transform(n->data);
+              found=true;
+            }
+          }
+        }
+        *out=std::make_pair(found,std::move(acc));
+      });
+    }
+    pool.run(tasks);
+    for(auto& p : partial)
+    {
+      if(p.first)
+      {
+        init=combine(init,p.second);
+      }
+    }
+    return init;
+  }
+
   size_type getTabSize() const
   {
     return TAB_SIZE;
@@ -0,0 +1,166 @@
+#ifndef AISDI_MAPS_LATENCYHISTOGRAM_H
+#define AISDI_MAPS_LATENCYHISTOGRAM_H
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace aisdi
+{
+
+// Log-linear histogram of latencies in nanoseconds, in the manner of
+// HdrHistogram: values below 128 are counted exactly, and every further
+// power of two is split into 64 equal buckets, so a value is known to
+// within 1/64 over the whole 64-bit range, in a fixed 30 KB. Histograms
+// recorded by different threads are merged by adding their counts.
+class LatencyHistogram
+{
+public:
+  using value_type = std::uint64_t;
+
+private:
+  static const unsigned subBucketBits=6;
+  static const value_type subBuckets=value_type(1)<<subBucketBits;
+
+  std::vector<std::uint64_t> counts;
+  std::uint64_t total;
+  value_type minValue;
+  value_type maxValue;
+  double sum;
+
+  static unsigned log2(value_type v)
+  {
+    unsigned r=0;
+    while(v>>=1)
+    {
+      r++;
+    }
+    return r;
+  }
+
+  static std::size_t indexOf(value_type v)
+  {
+    if(v<2*subBuckets)
+    {
+      return static_cast<std::size_t>(v);
+    }
+    unsigned shift=log2(v)-subBucketBits;
+    return static_cast<std::size_t>(shift*subBuckets+(v>>shift));
+  }
+
+  // Largest value counted in bucket i.
+  static value_type highestIn(std::size_t i)
+  {
+    if(i<2*subBuckets)
+    {
+      return i;
+    }
+    unsigned shift=static_cast<unsigned>(i/subBuckets)-1;
+    value_type low=(i%subBuckets+subBuckets)<<shift;
+    return low+((value_type(1)<<shift)-1);
+  }
+
+public:
+  LatencyHistogram()
+  : counts(indexOf(~value_type(0))+1,0), total(0), minValue(~value_type(0)), maxValue(0), sum(0)
+  {}
+
+  void record(value_type ns)
+  {
+    counts[indexOf(ns)]++;
+    total++;
+    sum+=ns;
+    if(ns<minValue)
+    {
+      minValue=ns;
+    }
+    if(ns>maxValue)
+    {
+      maxValue=ns;
+    }
+  }
+
+  template <typename Rep, typename Period>
+  void record(std::chrono::duration<Rep, Period> time)
+  {
+    auto ns=std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    record(ns>0 ? static_cast<value_type>(ns) : 0);
+  }
+
+  void merge(const LatencyHistogram& other)
+  {
+    for(std::size_t i=0; i<counts.size(); i++)
+    {
+      counts[i]+=other.counts[i];
+    }
+    total+=other.total;
+    sum+=other.sum;
+    if(other.minValue<minValue)
+    {
+      minValue=other.minValue;
+    }
+    if(other.maxValue>maxValue)
+    {
+      maxValue=other.maxValue;
+    }
+  }
+
+  void clear()
+  {
+    *this=LatencyHistogram();
+  }
+
+  std::uint64_t getCount() const
+  {
+    return total;
+  }
+
+  value_type getMin() const
+  {
+    return total ? minValue : 0;
+  }
+
+  value_type getMax() const
+  {
+    return maxValue;
+  }
+
+  double getMean() const
+  {
+    return total ? sum/total : 0;
+  }
+
+  // Smallest recorded latency that at least the given percent of the
+  // samples do not exceed, up to the bucket precision.
+  value_type percentile(double percent) const
+  {
+    if(percent<0 || percent>100)
+    {
+      throw std::out_of_range("Percentile out of range");
+    }
+    if(total==0)
+    {
+      return 0;
+    }
+    std::uint64_t rank=static_cast<std::uint64_t>(std::ceil(percent/100*total));
+    rank=rank<1 ? 1 : rank;
+    std::uint64_t seen=0;
+    for(std::size_t i=0; i<counts.size(); i++)
+    {
+      seen+=counts[i];
+      if(seen>=rank)
+      {
+        value_type v=highestIn(i);
+        return v<maxValue ? v : maxValue;
+      }
+    }
+    return maxValue;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_LATENCYHISTOGRAM_H */
@@ -0,0 +1,218 @@
+#ifndef AISDI_MAPS_PERFCOUNTERS_H
+#define AISDI_MAPS_PERFCOUNTERS_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace aisdi
+{
+
+// Hardware event counts of a measured phase, totals or per operation. An
+// event the machine could not count is not valid.
+struct PerfSample
+{
+  enum Event { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, DTLBMisses, numOfEvents };
+
+  double values[numOfEvents];
+  bool valid[numOfEvents];
+
+  PerfSample()
+  : values(), valid()
+  {}
+
+  static const char* name(int event)
+  {
+    static const char* const names[numOfEvents]={
+      "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"
+    };
+    return names[event];
+  }
+
+  bool any() const
+  {
+    for(int e=0; e<numOfEvents; e++)
+    {
+      if(valid[e])
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Mean count per operation over rounds of ops operations each; an event
+  // is valid only if it was counted in every round.
+  static PerfSample perOperation(const std::vector<PerfSample>& rounds, std::size_t ops)
+  {
+    PerfSample mean;
+    if(rounds.empty())
+    {
+      return mean;
+    }
+    for(int e=0; e<numOfEvents; e++)
+    {
+      mean.valid[e]=true;
+      for(const auto& r : rounds)
+      {
+        mean.valid[e]=mean.valid[e] && r.valid[e];
+        mean.values[e]+=r.values[e];
+      }
+      mean.values[e]=mean.valid[e] ? mean.values[e]/(rounds.size()*(ops ? ops : 1)) : 0;
+    }
+    return mean;
+  }
+};
+
+// Counts hardware events of the calling thread between start() and stop()
+// through Linux perf_event_open, user space only. Every event is opened on
+// its own, so an event the CPU, the kernel settings or a container do not
+// allow is simply left out; when the counters are multiplexed the counts
+// are scaled up to the whole period. Nothing is available elsewhere.
+class PerfCounters
+{
+  int fds[PerfSample::numOfEvents];
+  std::string problem;
+
+#ifdef __linux__
+  static int openEvent(std::uint32_t type, std::uint64_t config)
+  {
+    perf_event_attr attr;
+    std::memset(&attr,0,sizeof(attr));
+    attr.size=sizeof(attr);
+    attr.type=type;
+    attr.config=config;
+    attr.disabled=1;
+    attr.exclude_kernel=1;
+    attr.exclude_hv=1;
+    attr.read_format=PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(__NR_perf_event_open,&attr,0,-1,-1,0));
+  }
+
+  static std::uint64_t cacheMiss(std::uint64_t cache)
+  {
+    return cache|(PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_MISS<<16);
+  }
+#endif
+
+public:
+  PerfCounters()
+  : problem()
+  {
+#ifdef __linux__
+    const std::uint32_t types[PerfSample::numOfEvents]={
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+    };
+    const std::uint64_t configs[PerfSample::numOfEvents]={
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, cacheMiss(PERF_COUNT_HW_CACHE_L1D),
+      cacheMiss(PERF_COUNT_HW_CACHE_LL), PERF_COUNT_HW_BRANCH_MISSES, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)
+    };
+    for(int e=0; e<PerfSample::numOfEvents; e++)
+    {
+      fds[e]=openEvent(types[e],configs[e]);
+      if(fds[e]<0 && problem.empty())
+      {
+        problem=std::string(PerfSample::name(e))+": "+std::strerror(errno);
+      }
+    }
+#else
+    for(int e=0; e<PerfSample::numOfEvents; e++)
+    {
+      fds[e]=-1;
+    }
+    problem="hardware counters need Linux perf_event_open";
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters()
+  {
+#ifdef __linux__
+    for(int fd : fds)
+    {
+      if(fd>=0)
+      {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  // True if at least one event can be counted.
+  bool available() const
+  {
+    for(int fd : fds)
+    {
+      if(fd>=0)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Why the first event that could not be opened failed; empty if all are
+  // counted.
+  const std::string& unavailableReason() const
+  {
+    return problem;
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    for(int fd : fds)
+    {
+      if(fd>=0)
+      {
+        ioctl(fd,PERF_EVENT_IOC_RESET,0);
+        ioctl(fd,PERF_EVENT_IOC_ENABLE,0);
+      }
+    }
+#endif
+  }
+
+  // Counts since start(); an event that was never scheduled on the CPU is
+  // not valid.
+  PerfSample stop()
+  {
+    PerfSample sample;
+#ifdef __linux__
+    for(int fd : fds)
+    {
+      if(fd>=0)
+      {
+        ioctl(fd,PERF_EVENT_IOC_DISABLE,0);
+      }
+    }
+    for(int e=0; e<PerfSample::numOfEvents; e++)
+    {
+      std::uint64_t data[3];
+      if(fds[e]<0 || read(fds[e],data,sizeof(data))!=static_cast<ssize_t>(sizeof(data)) || data[2]==0)
+      {
+        continue;
+      }
+      sample.values[e]=static_cast<double>(data[0])*data[1]/data[2];
+      sample.valid[e]=true;
+    }
+#endif
+    return sample;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_PERFCOUNTERS_H */
@@ -0,0 +1,536 @@
+#ifndef AISDI_MAPS_PERSISTENTTREEMAP_H
+#define AISDI_MAPS_PERSISTENTTREEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// Ordered map whose versions share structure. Every update copies only the
+// nodes on its root-to-leaf path that are still referenced by another
+// version, so snapshot() is O(1) and an old version stays valid (and is freed
+// by reference counting) for as long as somebody holds it.
+//
+// A snapshot is an ordinary PersistentTreeMap and can be handed to reader
+// threads; the writer keeps updating its own map without any locking. Take
+// snapshots on the writer thread. References returned by operator[] and
+// valueOf are invalidated by the next update or snapshot.
+//
+// The tree is a treap, so its expected height is O(log n) regardless of the
+// insertion order and every update copies O(log n) nodes.
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  using iterator = ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  struct Node;
+  using NodePtr = std::shared_ptr<Node>;
+
+  struct Node
+  {
+    value_type data;
+    std::uint32_t priority;
+    NodePtr left;
+    NodePtr right;
+
+    Node(const key_type& k, const mapped_type& m, std::uint32_t p)
+    : data(k,m), priority(p), left(), right() {}
+  };
+
+  NodePtr root;
+  size_type numOfNodes;
+  std::uint32_t seed;
+
+  std::uint32_t nextPriority()
+  {
+    seed^=seed<<13;
+    seed^=seed>>17;
+    seed^=seed<<5;
+    return seed;
+  }
+
+  // Path copying happens here: a node reachable from another version is
+  // replaced by a private copy before it is modified.
+  static Node* makeUnique(NodePtr& slot)
+  {
+    if(slot.use_count()>1)
+    {
+      slot=std::make_shared<Node>(*slot);
+    }
+    return slot.get();
+  }
+
+  static void rotateRight(NodePtr& slot)
+  {
+    NodePtr l=std::move(slot->left);
+    slot->left=std::move(l->right);
+    l->right=std::move(slot);
+    slot=std::move(l);
+  }
+
+  static void rotateLeft(NodePtr& slot)
+  {
+    NodePtr r=std::move(slot->right);
+    slot->right=std::move(r->left);
+    r->left=std::move(slot);
+    slot=std::move(r);
+  }
+
+  Node* insert(NodePtr& slot, const key_type& key, const mapped_type& value)
+  {
+    if(!slot)
+    {
+      slot=std::make_shared<Node>(key,value,nextPriority());
+      numOfNodes++;
+      return slot.get();
+    }
+    Node* n=makeUnique(slot);
+    Node* result;
+    if(key<n->data.first)
+    {
+      result=insert(n->left,key,value);
+      if(n->left->priority>n->priority)
+      {
+        rotateRight(slot);
+      }
+    }
+    else if(n->data.first<key)
+    {
+      result=insert(n->right,key,value);
+      if(n->right->priority>n->priority)
+      {
+        rotateLeft(slot);
+      }
+    }
+    else
+    {
+      result=n;
+    }
+    return result;
+  }
+
+  // Descends to key copying shared nodes on the way, so the returned node is
+  // owned by this version only.
+  Node* findUnique(const key_type& key)
+  {
+    NodePtr* slot=&root;
+    while(*slot)
+    {
+      const Node* n=slot->get();
+      if(key<n->data.first)
+      {
+        slot=&makeUnique(*slot)->left;
+      }
+      else if(n->data.first<key)
+      {
+        slot=&makeUnique(*slot)->right;
+      }
+      else
+      {
+        return makeUnique(*slot);
+      }
+    }
+    return nullptr;
+  }
+
+  // The key must be present: every node on the way is made unique.
+  static void removeNode(NodePtr& slot, const key_type& key)
+  {
+    if(key<slot->data.first)
+    {
+      removeNode(makeUnique(slot)->left,key);
+      return;
+    }
+    if(slot->data.first<key)
+    {
+      removeNode(makeUnique(slot)->right,key);
+      return;
+    }
+    Node* n=makeUnique(slot);
+    if(!n->left)
+    {
+      slot=n->right;
+    }
+    else if(!n->right)
+    {
+      slot=n->left;
+    }
+    else if(n->left->priority>n->right->priority)
+    {
+      makeUnique(n->left);
+      rotateRight(slot);
+      removeNode(slot->right,key);
+    }
+    else
+    {
+      makeUnique(n->right);
+      rotateLeft(slot);
+      removeNode(slot->left,key);
+    }
+  }
+
+  static const Node* findNode(const Node* n, const key_type& key)
+  {
+    while(n!=nullptr)
+    {
+      if(key<n->data.first)
+      {
+        n=n->left.get();
+      }
+      else if(n->data.first<key)
+      {
+        n=n->right.get();
+      }
+      else
+      {
+        break;
+      }
+    }
+    return n;
+  }
+
+public:
+  PersistentTreeMap()
+  : root(), numOfNodes(0), seed(2463534242u)
+  {}
+
+  PersistentTreeMap(std::initializer_list<value_type> list)
+  : PersistentTreeMap()
+  {
+    for(auto it=list.begin(); it!=list.end(); it++)
+    {
+      insert(root,it->first,it->second);
+    }
+  }
+
+  PersistentTreeMap(const PersistentTreeMap& other) = default;
+
+  PersistentTreeMap(PersistentTreeMap&& other)
+  : root(std::move(other.root)), numOfNodes(other.numOfNodes), seed(other.seed)
+  {
+    other.numOfNodes=0;
+  }
+
+  PersistentTreeMap& operator=(const PersistentTreeMap& other) = default;
+
+  PersistentTreeMap& operator=(PersistentTreeMap&& other)
+  {
+    if(this!=&other)
+    {
+      root=std::move(other.root);
+      numOfNodes=other.numOfNodes;
+      seed=other.seed;
+      other.numOfNodes=0;
+    }
+    return *this;
+  }
+
+  // O(1): the returned map shares every node with this one until either of
+  // them is updated.
+  PersistentTreeMap snapshot() const
+  {
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    if(numOfNodes)
+    {
+      return false;
+    }
+    return true;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    Node* n=findUnique(key);
+    if(n==nullptr)
+    {
+      n=insert(root,key,mapped_type());
+    }
+    return n->data.second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(!root)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    const Node* n=findNode(root.get(),key);
+    if(n==nullptr)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return n->data.second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    if(!root)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    if(findNode(root.get(),key)==nullptr)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return findUnique(key)->data.second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    ConstIterator it(this);
+    const Node* n=root.get();
+    while(n!=nullptr)
+    {
+      it.path.push_back(n);
+      if(key<n->data.first)
+      {
+        n=n->left.get();
+      }
+      else if(n->data.first<key)
+      {
+        n=n->right.get();
+      }
+      else
+      {
+        return it;
+      }
+    }
+    return end();
+  }
+
+  void remove(const key_type& key)
+  {
+    if(!root)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    if(findNode(root.get(),key)==nullptr)
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    removeNode(root,key);
+    numOfNodes--;
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(!root)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    if(it==cend())
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    remove(it->first);
+  }
+
+  size_type getSize() const
+  {
+    return numOfNodes;
+  }
+
+  bool operator==(const PersistentTreeMap& other) const
+  {
+    if(this->numOfNodes!=other.numOfNodes)
+    {
+      return false;
+    }
+    if(this->root==other.root)
+    {
+      return true;
+    }
+    for(auto it=begin(), otherIt=other.begin(); it!=end(); ++it, ++otherIt)
+    {
+      if(!(it->first==otherIt->first) || it->second!=otherIt->second)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const PersistentTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  const_iterator cbegin() const
+  {
+    ConstIterator it(this);
+    for(const Node* n=root.get(); n!=nullptr; n=n->left.get())
+    {
+      it.path.push_back(n);
+    }
+    return it;
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+// Nodes have no parent pointers (they are shared between versions), so the
+// iterator keeps the path from the root to the current node.
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap<KeyType, ValueType>::ConstIterator
+{
+  friend class PersistentTreeMap;
+
+  const PersistentTreeMap* treePtr;
+  std::vector<const Node*> path;
+public:
+  using reference = typename PersistentTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename PersistentTreeMap::value_type;
+  using pointer = const typename PersistentTreeMap::value_type*;
+
+  explicit ConstIterator(const PersistentTreeMap* t)
+  : treePtr(t), path()
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(path.empty())
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    const Node* n=path.back();
+    if(n->right)
+    {
+      for(n=n->right.get(); n!=nullptr; n=n->left.get())
+      {
+        path.push_back(n);
+      }
+    }
+    else
+    {
+      path.pop_back();
+      while(!path.empty() && path.back()->right.get()==n)
+      {
+        n=path.back();
+        path.pop_back();
+      }
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(path.empty())
+    {
+      if(!treePtr->root)
+      {
+        throw std::out_of_range("Cannot decrement");
+      }
+      for(const Node* n=treePtr->root.get(); n!=nullptr; n=n->right.get())
+      {
+        path.push_back(n);
+      }
+      return *this;
+    }
+    const Node* n=path.back();
+    if(n->left)
+    {
+      for(n=n->left.get(); n!=nullptr; n=n->right.get())
+      {
+        path.push_back(n);
+      }
+      return *this;
+    }
+    std::vector<const Node*> saved(path);
+    path.pop_back();
+    while(!path.empty() && path.back()->left.get()==n)
+    {
+      n=path.back();
+      path.pop_back();
+    }
+    if(path.empty())
+    {
+      path.swap(saved);
+      throw std::out_of_range("Cannot decrement");
+    }
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(path.empty())
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return path.back()->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    if(treePtr!=other.treePtr)
+    {
+      return false;
+    }
+    if(path.empty() || other.path.empty())
+    {
+      return path.empty() && other.path.empty();
+    }
+    return path.back()==other.path.back();
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_PERSISTENTTREEMAP_H */
@@ -0,0 +1,1156 @@
+#ifndef AISDI_MAPS_RADIXTREEMAP_H
+#define AISDI_MAPS_RADIXTREEMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aisdi
+{
+
+// Ordered map from strings, stored as an adaptive radix tree: every inner
+// node branches on one byte of the key and comes in four sizes (4, 16, 48 and
+// 256 children), growing and shrinking with its fan-out. Runs of bytes with a
+// single child are kept as a prefix of the next inner node (path compression),
+// so a lookup costs O(key length) whatever the number of keys, and each byte
+// of the key is looked at once.
+//
+// Keys are ordered byte-wise as unsigned chars, like std::string::compare.
+// A key that is a prefix of other keys is kept in the inner node where it
+// ends. Leaves are threaded into an in-order list, so iteration does not
+// touch inner nodes.
+template <typename ValueType>
+class RadixTreeMap
+{
+public:
+  using key_type = std::string;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  enum NodeType : std::uint8_t
+  {
+    LeafNode,
+    Inner4,
+    Inner16,
+    Inner48,
+    Inner256
+  };
+
+  struct Node
+  {
+    NodeType type;
+
+    explicit Node(NodeType t)
+    : type(t) {}
+  };
+
+  struct Leaf : Node
+  {
+    value_type data;
+    Leaf* prev;
+    Leaf* next;
+
+    Leaf(const key_type& k, const mapped_type& m)
+    : Node(LeafNode), data(k,m), prev(nullptr), next(nullptr) {}
+  };
+
+  struct Inner : Node
+  {
+    std::string prefix;
+    // entry whose key ends at this node
+    Leaf* terminal;
+    unsigned count;
+
+    explicit Inner(NodeType t)
+    : Node(t), prefix(), terminal(nullptr), count(0) {}
+  };
+
+  // Children of Node4 and Node16 are sorted by their byte.
+  struct Node4 : Inner
+  {
+    unsigned char keys[4];
+    Node* children[4];
+
+    Node4()
+    : Inner(Inner4) {}
+  };
+
+  struct Node16 : Inner
+  {
+    unsigned char keys[16];
+    Node* children[16];
+
+    Node16()
+    : Inner(Inner16) {}
+  };
+
+  // index[b] is one more than the slot of the child for byte b, 0 if none.
+  struct Node48 : Inner
+  {
+    unsigned char index[256];
+    Node* children[48];
+
+    Node48()
+    : Inner(Inner48)
+    {
+      std::memset(index,0,sizeof(index));
+      std::memset(children,0,sizeof(children));
+    }
+  };
+
+  struct Node256 : Inner
+  {
+    Node* children[256];
+
+    Node256()
+    : Inner(Inner256)
+    {
+      std::memset(children,0,sizeof(children));
+    }
+  };
+
+  Node* root;
+  Leaf* first;
+  Leaf* last;
+  size_type numOfNodes;
+
+  static void destroy(Node* n)
+  {
+    switch(n->type)
+    {
+    case LeafNode:
+      delete static_cast<Leaf*>(n);
+      break;
+    case Inner4:
+      delete static_cast<Node4*>(n);
+      break;
+    case Inner16:
+      delete static_cast<Node16*>(n);
+      break;
+    case Inner48:
+      delete static_cast<Node48*>(n);
+      break;
+    case Inner256:
+      delete static_cast<Node256*>(n);
+      break;
+    }
+  }
+
+  static Node** findChild(Inner* n, unsigned char b)
+  {
+    switch(n->type)
+    {
+    case Inner4:
+    {
+      Node4* n4=static_cast<Node4*>(n);
+      for(unsigned i=0; i<n4->count; i++)
+      {
+        if(n4->keys[i]==b)
+        {
+          return &n4->children[i];
+        }
+      }
+      return nullptr;
+    }
+    case Inner16:
+    {
+      Node16* n16=static_cast<Node16*>(n);
+#if defined(__SSE2__)
+      __m128i cmp=_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys)));
+      unsigned mask=static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1u<<n16->count)-1);
+      return mask!=0 ? &n16->children[__builtin_ctz(mask)] : nullptr;
+#else
+      for(unsigned i=0; i<n16->count; i++)
+      {
+        if(n16->keys[i]==b)
+        {
+          return &n16->children[i];
+        }
+      }
+      return nullptr;
+#endif
+    }
+    case Inner48:
+    {
+      Node48* n48=static_cast<Node48*>(n);
+      return n48->index[b]!=0 ? &n48->children[n48->index[b]-1] : nullptr;
+    }
+    case Inner256:
+    {
+      Node256* n256=static_cast<Node256*>(n);
+      return n256->children[b]!=nullptr ? &n256->children[b] : nullptr;
+    }
+    default:
+      return nullptr;
+    }
+  }
+
+  // Child with the smallest byte greater than after (-1 for the first one),
+  // or nullptr; its byte is stored in byte.
+  static Node* nextChild(const Inner* n, int after, int& byte)
+  {
+    switch(n->type)
+    {
+    case Inner4:
+    case Inner16:
+    {
+      const unsigned char* keys=(n->type==Inner4 ? static_cast<const Node4*>(n)->keys
+                                                 : static_cast<const Node16*>(n)->keys);
+      Node* const* children=(n->type==Inner4 ? static_cast<const Node4*>(n)->children
+                                             : static_cast<const Node16*>(n)->children);
+      for(unsigned i=0; i<n->count; i++)
+      {
+        if(keys[i]>after)
+        {
+          byte=keys[i];
+          return children[i];
+        }
+      }
+      return nullptr;
+    }
+    case Inner48:
+    {
+      const Node48* n48=static_cast<const Node48*>(n);
+      for(int b=after+1; b<256; b++)
+      {
+        if(n48->index[b]!=0)
+        {
+          byte=b;
+          return n48->children[n48->index[b]-1];
+        }
+      }
+      return nullptr;
+    }
+    case Inner256:
+    {
+      const Node256* n256=static_cast<const Node256*>(n);
+      for(int b=after+1; b<256; b++)
+      {
+        if(n256->children[b]!=nullptr)
+        {
+          byte=b;
+          return n256->children[b];
+        }
+      }
+      return nullptr;
+    }
+    default:
+      return nullptr;
+    }
+  }
+
+  static void moveHeader(Inner* to, Inner* from)
+  {
+    to->prefix=std::move(from->prefix);
+    to->terminal=from->terminal;
+    to->count=from->count;
+  }
+
+  // Replaces the full node in *slot by the next larger kind.
+  static void grow(Node** slot)
+  {
+    Inner* n=static_cast<Inner*>(*slot);
+    Inner* bigger;
+    if(n->type==Inner4)
+    {
+      Node4* n4=static_cast<Node4*>(n);
+      Node16* n16=new Node16();
+      std::memcpy(n16->keys,n4->keys,sizeof(n4->keys));
+      std::memcpy(n16->children,n4->children,sizeof(n4->children));
+      bigger=n16;
+    }
+    else if(n->type==Inner16)
+    {
+      Node16* n16=static_cast<Node16*>(n);
+      Node48* n48=new Node48();
+      for(unsigned i=0; i<16; i++)
+      {
+        n48->index[n16->keys[i]]=static_cast<unsigned char>(i+1);
+        n48->children[i]=n16->children[i];
+      }
+      bigger=n48;
+    }
+    else
+    {
+      Node48* n48=static_cast<Node48*>(n);
+      Node256* n256=new Node256();
+      for(int b=0; b<256; b++)
+      {
+        if(n48->index[b]!=0)
+        {
+          n256->children[b]=n48->children[n48->index[b]-1];
+        }
+      }
+      bigger=n256;
+    }
+    moveHeader(bigger,n);
+    destroy(n);
+    *slot=bigger;
+  }
+
+  // Replaces the node in *slot by the next smaller kind once it is sparse
+  // enough; the thresholds leave room so that a node does not flip back and
+  // forth on alternating inserts and removals.
+  static void shrink(Node** slot)
+  {
+    Inner* n=static_cast<Inner*>(*slot);
+    Inner* smaller;
+    if(n->type==Inner16 && n->count<=3)
+    {
+      Node16* n16=static_cast<Node16*>(n);
+      Node4* n4=new Node4();
+      std::memcpy(n4->keys,n16->keys,n16->count);
+      std::memcpy(n4->children,n16->children,n16->count*sizeof(Node*));
+      smaller=n4;
+    }
+    else if(n->type==Inner48 && n->count<=12)
+    {
+      Node48* n48=static_cast<Node48*>(n);
+      Node16* n16=new Node16();
+      unsigned i=0;
+      for(int b=0; b<256; b++)
+      {
+        if(n48->index[b]!=0)
+        {
+          n16->keys[i]=static_cast<unsigned char>(b);
+          n16->children[i++]=n48->children[n48->index[b]-1];
+        }
+      }
+      smaller=n16;
+    }
+    else if(n->type==Inner256 && n->count<=36)
+    {
+      Node256* n256=static_cast<Node256*>(n);
+      Node48* n48=new Node48();
+      unsigned i=0;
+      for(int b=0; b<256; b++)
+      {
+        if(n256->children[b]!=nullptr)
+        {
+          n48->index[b]=static_cast<unsigned char>(i+1);
+          n48->children[i++]=n256->children[b];
+        }
+      }
+      smaller=n48;
+    }
+    else
+    {
+      return;
+    }
+    moveHeader(smaller,n);
+    destroy(n);
+    *slot=smaller;
+  }
+
+  static void addChild(Node** slot, unsigned char b, Node* child)
+  {
+    Inner* n=static_cast<Inner*>(*slot);
+    if((n->type==Inner4 && n->count==4) || (n->type==Inner16 && n->count==16)
+       || (n->type==Inner48 && n->count==48))
+    {
+      grow(slot);
+      n=static_cast<Inner*>(*slot);
+    }
+    if(n->type==Inner4 || n->type==Inner16)
+    {
+      unsigned char* keys=(n->type==Inner4 ? static_cast<Node4*>(n)->keys
+                                           : static_cast<Node16*>(n)->keys);
+      Node** children=(n->type==Inner4 ? static_cast<Node4*>(n)->children
+                                       : static_cast<Node16*>(n)->children);
+      unsigned pos=n->count;
+      while(pos>0 && keys[pos-1]>b)
+      {
+        keys[pos]=keys[pos-1];
+        children[pos]=children[pos-1];
+        pos--;
+      }
+      keys[pos]=b;
+      children[pos]=child;
+    }
+    else if(n->type==Inner48)
+    {
+      Node48* n48=static_cast<Node48*>(n);
+      unsigned pos=0;
+      while(n48->children[pos]!=nullptr)
+      {
+        pos++;
+      }
+      n48->children[pos]=child;
+      n48->index[b]=static_cast<unsigned char>(pos+1);
+    }
+    else
+    {
+      static_cast<Node256*>(n)->children[b]=child;
+    }
+    n->count++;
+  }
+
+  // An inner node left with a single entry is replaced by it; a single inner
+  // child takes over the node's prefix and branch byte.
+  static void collapse(Node** slot)
+  {
+    Inner* n=static_cast<Inner*>(*slot);
+    if(n->count==0 && n->terminal!=nullptr)
+    {
+      *slot=n->terminal;
+      destroy(n);
+    }
+    else if(n->count==1 && n->terminal==nullptr)
+    {
+      int byte=0;
+      Node* child=nextChild(n,-1,byte);
+      if(child->type!=LeafNode)
+      {
+        Inner* in=static_cast<Inner*>(child);
+        n->prefix.push_back(static_cast<char>(byte));
+        n->prefix+=in->prefix;
+        in->prefix=std::move(n->prefix);
+      }
+      *slot=child;
+      destroy(n);
+    }
+  }
+
+  static void removeChild(Node** slot, unsigned char b)
+  {
+    Inner* n=static_cast<Inner*>(*slot);
+    if(n->type==Inner4 || n->type==Inner16)
+    {
+      unsigned char* keys=(n->type==Inner4 ? static_cast<Node4*>(n)->keys
+                                           : static_cast<Node16*>(n)->keys);
+      Node** children=(n->type==Inner4 ? static_cast<Node4*>(n)->children
+                                       : static_cast<Node16*>(n)->children);
+      unsigned pos=0;
+      while(keys[pos]!=b)
+      {
+        pos++;
+      }
+      for(; pos+1<n->count; pos++)
+      {
+        keys[pos]=keys[pos+1];
+        children[pos]=children[pos+1];
+      }
+    }
+    else if(n->type==Inner48)
+    {
+      Node48* n48=static_cast<Node48*>(n);
+      n48->children[n48->index[b]-1]=nullptr;
+      n48->index[b]=0;
+    }
+    else
+    {
+      static_cast<Node256*>(n)->children[b]=nullptr;
+    }
+    n->count--;
+    shrink(slot);
+    collapse(slot);
+  }
+
+  // Hangs leaf below the fresh node n: as its terminal if the key ends at
+  // depth, otherwise on the key's byte at depth.
+  static void place(Node** slot, Leaf* leaf, size_type depth)
+  {
+    if(leaf->data.first.size()==depth)
+    {
+      static_cast<Inner*>(*slot)->terminal=leaf;
+    }
+    else
+    {
+      addChild(slot,static_cast<unsigned char>(leaf->data.first[depth]),leaf);
+    }
+  }
+
+  static Leaf* minimum(Node* n)
+  {
+    while(n!=nullptr && n->type!=LeafNode)
+    {
+      Inner* in=static_cast<Inner*>(n);
+      if(in->terminal!=nullptr)
+      {
+        return in->terminal;
+      }
+      int byte=0;
+      n=nextChild(in,-1,byte);
+    }
+    return static_cast<Leaf*>(n);
+  }
+
+  Leaf* findLeaf(const key_type& key) const
+  {
+    Node* n=root;
+    size_type depth=0;
+    while(n!=nullptr)
+    {
+      if(n->type==LeafNode)
+      {
+        Leaf* leaf=static_cast<Leaf*>(n);
+        return leaf->data.first==key ? leaf : nullptr;
+      }
+      Inner* in=static_cast<Inner*>(n);
+      if(key.compare(depth,in->prefix.size(),in->prefix)!=0)
+      {
+        return nullptr;
+      }
+      depth+=in->prefix.size();
+      if(depth==key.size())
+      {
+        return in->terminal;
+      }
+      Node** child=findChild(in,static_cast<unsigned char>(key[depth]));
+      n=(child!=nullptr ? *child : nullptr);
+      depth++;
+    }
+    return nullptr;
+  }
+
+  // First leaf with key greater than (strict) or not less than the given one.
+  // While descending it remembers the nearest subtree lying entirely above
+  // the key, whose minimum is the answer once the key's path runs out.
+  Leaf* seek(const key_type& key, bool strict) const
+  {
+    Node* n=root;
+    Node* above=nullptr;
+    size_type depth=0;
+    while(n!=nullptr)
+    {
+      if(n->type==LeafNode)
+      {
+        Leaf* leaf=static_cast<Leaf*>(n);
+        int order=leaf->data.first.compare(key);
+        if(order>0 || (order==0 && !strict))
+        {
+          return leaf;
+        }
+        break;
+      }
+      Inner* in=static_cast<Inner*>(n);
+      int order=key.compare(depth,in->prefix.size(),in->prefix);
+      if(order<0)
+      {
+        return minimum(in);
+      }
+      if(order>0)
+      {
+        break;
+      }
+      depth+=in->prefix.size();
+      int byte=0;
+      if(depth==key.size())
+      {
+        if(in->terminal!=nullptr && !strict)
+        {
+          return in->terminal;
+        }
+        Node* firstChild=nextChild(in,-1,byte);
+        if(firstChild!=nullptr)
+        {
+          return minimum(firstChild);
+        }
+        break;
+      }
+      unsigned char b=static_cast<unsigned char>(key[depth]);
+      Node* sibling=nextChild(in,b,byte);
+      if(sibling!=nullptr)
+      {
+        above=sibling;
+      }
+      Node** child=findChild(in,b);
+      n=(child!=nullptr ? *child : nullptr);
+      depth++;
+    }
+    return minimum(above);
+  }
+
+  void linkLeaf(Leaf* leaf)
+  {
+    Leaf* succ=seek(leaf->data.first,true);
+    Leaf* pred=(succ!=nullptr ? succ->prev : last);
+    leaf->prev=pred;
+    leaf->next=succ;
+    if(pred!=nullptr)
+    {
+      pred->next=leaf;
+    }
+    else
+    {
+      first=leaf;
+    }
+    if(succ!=nullptr)
+    {
+      succ->prev=leaf;
+    }
+    else
+    {
+      last=leaf;
+    }
+  }
+
+  void unlinkLeaf(Leaf* leaf)
+  {
+    if(leaf->prev!=nullptr)
+    {
+      leaf->prev->next=leaf->next;
+    }
+    else
+    {
+      first=leaf->next;
+    }
+    if(leaf->next!=nullptr)
+    {
+      leaf->next->prev=leaf->prev;
+    }
+    else
+    {
+      last=leaf->prev;
+    }
+  }
+
+  // Returns the leaf for key, adding one with the given value if there is none.
+  Leaf* insert(const key_type& key, const mapped_type& value)
+  {
+    Node** slot=&root;
+    size_type depth=0;
+    Leaf* leaf;
+    while(true)
+    {
+      Node* n=*slot;
+      if(n==nullptr)
+      {
+        leaf=new Leaf(key,value);
+        *slot=leaf;
+        break;
+      }
+      if(n->type==LeafNode)
+      {
+        Leaf* other=static_cast<Leaf*>(n);
+        const key_type& otherKey=other->data.first;
+        if(otherKey==key)
+        {
+          return other;
+        }
+        size_type common=0;
+        while(depth+common<key.size() && depth+common<otherKey.size()
+              && key[depth+common]==otherKey[depth+common])
+        {
+          common++;
+        }
+        leaf=new Leaf(key,value);
+        Node* split=new Node4();
+        static_cast<Inner*>(split)->prefix=key.substr(depth,common);
+        place(&split,other,depth+common);
+        place(&split,leaf,depth+common);
+        *slot=split;
+        break;
+      }
+      Inner* in=static_cast<Inner*>(n);
+      size_type common=0;
+      while(common<in->prefix.size() && depth+common<key.size()
+            && key[depth+common]==in->prefix[common])
+      {
+        common++;
+      }
+      if(common<in->prefix.size())
+      {
+        leaf=new Leaf(key,value);
+        Node* split=new Node4();
+        static_cast<Inner*>(split)->prefix=in->prefix.substr(0,common);
+        unsigned char b=static_cast<unsigned char>(in->prefix[common]);
+        in->prefix.erase(0,common+1);
+        addChild(&split,b,in);
+        place(&split,leaf,depth+common);
+        *slot=split;
+        break;
+      }
+      depth+=common;
+      if(depth==key.size())
+      {
+        if(in->terminal!=nullptr)
+        {
+          return in->terminal;
+        }
+        leaf=new Leaf(key,value);
+        in->terminal=leaf;
+        break;
+      }
+      unsigned char b=static_cast<unsigned char>(key[depth]);
+      Node** child=findChild(in,b);
+      if(child==nullptr)
+      {
+        leaf=new Leaf(key,value);
+        addChild(slot,b,leaf);
+        break;
+      }
+      slot=child;
+      depth++;
+    }
+    linkLeaf(leaf);
+    numOfNodes++;
+    return leaf;
+  }
+
+  // Detaches the leaf for key from the tree and returns it, or nullptr.
+  Leaf* detach(const key_type& key)
+  {
+    Node** slot=&root;
+    Node** parentSlot=nullptr;
+    unsigned char parentByte=0;
+    size_type depth=0;
+    while(*slot!=nullptr)
+    {
+      Node* n=*slot;
+      if(n->type==LeafNode)
+      {
+        Leaf* leaf=static_cast<Leaf*>(n);
+        if(leaf->data.first!=key)
+        {
+          return nullptr;
+        }
+        if(parentSlot==nullptr)
+        {
+          root=nullptr;
+        }
+        else
+        {
+          removeChild(parentSlot,parentByte);
+        }
+        return leaf;
+      }
+      Inner* in=static_cast<Inner*>(n);
+      if(key.compare(depth,in->prefix.size(),in->prefix)!=0)
+      {
+        return nullptr;
+      }
+      depth+=in->prefix.size();
+      if(depth==key.size())
+      {
+        Leaf* leaf=in->terminal;
+        if(leaf!=nullptr)
+        {
+          in->terminal=nullptr;
+          collapse(slot);
+        }
+        return leaf;
+      }
+      unsigned char b=static_cast<unsigned char>(key[depth]);
+      Node** child=findChild(in,b);
+      if(child==nullptr)
+      {
+        return nullptr;
+      }
+      parentSlot=slot;
+      parentByte=b;
+      slot=child;
+      depth++;
+    }
+    return nullptr;
+  }
+
+  void deleteTree()
+  {
+    std::vector<Node*> stack;
+    if(root!=nullptr && root->type!=LeafNode)
+    {
+      stack.push_back(root);
+    }
+    while(!stack.empty())
+    {
+      Inner* in=static_cast<Inner*>(stack.back());
+      stack.pop_back();
+      int byte=-1;
+      for(Node* child=nextChild(in,byte,byte); child!=nullptr; child=nextChild(in,byte,byte))
+      {
+        if(child->type!=LeafNode)
+        {
+          stack.push_back(child);
+        }
+      }
+      destroy(in);
+    }
+    Leaf* leaf=first;
+    while(leaf!=nullptr)
+    {
+      Leaf* nextLeaf=leaf->next;
+      destroy(leaf);
+      leaf=nextLeaf;
+    }
+    root=nullptr;
+    first=nullptr;
+    last=nullptr;
+    numOfNodes=0;
+  }
+
+public:
+  RadixTreeMap()
+  : root(nullptr), first(nullptr), last(nullptr), numOfNodes(0)
+  {}
+
+  RadixTreeMap(std::initializer_list<value_type> list)
+  : RadixTreeMap()
+  {
+    for(auto it=list.begin(); it!=list.end(); it++)
+    {
+      insert(it->first,it->second);
+    }
+  }
+
+  RadixTreeMap(const RadixTreeMap& other)
+  : RadixTreeMap()
+  {
+    for(Leaf* leaf=other.first; leaf!=nullptr; leaf=leaf->next)
+    {
+      insert(leaf->data.first,leaf->data.second);
+    }
+  }
+
+  RadixTreeMap(RadixTreeMap&& other)
+  : root(other.root), first(other.first), last(other.last), numOfNodes(other.numOfNodes)
+  {
+    other.root=nullptr;
+    other.first=nullptr;
+    other.last=nullptr;
+    other.numOfNodes=0;
+  }
+
+  ~RadixTreeMap()
+  {
+    deleteTree();
+  }
+
+  RadixTreeMap& operator=(const RadixTreeMap& other)
+  {
+    if(this!=&other)
+    {
+      RadixTreeMap copy(other);
+      *this=std::move(copy);
+    }
+    return *this;
+  }
+
+  RadixTreeMap& operator=(RadixTreeMap&& other)
+  {
+    if(this!=&other)
+    {
+      deleteTree();
+      root=other.root;
+      first=other.first;
+      last=other.last;
+      numOfNodes=other.numOfNodes;
+
+      other.root=nullptr;
+      other.first=nullptr;
+      other.last=nullptr;
+      other.numOfNodes=0;
+    }
+    return *this;
+  }
+
+  bool isEmpty() const
+  {
+    return root==nullptr;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    return insert(key,mapped_type())->data.second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if(root==nullptr)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    Leaf* leaf=findLeaf(key);
+    if(leaf==nullptr)
+    {
+      throw std::out_of_range("No such key");
+    }
+    return leaf->data.second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return const_cast<mapped_type&>(static_cast<const RadixTreeMap*>(this)->valueOf(key));
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return ConstIterator(this,findLeaf(key));
+  }
+
+  iterator find(const key_type& key)
+  {
+    return Iterator(this,findLeaf(key));
+  }
+
+  // First entry with key not less than the given one.
+  const_iterator lowerBound(const key_type& key) const
+  {
+    return ConstIterator(this,seek(key,false));
+  }
+
+  iterator lowerBound(const key_type& key)
+  {
+    return Iterator(this,seek(key,false));
+  }
+
+  // Calls fn for every entry with lo <= key < hi, in key order.
+  template <typename Function>
+  void forEachInRange(const key_type& lo, const key_type& hi, Function fn) const
+  {
+    for(Leaf* leaf=seek(lo,false); leaf!=nullptr && leaf->data.first<hi; leaf=leaf->next)
+    {
+      fn(leaf->data);
+    }
+  }
+
+  void remove(const key_type& key)
+  {
+    if(root==nullptr)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    Leaf* leaf=detach(key);
+    if(leaf==nullptr)
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    unlinkLeaf(leaf);
+    destroy(leaf);
+    numOfNodes--;
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if(root==nullptr)
+    {
+      throw std::out_of_range("Tree is empty");
+    }
+    if(it==cend())
+    {
+      throw std::out_of_range("No key found in tree");
+    }
+    remove(it->first);
+  }
+
+  size_type getSize() const
+  {
+    return numOfNodes;
+  }
+
+  bool operator==(const RadixTreeMap& other) const
+  {
+    if(numOfNodes!=other.numOfNodes)
+    {
+      return false;
+    }
+    for(Leaf* a=first, *b=other.first; a!=nullptr; a=a->next, b=b->next)
+    {
+      if(a->data.first!=b->data.first || a->data.second!=b->data.second)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const RadixTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return Iterator(this,first);
+  }
+
+  iterator end()
+  {
+    return Iterator(this,nullptr);
+  }
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator(this,first);
+  }
+
+  const_iterator cend() const
+  {
+    return ConstIterator(this,nullptr);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+template <typename ValueType>
+class RadixTreeMap<ValueType>::ConstIterator
+{
+  friend class RadixTreeMap;
+
+protected:
+  const RadixTreeMap* treePtr;
+  Leaf* leafPtr;
+public:
+  using reference = typename RadixTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename RadixTreeMap::value_type;
+  using pointer = const typename RadixTreeMap::value_type*;
+
+  explicit ConstIterator(const RadixTreeMap* t, Leaf* l)
+  : treePtr(t), leafPtr(l)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if(leafPtr==nullptr)
+    {
+      throw std::out_of_range("Cannot increment");
+    }
+    leafPtr=leafPtr->next;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator++();
+    return temp;
+  }
+
+  ConstIterator& operator--()
+  {
+    if(treePtr->last==nullptr)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    else if(leafPtr==nullptr)
+    {
+      leafPtr=treePtr->last;
+    }
+    else if(leafPtr->prev==nullptr)
+    {
+      throw std::out_of_range("Cannot decrement");
+    }
+    else
+    {
+      leafPtr=leafPtr->prev;
+    }
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    ConstIterator temp(*this);
+    ConstIterator::operator--();
+    return temp;
+  }
+
+  reference operator*() const
+  {
+    if(leafPtr==nullptr)
+    {
+      throw std::out_of_range("Cannot dereference");
+    }
+    return leafPtr->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return treePtr==other.treePtr && leafPtr==other.leafPtr;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+template <typename ValueType>
+class RadixTreeMap<ValueType>::Iterator : public RadixTreeMap<ValueType>::ConstIterator
+{
+public:
+  using reference = typename RadixTreeMap::reference;
+  using pointer = typename RadixTreeMap::value_type*;
+
+  explicit Iterator(RadixTreeMap* t, Leaf* l)
+  : ConstIterator(t,l)
+  {}
+
+  Iterator(const ConstIterator& other)
+  : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_RADIXTREEMAP_H */
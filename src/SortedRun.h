@@ -0,0 +1,469 @@
+#ifndef AISDI_MAPS_SORTEDRUN_H
+#define AISDI_MAPS_SORTEDRUN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// On-disk format of a sorted run: the entries of an ordered map with
+// integral keys, in map order.
+//
+//   header   "AISR", version byte, varint block size
+//   blocks   u32 entry count, u32 payload length, payload
+//            (an empty block ends the sequence)
+//   index    per block: varint first key, varint offset, varint entry count
+//   trailer  u64 index offset, u64 entry count, u64 block count, "AISR"
+//
+// In a payload the first key is stored whole and every further one as the
+// difference from its predecessor (modulo 2^64, so any order round-trips;
+// ascending keys give small numbers), both as LEB128 varints. A value is
+// its varint byte length followed by the bytes from SortedRunCodec.
+// Fixed-width integers are little-endian. Offsets count from the first
+// byte of the header, so a run can sit anywhere in a larger stream. The
+// blocks can be read front to back from a plain stream; the index and
+// trailer let a seekable stream jump to the block holding a given key.
+struct SortedRunFormat
+{
+  static const std::size_t trailerSize=8+8+8+4;
+  static const std::uint64_t maxPayload=0xffffffffu;
+  static const unsigned char version=1;
+
+  static const char* magic()
+  {
+    return "AISR";
+  }
+
+  static void putVarint(std::string& out, std::uint64_t v)
+  {
+    while(v>=0x80)
+    {
+      out.push_back(static_cast<char>((v&0x7f)|0x80));
+      v>>=7;
+    }
+    out.push_back(static_cast<char>(v));
+  }
+
+  static std::uint64_t getVarint(const char*& p, const char* end)
+  {
+    std::uint64_t v=0;
+    for(unsigned shift=0; shift<64; shift+=7)
+    {
+      if(p==end)
+      {
+        break;
+      }
+      unsigned char byte=static_cast<unsigned char>(*p++);
+      v|=static_cast<std::uint64_t>(byte&0x7f)<<shift;
+      if(!(byte&0x80))
+      {
+        return v;
+      }
+    }
+    throw std::runtime_error("Malformed sorted run");
+  }
+
+  static void putFixed(std::string& out, std::uint64_t v, unsigned bytes)
+  {
+    for(unsigned i=0; i<bytes; i++)
+    {
+      out.push_back(static_cast<char>((v>>(8*i))&0xff));
+    }
+  }
+
+  static std::uint64_t getFixed(const char* p, unsigned bytes)
+  {
+    std::uint64_t v=0;
+    for(unsigned i=0; i<bytes; i++)
+    {
+      v|=static_cast<std::uint64_t>(static_cast<unsigned char>(p[i]))<<(8*i);
+    }
+    return v;
+  }
+
+  static void readExactly(std::istream& in, char* buffer, std::size_t n)
+  {
+    if(n!=0 && !in.read(buffer,static_cast<std::streamsize>(n)))
+    {
+      throw std::runtime_error("Malformed sorted run");
+    }
+  }
+
+  static std::uint64_t readVarint(std::istream& in)
+  {
+    std::uint64_t v=0;
+    for(unsigned shift=0; shift<64; shift+=7)
+    {
+      char byte;
+      readExactly(in,&byte,1);
+      v|=static_cast<std::uint64_t>(static_cast<unsigned char>(byte)&0x7f)<<shift;
+      if(!(static_cast<unsigned char>(byte)&0x80))
+      {
+        return v;
+      }
+    }
+    throw std::runtime_error("Malformed sorted run");
+  }
+};
+
+// Byte representation of values in a sorted run. Specialize it for other
+// value types.
+template <typename T, typename = void>
+struct SortedRunCodec;
+
+template <>
+struct SortedRunCodec<std::string>
+{
+  static void encode(std::string& out, const std::string& v)
+  {
+    out+=v;
+  }
+
+  static std::string decode(const char* p, std::size_t n)
+  {
+    return std::string(p,n);
+  }
+};
+
+// Arithmetic values are stored in host byte order.
+template <typename T>
+struct SortedRunCodec<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+{
+  static void encode(std::string& out, const T& v)
+  {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes,&v,sizeof(T));
+    out.append(bytes,sizeof(T));
+  }
+
+  static T decode(const char* p, std::size_t n)
+  {
+    if(n!=sizeof(T))
+    {
+      throw std::runtime_error("Malformed sorted run");
+    }
+    T v;
+    std::memcpy(&v,p,sizeof(T));
+    return v;
+  }
+};
+
+// Streams entries, which must come in map order, into a sorted run. Works
+// with any output stream, from its current position; nothing is seeked.
+template <typename KeyType, typename ValueType>
+class SortedRunWriter
+{
+  static_assert(std::is_integral<KeyType>::value, "sorted runs need integral keys");
+
+  struct IndexEntry
+  {
+    std::uint64_t firstKey;
+    std::uint64_t offset;
+    std::uint64_t count;
+  };
+
+  std::ostream& out;
+  std::size_t blockSize;
+  std::string block;
+  std::uint64_t blockCount;
+  std::uint64_t blockFirst;
+  std::uint64_t previous;
+  std::uint64_t written;
+  std::uint64_t entries;
+  std::vector<IndexEntry> index;
+
+  void emit(const std::string& bytes)
+  {
+    out.write(bytes.data(),static_cast<std::streamsize>(bytes.size()));
+    written+=bytes.size();
+  }
+
+  void flushBlock()
+  {
+    if(blockCount==0)
+    {
+      return;
+    }
+    index.push_back(IndexEntry{blockFirst,written,blockCount});
+    std::string head;
+    SortedRunFormat::putFixed(head,blockCount,4);
+    SortedRunFormat::putFixed(head,block.size(),4);
+    emit(head);
+    emit(block);
+    block.clear();
+    blockCount=0;
+  }
+
+public:
+  explicit SortedRunWriter(std::ostream& o, std::size_t bytesPerBlock=4096)
+  : out(o), blockSize(bytesPerBlock), block(), blockCount(0), blockFirst(0), previous(0),
+    written(0), entries(0), index()
+  {
+    std::string head(SortedRunFormat::magic(),4);
+    head.push_back(static_cast<char>(SortedRunFormat::version));
+    SortedRunFormat::putVarint(head,blockSize);
+    emit(head);
+  }
+
+  // Throws std::length_error for a value too large for the u32 length of
+  // a block.
+  void add(const KeyType& key, const ValueType& value)
+  {
+    std::string bytes;
+    SortedRunCodec<ValueType>::encode(bytes,value);
+    // room for the key and the length, as varints
+    const std::uint64_t overhead=20;
+    if(bytes.size()>SortedRunFormat::maxPayload-overhead)
+    {
+      throw std::length_error("Value too large for a sorted run");
+    }
+    if(blockCount>0 && block.size()+bytes.size()>SortedRunFormat::maxPayload-overhead)
+    {
+      flushBlock();
+    }
+    std::uint64_t bits=static_cast<std::uint64_t>(key);
+    if(blockCount==0)
+    {
+      blockFirst=bits;
+      SortedRunFormat::putVarint(block,bits);
+    }
+    else
+    {
+      SortedRunFormat::putVarint(block,bits-previous);
+    }
+    previous=bits;
+    SortedRunFormat::putVarint(block,bytes.size());
+    block+=bytes;
+    blockCount++;
+    entries++;
+    if(block.size()>=blockSize)
+    {
+      flushBlock();
+    }
+  }
+
+  void finish()
+  {
+    flushBlock();
+    std::string tail;
+    SortedRunFormat::putFixed(tail,0,4);
+    SortedRunFormat::putFixed(tail,0,4);
+    std::uint64_t indexOffset=written+tail.size();
+    for(const IndexEntry& e : index)
+    {
+      SortedRunFormat::putVarint(tail,e.firstKey);
+      SortedRunFormat::putVarint(tail,e.offset);
+      SortedRunFormat::putVarint(tail,e.count);
+    }
+    SortedRunFormat::putFixed(tail,indexOffset,8);
+    SortedRunFormat::putFixed(tail,entries,8);
+    SortedRunFormat::putFixed(tail,index.size(),8);
+    tail.append(SortedRunFormat::magic(),4);
+    emit(tail);
+    out.flush();
+    if(!out)
+    {
+      throw std::runtime_error("Cannot write sorted run");
+    }
+  }
+};
+
+// Reads a sorted run. readAll() streams through the blocks without needing
+// the index; forEachInRange() uses the index of a seekable stream to start
+// at the block holding lo and stops after the last key below hi.
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+class SortedRunReader
+{
+  static_assert(std::is_integral<KeyType>::value, "sorted runs need integral keys");
+
+  std::istream& in;
+  std::streamoff start;
+  Compare comp;
+  std::vector<KeyType> firstKeys;
+  std::vector<std::uint64_t> offsets;
+  std::uint64_t entries;
+  bool indexed;
+
+  void readHeader()
+  {
+    char head[5];
+    SortedRunFormat::readExactly(in,head,5);
+    if(std::memcmp(head,SortedRunFormat::magic(),4)!=0
+       || static_cast<unsigned char>(head[4])!=SortedRunFormat::version)
+    {
+      throw std::runtime_error("Malformed sorted run");
+    }
+    char byte;
+    do
+    {
+      SortedRunFormat::readExactly(in,&byte,1);
+    } while(static_cast<unsigned char>(byte)&0x80);
+  }
+
+  // The run may be followed by other data, so its end is found by stepping
+  // over the blocks from the header rather than from the end of the stream.
+  void readIndex()
+  {
+    if(start<0)
+    {
+      throw std::runtime_error("Sorted run index needs a seekable stream");
+    }
+    in.clear();
+    in.seekg(start);
+    readHeader();
+    for(;;)
+    {
+      std::uint64_t offset=static_cast<std::uint64_t>(in.tellg()-start);
+      char head[8];
+      SortedRunFormat::readExactly(in,head,8);
+      if(SortedRunFormat::getFixed(head,4)==0)
+      {
+        break;
+      }
+      offsets.push_back(offset);
+      in.seekg(static_cast<std::streamoff>(SortedRunFormat::getFixed(head+4,4)),std::ios::cur);
+    }
+    std::uint64_t indexOffset=static_cast<std::uint64_t>(in.tellg()-start);
+    for(std::size_t i=0; i<offsets.size(); i++)
+    {
+      firstKeys.push_back(static_cast<KeyType>(SortedRunFormat::readVarint(in)));
+      if(SortedRunFormat::readVarint(in)!=offsets[i])
+      {
+        throw std::runtime_error("Malformed sorted run");
+      }
+      SortedRunFormat::readVarint(in);
+    }
+    char trailer[SortedRunFormat::trailerSize];
+    SortedRunFormat::readExactly(in,trailer,SortedRunFormat::trailerSize);
+    if(std::memcmp(trailer+24,SortedRunFormat::magic(),4)!=0
+       || SortedRunFormat::getFixed(trailer,8)!=indexOffset
+       || SortedRunFormat::getFixed(trailer+16,8)!=offsets.size())
+    {
+      throw std::runtime_error("Malformed sorted run");
+    }
+    entries=SortedRunFormat::getFixed(trailer+8,8);
+    indexed=true;
+    in.seekg(start);
+  }
+
+  // Decodes the next block; returns false at the end of the sequence. fn
+  // returns false to stop.
+  template <typename Function>
+  bool readBlock(Function& fn)
+  {
+    char head[8];
+    SortedRunFormat::readExactly(in,head,8);
+    std::uint64_t count=SortedRunFormat::getFixed(head,4);
+    std::uint64_t length=SortedRunFormat::getFixed(head+4,4);
+    if(count==0)
+    {
+      return false;
+    }
+    std::string payload(length,'\0');
+    SortedRunFormat::readExactly(in,&payload[0],payload.size());
+    const char* p=payload.data();
+    const char* end=p+payload.size();
+    std::uint64_t bits=0;
+    for(std::uint64_t i=0; i<count; i++)
+    {
+      std::uint64_t code=SortedRunFormat::getVarint(p,end);
+      bits=(i==0 ? code : bits+code);
+      std::uint64_t size=SortedRunFormat::getVarint(p,end);
+      if(size>static_cast<std::uint64_t>(end-p))
+      {
+        throw std::runtime_error("Malformed sorted run");
+      }
+      ValueType value=SortedRunCodec<ValueType>::decode(p,size);
+      p+=size;
+      if(!fn(static_cast<KeyType>(bits),std::move(value)))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  // The run starts at the current position of the stream.
+  explicit SortedRunReader(std::istream& i, const Compare& c = Compare())
+  : in(i), start(i.tellg()), comp(c), firstKeys(), offsets(), entries(0), indexed(false)
+  {}
+
+  // Number of entries, as recorded in the trailer (needs a seekable stream,
+  // which is left at the start of the run).
+  std::uint64_t getSize()
+  {
+    if(!indexed)
+    {
+      readIndex();
+    }
+    return entries;
+  }
+
+  // Calls fn(key, value) for every entry, front to back, from the current
+  // position of a stream that starts with the header.
+  template <typename Function>
+  void readAll(Function fn)
+  {
+    readHeader();
+    auto each=[&fn](const KeyType& key, ValueType&& value)
+    {
+      fn(key,std::move(value));
+      return true;
+    };
+    while(readBlock(each))
+    {}
+  }
+
+  // Calls fn(key, value) for every entry with lo <= key < hi, reading only
+  // the blocks that may hold such keys. The stream is left at the start of
+  // the run, ready for another range.
+  template <typename Function>
+  void forEachInRange(const KeyType& lo, const KeyType& hi, Function fn)
+  {
+    if(!indexed)
+    {
+      readIndex();
+    }
+    if(!firstKeys.empty())
+    {
+      std::size_t block=std::upper_bound(firstKeys.begin(),firstKeys.end(),lo,comp)-firstKeys.begin();
+      block=(block==0 ? 0 : block-1);
+      in.clear();
+      in.seekg(start+static_cast<std::streamoff>(offsets[block]));
+      const Compare& order=comp;
+      auto each=[&fn, &lo, &hi, &order](const KeyType& key, ValueType&& value)
+      {
+        if(order(key,lo))
+        {
+          return true;
+        }
+        if(!order(key,hi))
+        {
+          return false;
+        }
+        fn(key,std::move(value));
+        return true;
+      };
+      while(readBlock(each))
+      {}
+    }
+    in.clear();
+    in.seekg(start);
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_SORTEDRUN_H */
@@ -0,0 +1,303 @@
+#ifndef AISDI_MAPS_TRACE_H
+#define AISDI_MAPS_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "SortedRun.h"
+
+namespace aisdi
+{
+
+// One operation on a traced map. size is the byte size of the value put or
+// found (0 for a miss or a remove) or the number of entries a scan asked
+// for; time is in nanoseconds since the trace was started.
+struct TraceRecord
+{
+  enum Operation { Get, Put, Remove, Scan };
+
+  Operation operation;
+  std::uint64_t key;
+  std::uint64_t size;
+  std::uint64_t time;
+};
+
+// On-disk format of an operation trace:
+//
+//   header   "AIST", version byte
+//   records  operation byte, u64 key, varint size, varint nanoseconds
+//            since the previous record
+//
+// The trace ends with the stream. Integers are encoded as in a sorted run
+// (see SortedRun.h), so a typical record takes 11 to 14 bytes.
+struct TraceFormat
+{
+  static const unsigned char version=1;
+
+  static const char* magic()
+  {
+    return "AIST";
+  }
+};
+
+// Byte size of a value as recorded in a trace.
+template <typename T>
+std::uint64_t traceSizeOf(const T&)
+{
+  return sizeof(T);
+}
+
+inline std::uint64_t traceSizeOf(const std::string& value)
+{
+  return value.size();
+}
+
+// Appends records to a stream, buffered; everything is written out by
+// flush() or on destruction.
+class TraceWriter
+{
+  using clock = std::chrono::steady_clock;
+
+  std::ostream& out;
+  clock::time_point start;
+  std::uint64_t previous;
+  std::uint64_t count;
+  std::string buffer;
+
+public:
+  explicit TraceWriter(std::ostream& o)
+  : out(o), start(clock::now()), previous(0), count(0), buffer(TraceFormat::magic(),4)
+  {
+    buffer.push_back(static_cast<char>(TraceFormat::version));
+  }
+
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  ~TraceWriter()
+  {
+    try
+    {
+      flush();
+    }
+    catch(const std::runtime_error&)
+    {}
+  }
+
+  // Nanoseconds since the writer was created.
+  std::uint64_t now() const
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now()-start).count();
+  }
+
+  void write(const TraceRecord& r)
+  {
+    buffer.push_back(static_cast<char>(r.operation));
+    SortedRunFormat::putFixed(buffer,r.key,8);
+    SortedRunFormat::putVarint(buffer,r.size);
+    SortedRunFormat::putVarint(buffer,r.time>previous ? r.time-previous : 0);
+    previous=r.time>previous ? r.time : previous;
+    count++;
+    if(buffer.size()>=1<<16)
+    {
+      flush();
+    }
+  }
+
+  void flush()
+  {
+    out.write(buffer.data(),static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+    out.flush();
+    if(!out)
+    {
+      throw std::runtime_error("Cannot write trace");
+    }
+  }
+
+  std::uint64_t getCount() const
+  {
+    return count;
+  }
+};
+
+class TraceReader
+{
+  std::istream& in;
+  std::uint64_t time;
+
+  std::uint64_t readVarint()
+  {
+    std::uint64_t v=0;
+    for(unsigned shift=0; shift<64; shift+=7)
+    {
+      char byte;
+      SortedRunFormat::readExactly(in,&byte,1);
+      v|=static_cast<std::uint64_t>(static_cast<unsigned char>(byte)&0x7f)<<shift;
+      if(!(static_cast<unsigned char>(byte)&0x80))
+      {
+        return v;
+      }
+    }
+    throw std::runtime_error("Malformed trace");
+  }
+
+public:
+  // Reads the header; throws std::runtime_error if it is not a trace.
+  explicit TraceReader(std::istream& i)
+  : in(i), time(0)
+  {
+    char head[5];
+    if(!in.read(head,5) || std::memcmp(head,TraceFormat::magic(),4)!=0
+       || static_cast<unsigned char>(head[4])!=TraceFormat::version)
+    {
+      throw std::runtime_error("Malformed trace");
+    }
+  }
+
+  // Returns false at the end of the trace; a record cut short throws.
+  bool next(TraceRecord& r)
+  {
+    char operation;
+    if(!in.get(operation))
+    {
+      return false;
+    }
+    if(static_cast<unsigned char>(operation)>TraceRecord::Scan)
+    {
+      throw std::runtime_error("Malformed trace");
+    }
+    try
+    {
+      char key[8];
+      SortedRunFormat::readExactly(in,key,8);
+      r.operation=static_cast<TraceRecord::Operation>(operation);
+      r.key=SortedRunFormat::getFixed(key,8);
+      r.size=readVarint();
+      time+=readVarint();
+      r.time=time;
+    }
+    catch(const std::runtime_error&)
+    {
+      throw std::runtime_error("Malformed trace");
+    }
+    return true;
+  }
+
+  std::vector<TraceRecord> readAll()
+  {
+    std::vector<TraceRecord> records;
+    TraceRecord r;
+    while(next(r))
+    {
+      records.push_back(r);
+    }
+    return records;
+  }
+};
+
+// A map with integral keys (a HashMap or TreeMap, say) whose lookups,
+// writes, removes and scans are recorded to a TraceWriter as they are
+// made, for replaying against other maps later. Only the traced
+// operations are offered; base() gives untraced read access.
+template <typename Map>
+class TracedMap
+{
+public:
+  using map_type = Map;
+  using key_type = typename Map::key_type;
+  using mapped_type = typename Map::mapped_type;
+  using size_type = typename Map::size_type;
+  using const_iterator = typename Map::const_iterator;
+
+  static_assert(std::is_integral<key_type>::value, "traces need integral keys");
+
+private:
+  Map map;
+  TraceWriter* trace;
+
+  void record(TraceRecord::Operation operation, const key_type& key, std::uint64_t size,
+              std::uint64_t time) const
+  {
+    trace->write(TraceRecord{operation,static_cast<std::uint64_t>(key),size,time});
+  }
+
+public:
+  template <typename... Args>
+  explicit TracedMap(TraceWriter& writer, Args&&... args)
+  : map(std::forward<Args>(args)...), trace(&writer)
+  {}
+
+  void put(const key_type& key, const mapped_type& value)
+  {
+    record(TraceRecord::Put,key,traceSizeOf(value),trace->now());
+    map[key]=value;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    std::uint64_t time=trace->now();
+    const_iterator it=map.find(key);
+    record(TraceRecord::Get,key,it!=map.end() ? traceSizeOf(it->second) : 0,time);
+    return it;
+  }
+
+  // Throws std::out_of_range if key is missing, as the map does.
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    const_iterator it=find(key);
+    if(it==map.end())
+    {
+      throw std::out_of_range("No key found");
+    }
+    return it->second;
+  }
+
+  void remove(const key_type& key)
+  {
+    record(TraceRecord::Remove,key,0,trace->now());
+    map.remove(key);
+  }
+
+  // Calls fn(key, value) for up to length entries from key start onwards,
+  // in map order; returns how many were visited.
+  template <typename Function>
+  size_type scan(const key_type& start, size_type length, Function fn) const
+  {
+    record(TraceRecord::Scan,start,length,trace->now());
+    size_type n=0;
+    for(const_iterator it=map.find(start); n<length && it!=map.end(); ++it, n++)
+    {
+      fn(it->first,it->second);
+    }
+    return n;
+  }
+
+  size_type getSize() const
+  {
+    return map.getSize();
+  }
+
+  bool isEmpty() const
+  {
+    return map.isEmpty();
+  }
+
+  const Map& base() const
+  {
+    return map;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_TRACE_H */
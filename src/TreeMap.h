@@ -1,17 +1,164 @@
 #ifndef AISDI_MAPS_TREEMAP_H
 #define AISDI_MAPS_TREEMAP_H
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <limits>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 #include <iostream>
-#include <queue>
+
+#include "FrozenTreeMap.h"
+#include "SortedRun.h"
+#include "WorkStealingPool.h"
 
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+// Aggregate policies for TreeMap. A policy is a monoid over mapped values:
+// result_type, identity(), of(value) lifting a single value and an
+// associative combine(a, b) (applied in key order, so it need not commute).
+struct NoAggregate
+{};
+
+template <typename ValueType>
+struct SumAggregate
+{
+  using result_type = ValueType;
+  static result_type identity() { return result_type(); }
+  static result_type of(const ValueType& v) { return v; }
+  static result_type combine(const result_type& a, const result_type& b) { return a+b; }
+};
+
+template <typename ValueType>
+struct MinAggregate
+{
+  using result_type = ValueType;
+  static result_type identity() { return std::numeric_limits<ValueType>::max(); }
+  static result_type of(const ValueType& v) { return v; }
+  static result_type combine(const result_type& a, const result_type& b) { return std::min(a,b); }
+};
+
+template <typename ValueType>
+struct MaxAggregate
+{
+  using result_type = ValueType;
+  static result_type identity() { return std::numeric_limits<ValueType>::lowest(); }
+  static result_type of(const ValueType& v) { return v; }
+  static result_type combine(const result_type& a, const result_type& b) { return std::max(a,b); }
+};
+
+// Per-node storage of the subtree aggregate; empty without a policy.
+template <typename Aggregate>
+struct TreeMapAggregateSlot
+{
+  typename Aggregate::result_type aggregate;
+  bool dirty;
+
+  TreeMapAggregateSlot()
+  : aggregate(Aggregate::identity()), dirty(true) {}
+};
+
+template <>
+struct TreeMapAggregateSlot<NoAggregate>
+{};
+
+template <typename Aggregate>
+struct TreeMapAggregateResult
+{
+  using type = typename Aggregate::result_type;
+};
+
+template <>
+struct TreeMapAggregateResult<NoAggregate>
+{
+  using type = void;
+};
+
+template <typename T>
+struct TreeMapVoid
+{
+  using type = void;
+};
+
+// Three-way comparison for TreeMap, returning a negative number, zero or a
+// positive number. Searches call it once per level. The generic version
+// needs up to two calls of the comparator; a comparator with a member
+// int compare(a, b) const is used directly, and std::less of strings
+// goes through basic_string::compare. Specialize it for other cases.
+template <typename Compare, typename = void>
+struct ThreeWayCompare
+{
+  template <typename Key>
+  static int compare(const Compare& comp, const Key& a, const Key& b)
+  {
+    if(comp(a,b))
+    {
+      return -1;
+    }
+    return comp(b,a) ? 1 : 0;
+  }
+};
+
+template <typename Compare>
+struct ThreeWayCompare<Compare, typename TreeMapVoid<decltype(&Compare::compare)>::type>
+{
+  template <typename Key>
+  static int compare(const Compare& comp, const Key& a, const Key& b)
+  {
+    return comp.compare(a,b);
+  }
+};
+
+template <typename CharT, typename Traits, typename Alloc>
+struct ThreeWayCompare<std::less<std::basic_string<CharT, Traits, Alloc>>, void>
+{
+  using string_type = std::basic_string<CharT, Traits, Alloc>;
+
+  static int compare(const std::less<string_type>&, const string_type& a, const string_type& b)
+  {
+    return a.compare(b);
+  }
+};
+
+// Access policies for TreeMap. StaticAccess leaves the shape alone on
+// lookups; SplayAccess splays every node found or inserted through a
+// non-const map to the root, so frequently used keys stay near the top.
+// ScapegoatAccess removes entries lazily: a removed node stays in the tree
+// as a tombstone (still guiding searches) and is only dropped when a
+// subtree is rebuilt, scapegoat-style, because an insertion went too deep
+// or because tombstones outnumber the entries.
+struct StaticAccess
+{};
+
+struct SplayAccess
+{};
+
+struct ScapegoatAccess
+{};
+
+// Per-node tombstone mark; empty unless removals are lazy.
+template <typename Access>
+struct TreeMapTombstoneSlot
+{};
+
+template <>
+struct TreeMapTombstoneSlot<ScapegoatAccess>
+{
+  bool dead;
+
+  TreeMapTombstoneSlot()
+  : dead(false) {}
+};
+
+template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>,
+          typename Aggregate = NoAggregate, typename Access = StaticAccess>
 class TreeMap
 {
 public:
@@ -19,8 +166,10 @@ public:
   using mapped_type = ValueType;
   using value_type = std::pair<const key_type, mapped_type>;
   using size_type = std::size_t;
+  using key_compare = Compare;
   using reference = value_type&;
   using const_reference = const value_type&;
+  using aggregate_type = typename TreeMapAggregateResult<Aggregate>::type;
 
   class ConstIterator;
   class Iterator;
@@ -28,17 +177,21 @@ public:
   using const_iterator = ConstIterator;
 
 private:
-  struct Node
+  struct Node : TreeMapAggregateSlot<Aggregate>, TreeMapTombstoneSlot<Access>
   {
     value_type data;
     Node* parent;
     Node* left;
     Node* right;
+    Node* prev;
+    Node* next;
 
     Node()
-    : data(std::make_pair(0,0)), parent(nullptr), left(nullptr), right(nullptr) {}
+    : data(std::make_pair(0,0)), parent(nullptr), left(nullptr), right(nullptr),
+      prev(nullptr), next(nullptr) {}
     Node(key_type k, mapped_type m)
-    : data(std::make_pair(k,m)),  parent(nullptr), left(nullptr), right(nullptr) {}
+    : data(std::make_pair(k,m)),  parent(nullptr), left(nullptr), right(nullptr),
+      prev(nullptr), next(nullptr) {}
     Node(value_type v)
     : Node(v.first, v.second) {}
 
@@ -46,7 +199,296 @@ private:
   };
 
   Node* root;
+  Node* first;
+  Node* last;
+  // The live ends of the in-order list (ScapegoatAccess only): tombstones
+  // stay on the list, so first and last may be tombstones.
+  Node* firstLive;
+  Node* lastLive;
+  // Left as unknownSize by split/join. getSize() then counts the entries
+  // once into countedSize, which is atomic as several threads may read a
+  // const map at once, and the next change to the map takes that count over.
   size_type numOfNodes;
+  mutable std::atomic<size_type> countedSize;
+  // Tombstones still in the tree (ScapegoatAccess only).
+  size_type numOfDead;
+  Compare comp;
+
+  static const size_type unknownSize=static_cast<size_type>(-1);
+
+  using aggregated = std::integral_constant<bool, !std::is_same<Aggregate, NoAggregate>::value>;
+  using selfAdjusting = std::integral_constant<bool, std::is_same<Access, SplayAccess>::value>;
+  using lazyDeleting = std::integral_constant<bool, std::is_same<Access, ScapegoatAccess>::value>;
+
+  static_assert(!(aggregated::value && lazyDeleting::value),
+                "Aggregates are not kept over tombstones");
+
+  static bool isDead(const Node* n)
+  {
+    return isDead(n,lazyDeleting());
+  }
+
+  static bool isDead(const Node*, std::false_type)
+  {
+    return false;
+  }
+
+  static bool isDead(const Node* n, std::true_type)
+  {
+    return n->dead;
+  }
+
+  // The in-order list holds the tombstones too, so a key that comes back
+  // needs no search for its live neighbours; walks over it skip them with
+  // these, which never loop without ScapegoatAccess. There are never more
+  // tombstones than entries, so a whole walk stays O(n).
+  static Node* liveFrom(Node* n)
+  {
+    while(n!=nullptr && isDead(n))
+    {
+      n=n->next;
+    }
+    return n;
+  }
+
+  static Node* liveUpTo(Node* n)
+  {
+    while(n!=nullptr && isDead(n))
+    {
+      n=n->prev;
+    }
+    return n;
+  }
+
+  Node* frontNode() const
+  {
+    return lazyDeleting::value ? firstLive : first;
+  }
+
+  Node* backNode() const
+  {
+    return lazyDeleting::value ? lastLive : last;
+  }
+
+  // Only while there are no tombstones.
+  void resetLiveEnds()
+  {
+    firstLive=first;
+    lastLive=last;
+  }
+
+  // Keeps the live ends in place as n (just attached or revived) comes to
+  // life or (just marked) dies.
+  void noteLive(Node* n)
+  {
+    if(firstLive==nullptr || less(n->data.first,firstLive->data.first))
+    {
+      firstLive=n;
+    }
+    if(lastLive==nullptr || less(lastLive->data.first,n->data.first))
+    {
+      lastLive=n;
+    }
+  }
+
+  void noteDead(Node* n)
+  {
+    if(n==firstLive && n==lastLive)
+    {
+      firstLive=nullptr;
+      lastLive=nullptr;
+    }
+    else if(n==firstLive)
+    {
+      firstLive=liveFrom(n->next);
+    }
+    else if(n==lastLive)
+    {
+      lastLive=liveUpTo(n->prev);
+    }
+  }
+
+  bool less(const key_type& a, const key_type& b) const
+  {
+    return comp(a,b);
+  }
+
+  // Before the number of entries changes: takes over a count getSize()
+  // made while the size was unknown.
+  void resolveSize()
+  {
+    if(numOfNodes==unknownSize)
+    {
+      numOfNodes=countedSize.load(std::memory_order_relaxed);
+    }
+  }
+
+  void forgetSize()
+  {
+    numOfNodes=unknownSize;
+    countedSize.store(unknownSize,std::memory_order_relaxed);
+  }
+
+  void takeSize(TreeMap& other)
+  {
+    numOfNodes=other.numOfNodes;
+    countedSize.store(other.countedSize.load(std::memory_order_relaxed),std::memory_order_relaxed);
+  }
+
+  int compareKeys(const key_type& a, const key_type& b) const
+  {
+    return ThreeWayCompare<Compare>::compare(comp,a,b);
+  }
+
+  // Subtree aggregates are maintained lazily: anything that may change a
+  // subtree (including handing out a mutable reference to a value) marks the
+  // node and its ancestors dirty, and aggregate() recomputes only dirty nodes.
+  // Invariant: the ancestors of a dirty node are dirty.
+  void touch(Node* n) const
+  {
+    touch(n,aggregated());
+  }
+
+  void touch(Node*, std::false_type) const
+  {}
+
+  void touch(Node* n, std::true_type) const
+  {
+    while(n!=nullptr && !n->dirty)
+    {
+      n->dirty=true;
+      n=n->parent;
+    }
+  }
+
+  // As touch(), for structural changes below which the invariant may not hold.
+  void touchPath(Node* n) const
+  {
+    touchPath(n,aggregated());
+  }
+
+  void touchPath(Node*, std::false_type) const
+  {}
+
+  void touchPath(Node* n, std::true_type) const
+  {
+    for(; n!=nullptr; n=n->parent)
+    {
+      n->dirty=true;
+    }
+  }
+
+  static aggregate_type subtreeAggregate(const Node* n)
+  {
+    return n!=nullptr ? n->aggregate : Aggregate::identity();
+  }
+
+  // Recomputes every dirty node below (and including) top, children first.
+  static void clean(Node* top)
+  {
+    if(top==nullptr || !top->dirty)
+    {
+      return;
+    }
+    Node* n=top;
+    while(true)
+    {
+      if(n->left!=nullptr && n->left->dirty)
+      {
+        n=n->left;
+        continue;
+      }
+      if(n->right!=nullptr && n->right->dirty)
+      {
+        n=n->right;
+        continue;
+      }
+      n->aggregate=Aggregate::combine(Aggregate::combine(subtreeAggregate(n->left),
+                                                         Aggregate::of(n->data.second)),
+                                      subtreeAggregate(n->right));
+      n->dirty=false;
+      if(n==top)
+      {
+        break;
+      }
+      n=n->parent;
+    }
+  }
+
+  void copyAggregate(Node* dst, const Node* src)
+  {
+    copyAggregate(dst,src,aggregated());
+  }
+
+  void copyAggregate(Node*, const Node*, std::false_type)
+  {}
+
+  void copyAggregate(Node* dst, const Node* src, std::true_type)
+  {
+    dst->aggregate=src->aggregate;
+    dst->dirty=src->dirty;
+  }
+
+  // Keeps the in-order list (prev/next, first/last) consistent after n was
+  // attached as a leaf below parentNode.
+  void linkNode(Node* n, Node* parentNode)
+  {
+    if(parentNode==nullptr)
+    {
+      first=n;
+      last=n;
+    }
+    else if(parentNode->left==n)
+    {
+      n->next=parentNode;
+      n->prev=parentNode->prev;
+      if(parentNode->prev!=nullptr)
+      {
+        parentNode->prev->next=n;
+      }
+      else
+      {
+        first=n;
+      }
+      parentNode->prev=n;
+    }
+    else
+    {
+      n->prev=parentNode;
+      n->next=parentNode->next;
+      if(parentNode->next!=nullptr)
+      {
+        parentNode->next->prev=n;
+      }
+      else
+      {
+        last=n;
+      }
+      parentNode->next=n;
+    }
+  }
+
+  void unlinkNode(Node* n)
+  {
+    if(n->prev!=nullptr)
+    {
+      n->prev->next=n->next;
+    }
+    else
+    {
+      first=n->next;
+    }
+    if(n->next!=nullptr)
+    {
+      n->next->prev=n->prev;
+    }
+    else
+    {
+      last=n->prev;
+    }
+    n->prev=nullptr;
+    n->next=nullptr;
+  }
 
   void insert(Node* n)
   {
@@ -56,7 +498,7 @@ private:
       while(*tmp!=nullptr)
       {
           parentTemp=*tmp;
-          if(n->data.first<(*tmp)->data.first)
+          if(less(n->data.first,(*tmp)->data.first))
           {
               tmp=&((*tmp)->left);
           }
@@ -65,10 +507,300 @@ private:
               tmp=&((*tmp)->right);
           }
       }
-      *tmp=n;
-      (*tmp)->parent=parentTemp;
+      attach(n,parentTemp);
+      return;
+  }
+
+  // Hangs the new leaf n below parentNode (as the root when nullptr), on the
+  // side its key belongs to.
+  void attach(Node* n, Node* parentNode)
+  {
+    if(parentNode==nullptr)
+    {
+      root=n;
+    }
+    else if(less(n->data.first,parentNode->data.first))
+    {
+      parentNode->left=n;
+    }
+    else
+    {
+      parentNode->right=n;
+    }
+    n->parent=parentNode;
+    linkNode(n,parentNode);
+    if(lazyDeleting::value)
+    {
+      noteLive(n);
+    }
+    touch(parentNode);
+    resolveSize();
+    if(numOfNodes!=unknownSize)
+    {
+      numOfNodes++;
+    }
+    rebalance(n,lazyDeleting());
+  }
+
+  void rebalance(Node*, std::false_type)
+  {}
+
+  // Rebuilds the subtree of the lowest ancestor of the new leaf n that is
+  // out of weight balance (a child holding over 2/3 of it) once n lies
+  // deeper than log1.5 of the tree size; such an ancestor then exists.
+  void rebalance(Node* n, std::true_type)
+  {
+    size_type depth=0;
+    for(Node* p=n->parent; p!=nullptr; p=p->parent)
+    {
+      depth++;
+    }
+    const size_type total=getSize()+numOfDead;
+    size_type limit=0;
+    for(double w=1.5; w<=total; w*=1.5)
+    {
+      limit++;
+    }
+    if(depth<=limit)
+    {
+      return;
+    }
+    size_type size=1;
+    for(Node* p=n->parent; p!=nullptr; n=p, p=p->parent)
+    {
+      const size_type whole=size+1+subtreeSize(p->left==n ? p->right : p->left);
+      if(3*size>2*whole)
+      {
+        rebuild(p);
+        return;
+      }
+      size=whole;
+    }
+  }
+
+  static size_type subtreeSize(const Node* top)
+  {
+    size_type size=0;
+    std::vector<const Node*> pending;
+    if(top!=nullptr)
+    {
+      pending.push_back(top);
+    }
+    while(!pending.empty())
+    {
+      const Node* n=pending.back();
+      pending.pop_back();
+      size++;
+      if(n->left!=nullptr)
+      {
+        pending.push_back(n->left);
+      }
+      if(n->right!=nullptr)
+      {
+        pending.push_back(n->right);
+      }
+    }
+    return size;
+  }
+
+  // Relinks the subtree of top into a perfectly balanced one, deleting its
+  // tombstones on the way. The live nodes keep their order, so only the
+  // tombstones are cut out of the in-order list.
+  void rebuild(Node* top)
+  {
+    Node* parentNode=top->parent;
+    Node** hook=&root;
+    if(parentNode!=nullptr)
+    {
+      hook=(parentNode->left==top ? &parentNode->left : &parentNode->right);
+    }
+    std::vector<Node*> live;
+    std::vector<Node*> pending;
+    Node* n=top;
+    while(n!=nullptr || !pending.empty())
+    {
+      for(; n!=nullptr; n=n->left)
+      {
+        pending.push_back(n);
+      }
+      n=pending.back();
+      pending.pop_back();
+      Node* rightNode=n->right;
+      if(isDead(n))
+      {
+        unlinkNode(n);
+        delete n;
+        numOfDead--;
+      }
+      else
+      {
+        live.push_back(n);
+      }
+      n=rightNode;
+    }
+    *hook=linkBalanced(live,0,live.size(),parentNode);
+    touchPath(parentNode);
+  }
+
+  // Drops every tombstone, for the operations that expect none.
+  void purge()
+  {
+    if(numOfDead>0)
+    {
+      rebuild(root);
+    }
+  }
+
+  // Puts the tombstone n back into use.
+  void revive(Node* n)
+  {
+    revive(n,lazyDeleting());
+  }
+
+  void revive(Node*, std::false_type)
+  {}
+
+  void revive(Node* n, std::true_type)
+  {
+    if(!n->dead)
+    {
+      return;
+    }
+    n->dead=false;
+    numOfDead--;
+    noteLive(n);
+    resolveSize();
+    if(numOfNodes!=unknownSize)
+    {
       numOfNodes++;
+    }
+  }
+
+  // Descends from start looking for key. Returns the node holding it, or
+  // nullptr with parentNode set to the leaf the key would be attached to.
+  Node* locate(Node* start, const key_type& key, Node*& parentNode) const
+  {
+    parentNode=nullptr;
+    Node* temp=start;
+    while(temp!=nullptr)
+    {
+      parentNode=temp;
+      const int order=compareKeys(key,temp->data.first);
+      if(order<0)
+      {
+        temp=temp->left;
+      }
+      else if(order>0)
+      {
+        temp=temp->right;
+      }
+      else
+      {
+        return temp;
+      }
+    }
+    return nullptr;
+  }
+
+  // Climbs from x to the lowest ancestor whose subtree spans key, so that a
+  // descent from there finds it (or its place) without starting at the root.
+  Node* climb(Node* x, const key_type& key) const
+  {
+    if(x==nullptr)
+    {
+      return root;
+    }
+    if(less(x->data.first,key))
+    {
+      while(x->parent!=nullptr && !less(key,x->parent->data.first))
+      {
+        x=x->parent;
+      }
+    }
+    else if(less(key,x->data.first))
+    {
+      while(x->parent!=nullptr && !less(x->parent->data.first,key))
+      {
+        x=x->parent;
+      }
+    }
+    return x;
+  }
+
+  // Lifts x above its parent; the in-order list is unaffected.
+  void rotateUp(Node* x)
+  {
+    Node* p=x->parent;
+    Node* g=p->parent;
+    if(p->left==x)
+    {
+      p->left=x->right;
+      if(x->right!=nullptr)
+      {
+        x->right->parent=p;
+      }
+      x->right=p;
+    }
+    else
+    {
+      p->right=x->left;
+      if(x->left!=nullptr)
+      {
+        x->left->parent=p;
+      }
+      x->left=p;
+    }
+    p->parent=x;
+    x->parent=g;
+    if(g==nullptr)
+    {
+      root=x;
+    }
+    else if(g->left==p)
+    {
+      g->left=x;
+    }
+    else
+    {
+      g->right=x;
+    }
+  }
+
+  void access(Node* n)
+  {
+    access(n,selfAdjusting());
+  }
+
+  void access(Node*, std::false_type)
+  {}
+
+  // Bottom-up splay. Every node whose subtree changes was on the path from n
+  // to the root, and afterwards all of them hang below n, so marking that
+  // path dirty up front keeps the aggregate invariant.
+  void access(Node* n, std::true_type)
+  {
+    if(n==nullptr)
+    {
       return;
+    }
+    touchPath(n);
+    while(n->parent!=nullptr)
+    {
+      Node* p=n->parent;
+      Node* g=p->parent;
+      if(g!=nullptr)
+      {
+        if((g->left==p)==(p->left==n))
+        {
+          rotateUp(p);
+        }
+        else
+        {
+          rotateUp(n);
+        }
+      }
+      rotateUp(n);
+    }
   }
 
   void replace(Node* delNode, Node* repNode)
@@ -109,6 +841,32 @@ private:
 
   void removeNode(Node* remNode)
   {
+    removeNode(remNode,lazyDeleting());
+  }
+
+  // Leaves remNode in the tree and the in-order list as a tombstone, holding
+  // a default value; the whole tree is rebuilt once tombstones outnumber the
+  // entries.
+  void removeNode(Node* remNode, std::true_type)
+  {
+    remNode->data.second=mapped_type();
+    remNode->dead=true;
+    noteDead(remNode);
+    numOfDead++;
+    resolveSize();
+    if(numOfNodes!=unknownSize)
+    {
+      numOfNodes--;
+    }
+    if(numOfDead>getSize())
+    {
+      rebuild(root);
+    }
+  }
+
+  void removeNode(Node* remNode, std::false_type)
+  {
+    Node* changed=remNode->parent;
     if(remNode->right==nullptr)
     {
       replace(remNode,remNode->left);
@@ -119,63 +877,288 @@ private:
     }
     else
     {
-      auto tmp=remNode->right;
-      while(tmp->left!=nullptr)
-      {
-        tmp=tmp->left;
-      }
-      replace(tmp,tmp->right);
-      replace(remNode,tmp);
+      auto tmp=remNode->next;
+      changed=(tmp->parent==remNode ? tmp : tmp->parent);
+      replace(tmp,tmp->right);
+      replace(remNode,tmp);
+    }
+    touchPath(changed);
+    unlinkNode(remNode);
+    delete remNode;
+    resolveSize();
+    if(numOfNodes!=unknownSize)
+    {
+      numOfNodes--;
+    }
+  }
+
+Node* findNode(const key_type& key) const
+{
+  Node* temp=root;
+  while(temp!=nullptr)
+  {
+    const int order=compareKeys(key,temp->data.first);
+    if(order>0)
+    {
+      temp=temp->right;
+    }
+    else if(order<0)
+    {
+      temp=temp->left;
+    }
+    else break;
+  }
+  return temp!=nullptr && !isDead(temp) ? temp : nullptr;
+}
+
+  // Copies the shape of the source tree node by node, following parent
+  // pointers back up instead of keeping an explicit stack or queue. Nodes are
+  // threaded into the in-order list as soon as their left subtree is done.
+  void cloneFrom(const TreeMap& other)
+  {
+    numOfNodes=other.getSize();
+    comp=other.comp;
+    if(other.root==nullptr)
+    {
+      return;
+    }
+    if(other.numOfDead>0)
+    {
+      std::vector<Node*> nodes;
+      for(Node* n=other.frontNode(); n!=nullptr; n=liveFrom(n->next))
+      {
+        nodes.push_back(new Node(n->data));
+      }
+      adoptSorted(nodes);
+      return;
+    }
+    root=new Node(other.root->data);
+    copyAggregate(root,other.root);
+    const Node* src=other.root;
+    Node* dst=root;
+    Node* tail=nullptr;
+    while(true)
+    {
+      if(src->left!=nullptr && dst->left==nullptr)
+      {
+        dst->left=new Node(src->left->data);
+        copyAggregate(dst->left,src->left);
+        dst->left->parent=dst;
+        src=src->left;
+        dst=dst->left;
+        continue;
+      }
+      if(dst->right==nullptr)
+      {
+        dst->prev=tail;
+        if(tail!=nullptr)
+        {
+          tail->next=dst;
+        }
+        else
+        {
+          first=dst;
+        }
+        tail=dst;
+      }
+      if(src->right!=nullptr && dst->right==nullptr)
+      {
+        dst->right=new Node(src->right->data);
+        copyAggregate(dst->right,src->right);
+        dst->right->parent=dst;
+        src=src->right;
+        dst=dst->right;
+      }
+      else if(src==other.root)
+      {
+        break;
+      }
+      else
+      {
+        src=src->parent;
+        dst=dst->parent;
+      }
+    }
+    last=tail;
+    resetLiveEnds();
+  }
+
+  // Makes the nodes, already in key order, the contents of this empty map:
+  // threads them and links them into a perfectly balanced tree in O(n),
+  // without comparing keys.
+  void adoptSorted(const std::vector<Node*>& nodes)
+  {
+    for(size_type i=0; i<nodes.size(); i++)
+    {
+      nodes[i]->prev=(i>0 ? nodes[i-1] : nullptr);
+      nodes[i]->next=(i+1<nodes.size() ? nodes[i+1] : nullptr);
+    }
+    if(!nodes.empty())
+    {
+      first=nodes.front();
+      last=nodes.back();
+    }
+    resetLiveEnds();
+    root=linkBalanced(nodes,0,nodes.size(),nullptr);
+    numOfNodes=nodes.size();
+  }
+
+  static Node* linkBalanced(const std::vector<Node*>& nodes, size_type lo, size_type hi, Node* parentNode)
+  {
+    if(lo==hi)
+    {
+      return nullptr;
+    }
+    size_type mid=lo+(hi-lo)/2;
+    Node* n=nodes[mid];
+    n->parent=parentNode;
+    n->left=linkBalanced(nodes,lo,mid,n);
+    n->right=linkBalanced(nodes,mid+1,hi,n);
+    return n;
+  }
+
+  using Emit = std::function<void(const key_type&, mapped_type)>;
+
+  // Builds a map in O(n) from the entries fill hands, in increasing key
+  // order, to the Emit function it is given.
+  template <typename Fill>
+  static TreeMap buildSorted(Fill fill, const Compare& c)
+  {
+    std::vector<Node*> nodes;
+    try
+    {
+      fill(Emit([&nodes, &c](const key_type& key, mapped_type value)
+      {
+        if(!nodes.empty() && !c(nodes.back()->data.first,key))
+        {
+          throw std::runtime_error("Entries out of order");
+        }
+        nodes.push_back(new Node(key,std::move(value)));
+      }));
+    }
+    catch(...)
+    {
+      for(Node* n : nodes)
+      {
+        delete n;
+      }
+      throw;
+    }
+    TreeMap result(c);
+    result.adoptSorted(nodes);
+    return result;
+  }
+
+  // Cuts the in-order list into contiguous ranges for a parallel scan and
+  // returns their first nodes. The cuts are the nodes of the top levels of
+  // the tree, so every range is about a whole subtree; being unbalanced, a
+  // tree built from sorted input splits poorly.
+  std::vector<Node*> scanRanges(unsigned threads) const
+  {
+    std::vector<Node*> starts;
+    Node* front=frontNode();
+    if(front==nullptr)
+    {
+      return starts;
+    }
+    unsigned depth=1;
+    while((1u<<depth)<8*threads && depth<16)
+    {
+      depth++;
+    }
+    starts.push_back(front);
+    collectScanRanges(root,depth,starts);
+    if(starts.size()>1 && starts[1]==front)
+    {
+      starts.erase(starts.begin());
+    }
+    return starts;
+  }
+
+  static void collectScanRanges(Node* n, unsigned depth, std::vector<Node*>& starts)
+  {
+    if(n==nullptr || depth==0)
+    {
+      return;
+    }
+    collectScanRanges(n->left,depth-1,starts);
+    if(!isDead(n))
+    {
+      starts.push_back(n);
     }
-    delete remNode;
-    numOfNodes--;
+    collectScanRanges(n->right,depth-1,starts);
   }
 
-Node* findNode(key_type key) const
-{
-  Node* temp=root;
-  while(temp!=nullptr)
+  // Walks both maps in key order at once, calling left(n) or right(n) for a
+  // key found in one map only and both(n, m) for a key found in both.
+  template <typename Left, typename Right, typename Both>
+  void mergeWalk(const TreeMap& other, Left left, Right right, Both both) const
   {
-    if(key>temp->data.first)
+    const Node* a=frontNode();
+    const Node* b=other.frontNode();
+    while(a!=nullptr && b!=nullptr)
     {
-      temp=temp->right;
+      if(less(a->data.first,b->data.first))
+      {
+        left(a);
+        a=liveFrom(a->next);
+      }
+      else if(less(b->data.first,a->data.first))
+      {
+        right(b);
+        b=liveFrom(b->next);
+      }
+      else
+      {
+        both(a,b);
+        a=liveFrom(a->next);
+        b=liveFrom(b->next);
+      }
     }
-    else if(key<temp->data.first)
+    for(; a!=nullptr; a=liveFrom(a->next))
     {
-      temp=temp->left;
+      left(a);
+    }
+    for(; b!=nullptr; b=liveFrom(b->next))
+    {
+      right(b);
     }
-    else break;
   }
-  return temp;
-}
 
+  static const mapped_type& keepOwn(const mapped_type& own, const mapped_type&)
+  {
+    return own;
+  }
+
+  // Frees the nodes, tombstones included, through the in-order list.
   void deleteTree()
   {
-    if(root!=nullptr)
+    Node* node=first;
+    while(node!=nullptr)
     {
-      std::queue<Node*> q;
-      Node* node;
-
-      q.push(root);
-      while(!q.empty())
-      {
-        node = q.front();
-        q.pop();
-        if(node!=nullptr)
-        {
-          q.push(node->left);
-          q.push(node->right);
-          delete node;
-        }
-      }
+      Node* nextNode=node->next;
+      delete node;
+      node=nextNode;
     }
     root=nullptr;
+    first=nullptr;
+    last=nullptr;
+    resetLiveEnds();
     numOfNodes=0;
+    numOfDead=0;
   }
 
 public:
   TreeMap()
-  : root(nullptr), numOfNodes(0)
+  : root(nullptr), first(nullptr), last(nullptr), firstLive(nullptr), lastLive(nullptr), numOfNodes(0),
+    countedSize(unknownSize), numOfDead(0),
+    comp()
+  {}
+
+  explicit TreeMap(const Compare& c)
+  : root(nullptr), first(nullptr), last(nullptr), firstLive(nullptr), lastLive(nullptr), numOfNodes(0),
+    countedSize(unknownSize), numOfDead(0),
+    comp(c)
   {}
 
   TreeMap(std::initializer_list<value_type> list)
@@ -188,35 +1171,28 @@ public:
   }
 
   TreeMap(const TreeMap& other)
-  : TreeMap()
+  : TreeMap(other.comp)
   {
-    if(other.root!=nullptr)
-    {
-      std::queue<Node*> q;
-      Node* node;
-
-      q.push(other.root);
-      while(!q.empty())
-      {
-        node = q.front();
-        q.pop();
-        if(node!=nullptr)
-        {
-          q.push(node->left);
-          q.push(node->right);
-          insert(new Node(node->data));
-        }
-      }
-    }
+    cloneFrom(other);
   }
 
   TreeMap(TreeMap&& other)
+  : countedSize(unknownSize), comp(other.comp)
   {
     this->root=other.root;
-    this->numOfNodes=other.numOfNodes;
+    this->first=other.first;
+    this->last=other.last;
+    this->firstLive=other.firstLive;
+    this->lastLive=other.lastLive;
+    this->takeSize(other);
+    this->numOfDead=other.numOfDead;
 
     other.root=nullptr;
+    other.first=nullptr;
+    other.last=nullptr;
+    other.resetLiveEnds();
     other.numOfNodes=0;
+    other.numOfDead=0;
   }
 
   ~TreeMap()
@@ -229,24 +1205,7 @@ public:
     if(this!=&other)
     {
       this->deleteTree();
-      if(other.root!=nullptr)
-      {
-        std::queue<Node*> q;
-        Node* node;
-
-        q.push(other.root);
-        while(!q.empty())
-        {
-          node = q.front();
-          q.pop();
-          if(node!=nullptr)
-          {
-            q.push(node->left);
-            q.push(node->right);
-            insert(new Node(node->data));
-          }
-        }
-      }
+      cloneFrom(other);
     }
     return *this;
   }
@@ -257,35 +1216,118 @@ public:
     {
       this->deleteTree();
       this->root=other.root;
-      this->numOfNodes=other.numOfNodes;
+      this->first=other.first;
+      this->last=other.last;
+      this->firstLive=other.firstLive;
+      this->lastLive=other.lastLive;
+      this->takeSize(other);
+      this->numOfDead=other.numOfDead;
+      this->comp=other.comp;
 
       other.root=nullptr;
+      other.first=nullptr;
+      other.last=nullptr;
+      other.resetLiveEnds();
       other.numOfNodes=0;
+      other.numOfDead=0;
     }
     return *this;
   }
 
   bool isEmpty() const
   {
-    if(numOfNodes)
+    if(frontNode()!=nullptr)
     {
       return false;
     }
     return true;
   }
 
+  // With an aggregate policy the entry counts as changed when the reference
+  // is taken (as with valueOf and iterators): writing through it after the
+  // next aggregate() query leaves the aggregates stale. Keep such writes to
+  // assign() and update().
   mapped_type& operator[](const key_type& key)
   {
-    auto it=find(key);
-    if(it!=end())
+    Node* parentNode;
+    Node* found=locate(root,key,parentNode);
+    if(found!=nullptr)
     {
-      return it->second;
+      revive(found);
+      touch(found);
+      access(found);
+      return found->data.second;
     }
     Node* newNode=new Node(key,mapped_type());
-    insert(newNode);
+    attach(newNode,parentNode);
+    access(newNode);
     return newNode->data.second;
   }
 
+  // Sets the value of key, adding the entry if it is missing.
+  void assign(const key_type& key, const mapped_type& value)
+  {
+    (*this)[key]=value;
+  }
+
+  // Changes the value of key in place by calling fn on it, then marks the
+  // entry as changed for the aggregates. Throws std::out_of_range if the key
+  // is missing.
+  template <typename Function>
+  void update(const key_type& key, Function fn)
+  {
+    Node* n=findNode(key);
+    if(n==nullptr)
+    {
+      throw std::out_of_range("No such key");
+    }
+    fn(n->data.second);
+    touch(n);
+    access(n);
+  }
+
+  // Inserts value unless its key is present, starting the search at hint
+  // (the position the key should end up before). With a correct hint the
+  // node is attached next to it in O(1); otherwise the search climbs from
+  // the hint only as far as needed. Returns the entry with the key.
+  iterator insert(const const_iterator& hint, const value_type& value)
+  {
+    return emplaceHint(hint,value.first,value.second);
+  }
+
+  template <typename... Args>
+  iterator emplaceHint(const const_iterator& hint, const key_type& key, Args&&... args)
+  {
+    Node* succ=hint.getPtr();
+    // The neighbours may be tombstones: they are still the nodes next to the
+    // key in the tree, so the hint holds just the same.
+    Node* pred=(succ!=nullptr ? succ->prev : last);
+    Node* parentNode;
+    if((pred==nullptr || less(pred->data.first,key))
+       && (succ==nullptr || less(key,succ->data.first)))
+    {
+      parentNode=(pred!=nullptr && pred->right==nullptr ? pred : succ);
+    }
+    else
+    {
+      Node* found=locate(climb(succ!=nullptr ? succ : pred,key),key,parentNode);
+      if(found!=nullptr)
+      {
+        if(isDead(found))
+        {
+          found->data.second=mapped_type(std::forward<Args>(args)...);
+          revive(found);
+        }
+        access(found);
+        return Iterator(this,found);
+      }
+    }
+    Node* newNode=new Node(key,mapped_type(std::forward<Args>(args)...));
+    attach(newNode,parentNode);
+    access(newNode);
+    return Iterator(this,newNode);
+  }
+
   const mapped_type& valueOf(const key_type& key) const
   {
     if(root==nullptr)
@@ -319,9 +1361,12 @@ public:
     return ConstIterator(this,findNode(key));
   }
 
+  // Lookups through a const map never restructure it, even with SplayAccess.
   iterator find(const key_type& key)
   {
-    return Iterator(this,findNode(key));
+    Node* n=findNode(key);
+    access(n);
+    return Iterator(this,n);
   }
 
   void remove(const key_type& key)
@@ -342,65 +1387,449 @@ public:
     removeNode(it.getPtr());
   }
 
+  // O(1), except while isSizeKnown() is false: then the call counts the
+  // entries in O(n), once.
   size_type getSize() const
   {
-    return numOfNodes;
+    if(numOfNodes!=unknownSize)
+    {
+      return numOfNodes;
+    }
+    size_type counted=countedSize.load(std::memory_order_relaxed);
+    if(counted==unknownSize)
+    {
+      counted=0;
+      for(Node* n=frontNode(); n!=nullptr; n=liveFrom(n->next))
+      {
+        counted++;
+      }
+      countedSize.store(counted,std::memory_order_relaxed);
+    }
+    return counted;
   }
 
-  bool operator==(const TreeMap& other) const
+  // False after a split() into two non-empty parts, and after a join() of
+  // a part whose size was still unknown, until getSize() has counted.
+  bool isSizeKnown() const
+  {
+    return numOfNodes!=unknownSize || countedSize.load(std::memory_order_relaxed)!=unknownSize;
+  }
+
+  // Moves every entry with key not less than the given one into the returned
+  // tree, keeping the smaller ones here. Only the nodes on the search path for
+  // the key are relinked, so the cost is O(height). Nodes keep no subtree
+  // sizes, so the sizes of the parts are unknown, unless one is empty: the
+  // first getSize() of each part costs O(n), which makes split() a poor fit
+  // for code that needs the sizes after every split. Tombstones, if any, are
+  // dropped first in O(n).
+  TreeMap split(const key_type& key)
   {
-    if(this->numOfNodes!=other.numOfNodes)
+    purge();
+    TreeMap result(comp);
+    Node* lRoot=nullptr;
+    Node* rRoot=nullptr;
+    Node** lHook=&lRoot;
+    Node** rHook=&rRoot;
+    Node* lParent=nullptr;
+    Node* rParent=nullptr;
+    Node* temp=root;
+    while(temp!=nullptr)
     {
-      return false;
+      Node* nextTemp;
+      touch(temp);
+      if(less(temp->data.first,key))
+      {
+        *lHook=temp;
+        temp->parent=lParent;
+        lParent=temp;
+        lHook=&temp->right;
+        nextTemp=temp->right;
+      }
+      else
+      {
+        *rHook=temp;
+        temp->parent=rParent;
+        rParent=temp;
+        rHook=&temp->left;
+        nextTemp=temp->left;
+      }
+      temp=nextTemp;
+    }
+    *lHook=nullptr;
+    *rHook=nullptr;
+
+    if(lParent==nullptr)
+    {
+      std::swap(root,result.root);
+      std::swap(first,result.first);
+      std::swap(last,result.last);
+      resetLiveEnds();
+      result.resetLiveEnds();
+      result.takeSize(*this);
+      numOfNodes=0;
+      return result;
+    }
+    if(rParent==nullptr)
+    {
+      resetLiveEnds();
+      return result;
+    }
+    lParent->next=nullptr;
+    rParent->prev=nullptr;
+    result.root=rRoot;
+    result.first=rParent;
+    result.last=last;
+    result.resetLiveEnds();
+    result.forgetSize();
+    root=lRoot;
+    last=lParent;
+    resetLiveEnds();
+    forgetSize();
+    return result;
+  }
+
+  // Concatenates two trees whose key ranges do not overlap (every key of left
+  // is less than every key of right). The largest node of left becomes the
+  // new root, so no entry is visited or copied (once any tombstones are
+  // dropped).
+  static TreeMap join(TreeMap&& left, TreeMap&& right)
+  {
+    left.purge();
+    right.purge();
+    if(left.root==nullptr)
+    {
+      return std::move(right);
+    }
+    if(right.root==nullptr)
+    {
+      return std::move(left);
+    }
+    if(!left.less(left.last->data.first,right.first->data.first))
+    {
+      throw std::invalid_argument("Key ranges overlap");
     }
-    for(auto it=begin();it!=end();it++)
+    TreeMap result(left.comp);
+    Node* pivot=left.last;
+    Node* changed=pivot;
+    if(pivot!=left.root)
     {
-      if(other.findNode(it->first)==nullptr)
+      changed=pivot->parent;
+      pivot->parent->right=pivot->left;
+      if(pivot->left!=nullptr)
       {
-        return false;
+        pivot->left->parent=pivot->parent;
+      }
+      pivot->left=left.root;
+      left.root->parent=pivot;
+      pivot->parent=nullptr;
+    }
+    pivot->right=right.root;
+    right.root->parent=pivot;
+    pivot->next=right.first;
+    right.first->prev=pivot;
+    result.touchPath(changed);
+
+    result.root=pivot;
+    result.first=left.first;
+    result.last=right.last;
+    result.resetLiveEnds();
+    left.resolveSize();
+    right.resolveSize();
+    if(left.numOfNodes!=unknownSize && right.numOfNodes!=unknownSize)
+    {
+      result.numOfNodes=left.numOfNodes+right.numOfNodes;
+    }
+    else
+    {
+      result.forgetSize();
+    }
+
+    left.root=nullptr;
+    left.first=nullptr;
+    left.last=nullptr;
+    left.resetLiveEnds();
+    left.numOfNodes=0;
+    right.root=nullptr;
+    right.first=nullptr;
+    right.last=nullptr;
+    right.resetLiveEnds();
+    right.numOfNodes=0;
+    return result;
+  }
+
+  // Combined values of all entries with lo <= key < hi, in key order. Needs
+  // an aggregate policy; costs O(height) plus the recomputation of subtrees
+  // changed since the previous query.
+  aggregate_type aggregate(const key_type& lo, const key_type& hi) const
+  {
+    static_assert(aggregated::value, "TreeMap has no aggregate policy");
+    clean(root);
+    Node* top=root;
+    while(top!=nullptr && (less(top->data.first,lo) || !less(top->data.first,hi)))
+    {
+      top=(less(top->data.first,lo) ? top->right : top->left);
+    }
+    if(top==nullptr)
+    {
+      return Aggregate::identity();
+    }
+    aggregate_type leftPart=Aggregate::identity();
+    for(Node* n=top->left; n!=nullptr;)
+    {
+      if(less(n->data.first,lo))
+      {
+        n=n->right;
       }
-      if(other.valueOf(it->first)!=it->second)
+      else
       {
-        return false;
+        leftPart=Aggregate::combine(Aggregate::combine(Aggregate::of(n->data.second),
+                                                       subtreeAggregate(n->right)),
+                                    leftPart);
+        n=n->left;
       }
     }
-    return true;
+    aggregate_type rightPart=Aggregate::identity();
+    for(Node* n=top->right; n!=nullptr;)
+    {
+      if(less(n->data.first,hi))
+      {
+        rightPart=Aggregate::combine(rightPart,
+                                     Aggregate::combine(subtreeAggregate(n->left),
+                                                        Aggregate::of(n->data.second)));
+        n=n->right;
+      }
+      else
+      {
+        n=n->left;
+      }
+    }
+    return Aggregate::combine(Aggregate::combine(leftPart,Aggregate::of(top->data.second)),
+                              rightPart);
   }
 
-  bool operator!=(const TreeMap& other) const
+  // Combined values of all entries.
+  aggregate_type aggregate() const
   {
-    return !(*this == other);
+    static_assert(aggregated::value, "TreeMap has no aggregate policy");
+    clean(root);
+    return subtreeAggregate(root);
   }
 
-  iterator begin()
+  // Streams the entries in key order in the sorted run format (see
+  // SortedRun.h): delta-varint keys, length-prefixed values, blocks of about
+  // blockSize bytes and a sparse index of their first keys.
+  void writeSortedRun(std::ostream& out, size_type blockSize=4096) const
   {
-    Node* temp=root;
-    if(temp!=nullptr)
+    SortedRunWriter<KeyType, ValueType> writer(out,blockSize);
+    for(Node* n=frontNode(); n!=nullptr; n=liveFrom(n->next))
+    {
+      writer.add(n->data.first,n->data.second);
+    }
+    writer.finish();
+  }
+
+  // Rebuilds a map written by writeSortedRun in O(n); the tree comes out
+  // perfectly balanced. Reads the stream front to back only.
+  static TreeMap readSortedRun(std::istream& in, const Compare& c=Compare())
+  {
+    return buildSorted([&in, &c](const Emit& emit)
+    {
+      SortedRunReader<KeyType, ValueType, Compare>(in,c).readAll(emit);
+    },c);
+  }
+
+  // As above, for the entries with lo <= key < hi only; uses the block index
+  // of a seekable stream to skip the rest of the run.
+  static TreeMap readSortedRun(std::istream& in, const key_type& lo, const key_type& hi,
+                               const Compare& c=Compare())
+  {
+    return buildSorted([&in, &lo, &hi, &c](const Emit& emit)
+    {
+      SortedRunReader<KeyType, ValueType, Compare>(in,c).forEachInRange(lo,hi,emit);
+    },c);
+  }
+
+  // Calls fn for every entry, from several threads at once (threads==0
+  // picks the number of hardware threads), in no particular order. fn must
+  // be safe to call concurrently; the map must not change meanwhile.
+  template <typename Function>
+  void parallelForEach(Function fn, unsigned threads=0) const
+  {
+    WorkStealingPool pool(threads);
+    std::vector<Node*> starts=scanRanges(pool.getThreads());
+    std::vector<WorkStealingPool::Task> tasks;
+    for(size_type i=0; i<starts.size(); i++)
     {
-      while(temp->left!=nullptr)
+      Node* from=starts[i];
+      Node* to=(i+1<starts.size() ? starts[i+1] : nullptr);
+      tasks.push_back([from, to, &fn]()
       {
-        temp=temp->left;
+        for(Node* n=from; n!=to; n=liveFrom(n->next))
+        {
+          fn(n->data);
+        }
+      });
+    }
+    pool.run(tasks);
+  }
+
+  // Returns init combined with transform(entry) of every entry, computed on
+  // several threads. Partial results are combined in key order, so combine
+  // needs to be associative but not commutative.
+  template <typename T, typename Transform, typename Combine>
+  T parallelReduce(T init, Transform transform, Combine combine, unsigned threads=0) const
+  {
+    WorkStealingPool pool(threads);
+    std::vector<Node*> starts=scanRanges(pool.getThreads());
+    std::vector<std::pair<bool, T>> partial(starts.size(),std::make_pair(false,init));
+    std::vector<WorkStealingPool::Task> tasks;
+    for(size_type i=0; i<starts.size(); i++)
+    {
+      Node* from=starts[i];
+      Node* to=(i+1<starts.size() ? starts[i+1] : nullptr);
+      std::pair<bool, T>* out=&partial[i];
+      tasks.push_back([from, to, out, &transform, &combine]()
+      {
+        if(from==to)
+        {
+          return;
+        }
+        T acc=transform(from->data);
+        for(Node* n=liveFrom(from->next); n!=to; n=liveFrom(n->next))
+        {
+          acc=combine(acc,transform(n->data));
+        }
+        *out=std::make_pair(true,std::move(acc));
+      });
+    }
+    pool.run(tasks);
+    for(auto& p : partial)
+    {
+      if(p.first)
+      {
+        init=combine(init,p.second);
       }
     }
-    return Iterator(this,temp);
+    return init;
   }
 
-  iterator end()
+  // Read-only copy laid out for fast searches; later changes to this map
+  // are not reflected in it.
+  FrozenTreeMap<KeyType, ValueType, Compare> freeze() const
   {
-    return Iterator(this,nullptr);
+    return FrozenTreeMap<KeyType, ValueType, Compare>(cbegin(),cend(),comp);
   }
 
-  const_iterator cbegin() const
+  // Set algebra by a single in-order walk over both maps, O(n+m); the
+  // results are new, perfectly balanced maps. Where a key is in both maps
+  // unionWith and intersectWith take resolve(thisValue, otherValue), or
+  // this map's value without a resolver.
+  template <typename Resolve>
+  TreeMap unionWith(const TreeMap& other, Resolve resolve) const
   {
-    Node* temp=root;
-    if(temp!=nullptr)
+    return buildSorted([this, &other, &resolve](const Emit& emit)
     {
-      while(temp->left!=nullptr)
+      mergeWalk(other,[&emit](const Node* a)
       {
-        temp=temp->left;
+        emit(a->data.first,a->data.second);
+      },[&emit](const Node* b)
+      {
+        emit(b->data.first,b->data.second);
+      },[&emit, &resolve](const Node* a, const Node* b)
+      {
+        emit(a->data.first,resolve(a->data.second,b->data.second));
+      });
+    },comp);
+  }
+
+  TreeMap unionWith(const TreeMap& other) const
+  {
+    return unionWith(other,keepOwn);
+  }
+
+  template <typename Resolve>
+  TreeMap intersectWith(const TreeMap& other, Resolve resolve) const
+  {
+    return buildSorted([this, &other, &resolve](const Emit& emit)
+    {
+      mergeWalk(other,[](const Node*)
+      {},[](const Node*)
+      {},[&emit, &resolve](const Node* a, const Node* b)
+      {
+        emit(a->data.first,resolve(a->data.second,b->data.second));
+      });
+    },comp);
+  }
+
+  TreeMap intersectWith(const TreeMap& other) const
+  {
+    return intersectWith(other,keepOwn);
+  }
+
+  // Entries whose keys are not in other.
+  TreeMap difference(const TreeMap& other) const
+  {
+    return buildSorted([this, &other](const Emit& emit)
+    {
+      mergeWalk(other,[&emit](const Node* a)
+      {
+        emit(a->data.first,a->data.second);
+      },[](const Node*)
+      {},[](const Node*, const Node*)
+      {});
+    },comp);
+  }
+
+  // Entries whose keys are in exactly one of the maps.
+  TreeMap symmetricDiff(const TreeMap& other) const
+  {
+    return buildSorted([this, &other](const Emit& emit)
+    {
+      mergeWalk(other,[&emit](const Node* a)
+      {
+        emit(a->data.first,a->data.second);
+      },[&emit](const Node* b)
+      {
+        emit(b->data.first,b->data.second);
+      },[](const Node*, const Node*)
+      {});
+    },comp);
+  }
+
+  // Walks both maps side by side, so it is O(n) whatever their shapes.
+  bool operator==(const TreeMap& other) const
+  {
+    const Node* a=frontNode();
+    const Node* b=other.frontNode();
+    for(; a!=nullptr && b!=nullptr; a=liveFrom(a->next), b=liveFrom(b->next))
+    {
+      if(less(a->data.first,b->data.first) || less(b->data.first,a->data.first)
+         || a->data.second!=b->data.second)
+      {
+        return false;
       }
     }
-    return ConstIterator(this,temp);
+    return a==nullptr && b==nullptr;
+  }
+
+  bool operator!=(const TreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return Iterator(this,frontNode());
+  }
+
+  iterator end()
+  {
+    return Iterator(this,nullptr);
+  }
+
+  const_iterator cbegin() const
+  {
+    return ConstIterator(this,frontNode());
   }
 
   const_iterator cend() const
@@ -422,11 +1851,23 @@ public:
   {
     return root;
   }
+
+  // The first and last entries, skipping tombstones.
+  Node* getFirst() const
+  {
+    return frontNode();
+  }
+
+  Node* getLast() const
+  {
+    return backNode();
+  }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename Aggregate, typename Access>
+class TreeMap<KeyType, ValueType, Compare, Aggregate, Access>::ConstIterator
 {
+protected:
   const TreeMap* treePtr;
   Node* nodePtr;
 public:
@@ -449,31 +1890,7 @@ public:
     {
       throw std::out_of_range("Cannot increment");
     }
-    else if(nodePtr->right!=nullptr)
-    {
-      nodePtr=nodePtr->right;
-      while(nodePtr->left!=nullptr)
-      {
-        nodePtr=nodePtr->left;
-      }
-    }
-    else
-    {
-      while(true)
-      {
-        if(nodePtr->parent==nullptr)
-        {
-          nodePtr=nullptr;
-          break;
-        }
-        if(nodePtr->parent->right!=nodePtr)
-        {
-          nodePtr=nodePtr->parent;
-          break;
-        }
-        nodePtr=nodePtr->parent;
-      }
-    }
+    nodePtr=(nodePtr==treePtr->getLast() ? nullptr : TreeMap::liveFrom(nodePtr->next));
     return *this;
   }
 
@@ -486,44 +1903,21 @@ public:
 
   ConstIterator& operator--()
   {
-    if(treePtr->getRoot()==nullptr)
+    if(treePtr->getLast()==nullptr)
     {
       throw std::out_of_range("Cannot decrement");
     }
     else if(nodePtr==nullptr)
     {
-      nodePtr=treePtr->getRoot();
-      while(nodePtr->right!=nullptr)
-      {
-        nodePtr=nodePtr->right;
-      }
+      nodePtr=treePtr->getLast();
+    }
+    else if(nodePtr==treePtr->getFirst())
+    {
+      throw std::out_of_range("Cannot decrement");
     }
     else
     {
-      if(nodePtr->left!=nullptr)
-      {
-        nodePtr=nodePtr->left;
-        while(nodePtr->right!=nullptr)
-        {
-          nodePtr=nodePtr->right;
-        }
-      }
-      else
-      {
-        while(true)
-        {
-          if(nodePtr->parent==nullptr)
-          {
-            throw std::out_of_range("Cannot decrement");
-          }
-          if(nodePtr->parent->left!=nodePtr)
-          {
-            nodePtr=nodePtr->parent;
-            break;
-          }
-          nodePtr=nodePtr->parent;
-        }
-      }
+      nodePtr=TreeMap::liveUpTo(nodePtr->prev);
     }
     return *this;
   }
@@ -569,8 +1963,9 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename Aggregate, typename Access>
+class TreeMap<KeyType, ValueType, Compare, Aggregate, Access>::Iterator
+: public TreeMap<KeyType, ValueType, Compare, Aggregate, Access>::ConstIterator
 {
 public:
   using reference = typename TreeMap::reference;
@@ -617,6 +2012,9 @@ public:
 
   reference operator*() const
   {
+    // the value may be changed through the returned reference, up to the
+    // next aggregate() query (see TreeMap::operator[])
+    this->treePtr->touch(this->nodePtr);
     // ugly cast, yet reduces code duplication.
     return const_cast<reference>(ConstIterator::operator*());
   }
@@ -0,0 +1,169 @@
+#ifndef AISDI_MAPS_WORKSTEALINGPOOL_H
+#define AISDI_MAPS_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aisdi
+{
+
+// Runs a batch of independent tasks on a fixed number of threads (the
+// caller being one of them). Tasks are dealt round-robin onto per-thread
+// deques; every thread works through its own deque from the back and, when
+// it runs dry, steals from the front of the others, so uneven tasks still
+// keep all threads busy. The first exception thrown by a task is rethrown by
+// run() once every thread has stopped; tasks not started by then are skipped.
+class WorkStealingPool
+{
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct Queue
+  {
+    std::mutex lock;
+    std::deque<std::size_t> tasks;
+  };
+
+  unsigned numOfThreads;
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::atomic<bool> failed;
+  std::exception_ptr error;
+  std::mutex errorLock;
+
+  bool popOwn(unsigned self, std::size_t& task)
+  {
+    Queue& q=*queues[self];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if(q.tasks.empty())
+    {
+      return false;
+    }
+    task=q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned self, std::size_t& task)
+  {
+    for(unsigned i=1; i<numOfThreads; i++)
+    {
+      Queue& q=*queues[(self+i)%numOfThreads];
+      std::lock_guard<std::mutex> guard(q.lock);
+      if(!q.tasks.empty())
+      {
+        task=q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // No task is added once the workers start, so a thread that finds every
+  // deque empty is done.
+  void work(unsigned self, std::vector<Task>& tasks)
+  {
+    std::size_t task;
+    while(popOwn(self,task) || steal(self,task))
+    {
+      if(failed.load(std::memory_order_relaxed))
+      {
+        continue;
+      }
+      try
+      {
+        tasks[task]();
+      }
+      catch(...)
+      {
+        std::lock_guard<std::mutex> guard(errorLock);
+        if(!error)
+        {
+          error=std::current_exception();
+        }
+        failed.store(true,std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static void join(std::vector<std::thread>& workers)
+  {
+    for(auto& w : workers)
+    {
+      w.join();
+    }
+  }
+
+public:
+  // threads==0 picks the number of hardware threads.
+  explicit WorkStealingPool(unsigned threads=0)
+  : numOfThreads(threads!=0 ? threads : std::thread::hardware_concurrency()),
+    queues(), failed(false), error(), errorLock()
+  {
+    if(numOfThreads==0)
+    {
+      numOfThreads=1;
+    }
+    for(unsigned i=0; i<numOfThreads; i++)
+    {
+      queues.emplace_back(new Queue());
+    }
+  }
+
+  unsigned getThreads() const
+  {
+    return numOfThreads;
+  }
+
+  void run(std::vector<Task>& tasks)
+  {
+    failed=false;
+    error=nullptr;
+    for(std::size_t i=0; i<tasks.size(); i++)
+    {
+      queues[i%numOfThreads]->tasks.push_back(i);
+    }
+    std::vector<std::thread> workers;
+    try
+    {
+      workers.reserve(numOfThreads-1);
+      for(unsigned i=1; i<numOfThreads && i<tasks.size(); i++)
+      {
+        workers.emplace_back([this, i, &tasks]()
+        {
+          work(i,tasks);
+        });
+      }
+    }
+    catch(...)
+    {
+      // A thread could not be started: the ones that were skip the tasks
+      // left and are joined, as a joinable std::thread must not be destroyed.
+      failed.store(true,std::memory_order_relaxed);
+      join(workers);
+      for(auto& q : queues)
+      {
+        q->tasks.clear();
+      }
+      throw;
+    }
+    work(0,tasks);
+    join(workers);
+    if(error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_WORKSTEALINGPOOL_H */
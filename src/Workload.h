@@ -0,0 +1,416 @@
+#ifndef AISDI_MAPS_WORKLOAD_H
+#define AISDI_MAPS_WORKLOAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+// Shape of a key stream. parameter is the Zipf exponent, the standard
+// deviation of Normal as a fraction of the key range, or the number of
+// clusters; the other kinds ignore it.
+struct KeyDistribution
+{
+  enum Kind { Uniform, Zipfian, Sequential, Normal, Clustered };
+
+  Kind kind;
+  double parameter;
+
+  static KeyDistribution uniform()
+  {
+    return KeyDistribution{Uniform,0};
+  }
+
+  static KeyDistribution zipfian(double exponent=0.99)
+  {
+    return KeyDistribution{Zipfian,exponent};
+  }
+
+  static KeyDistribution sequential()
+  {
+    return KeyDistribution{Sequential,0};
+  }
+
+  static KeyDistribution normal(double spread=0.125)
+  {
+    return KeyDistribution{Normal,spread};
+  }
+
+  static KeyDistribution clustered(std::size_t clusters=16)
+  {
+    return KeyDistribution{Clustered,static_cast<double>(clusters)};
+  }
+
+  // Parses what name() prints: "uniform", "zipf[:s]", "sequential",
+  // "normal[:spread]" or "clustered[:count]".
+  static KeyDistribution parse(const std::string& text)
+  {
+    std::string kind=text.substr(0,text.find(':'));
+    bool hasParameter=kind.size()<text.size();
+    double parameter=0;
+    if(hasParameter)
+    {
+      std::istringstream in(text.substr(kind.size()+1));
+      if(!(in >> parameter) || !in.eof() || !(parameter>0))
+      {
+        throw std::invalid_argument("Bad distribution parameter: "+text);
+      }
+    }
+    if(kind=="uniform" && !hasParameter)
+    {
+      return uniform();
+    }
+    if(kind=="sequential" && !hasParameter)
+    {
+      return sequential();
+    }
+    if(kind=="zipf")
+    {
+      return zipfian(hasParameter ? parameter : 0.99);
+    }
+    if(kind=="normal")
+    {
+      return normal(hasParameter ? parameter : 0.125);
+    }
+    if(kind=="clustered" && parameter==std::floor(parameter))
+    {
+      return clustered(hasParameter ? static_cast<std::size_t>(parameter) : 16);
+    }
+    throw std::invalid_argument("Unknown distribution: "+text);
+  }
+
+  std::string name() const
+  {
+    std::ostringstream out;
+    switch(kind)
+    {
+    case Uniform:
+      return "uniform";
+    case Sequential:
+      return "sequential";
+    case Zipfian:
+      out << "zipf:" << parameter;
+      break;
+    case Normal:
+      out << "normal:" << parameter;
+      break;
+    case Clustered:
+      out << "clustered:" << parameter;
+      break;
+    }
+    return out.str();
+  }
+};
+
+// Draws ranks 0..n-1 with probability proportional to 1/(rank+1)^exponent,
+// from a cumulative table built once in O(n).
+class ZipfGenerator
+{
+  std::vector<double> cdf;
+
+public:
+  ZipfGenerator(std::size_t n, double exponent)
+  : cdf(n)
+  {
+    double sum=0;
+    for(std::size_t i=0; i<n; i++)
+    {
+      sum+=1.0/std::pow(static_cast<double>(i+1),exponent);
+      cdf[i]=sum;
+    }
+    for(auto& c : cdf)
+    {
+      c/=sum;
+    }
+  }
+
+  // Rank for a uniform sample u from [0, 1).
+  std::size_t operator()(double u) const
+  {
+    std::size_t rank=std::lower_bound(cdf.begin(),cdf.end(),u)-cdf.begin();
+    return rank<cdf.size() ? rank : cdf.size()-1;
+  }
+};
+
+// Seeded source of key sets and access streams shared by the benchmarks and
+// stress tests. Sampling is done here rather than by the <random>
+// distributions, whose output differs between standard libraries, so a seed
+// reproduces the same workload everywhere.
+class WorkloadGenerator
+{
+public:
+  using key_type = std::uint64_t;
+
+  // Every key is encoded in this many base-62 digits.
+  enum : std::size_t { keyDigits=11 };
+
+private:
+  std::mt19937_64 engine;
+
+  double gaussian()
+  {
+    double u=1.0-unit();
+    return std::sqrt(-2.0*std::log(u))*std::cos(6.283185307179586*unit());
+  }
+
+  // Next value at or above key that is not taken yet; keeps duplicates out
+  // of a distribution without redrawing. Every taken key links to a value
+  // above it, and the links are compressed so that dense runs stay cheap.
+  static key_type claim(std::unordered_map<key_type,key_type>& taken, key_type key)
+  {
+    key_type free=key;
+    for(auto it=taken.find(free); it!=taken.end(); it=taken.find(free))
+    {
+      free=it->second;
+    }
+    while(key!=free)
+    {
+      key_type& link=taken[key];
+      key=link;
+      link=free+1;
+    }
+    taken[free]=free+1;
+    return free;
+  }
+
+  template <typename T>
+  void shuffle(std::vector<T>& items)
+  {
+    for(std::size_t i=items.size(); i>1; i--)
+    {
+      std::swap(items[i-1],items[below(i)]);
+    }
+  }
+
+public:
+  explicit WorkloadGenerator(std::uint64_t seed=2024)
+  : engine(seed)
+  {}
+
+  // A bijection on 64-bit integers (the splitmix64 finalizer): scatters
+  // record numbers into distinct keys.
+  static key_type mix(key_type x)
+  {
+    x=(x^(x>>30))*0xbf58476d1ce4e5b9ull;
+    x=(x^(x>>27))*0x94d049bb133111ebull;
+    return x^(x>>31);
+  }
+
+  // Uniform in [0, bound), bound>0.
+  key_type below(key_type bound)
+  {
+    key_type limit=-bound%bound;
+    key_type x;
+    do
+    {
+      x=engine();
+    } while(x<limit);
+    return x%bound;
+  }
+
+  // Uniform in [0, 1).
+  double unit()
+  {
+    return (engine()>>11)/9007199254740992.0;
+  }
+
+  // n distinct keys in O(n), in the order they would be inserted. Uniform
+  // keys are scattered over all 64-bit values, Sequential ones are 0..n-1
+  // in order, Normal ones are centred in [0, 8n) and Clustered ones fill
+  // narrow ranges around random centres. Zipfian skews only accesses, so
+  // its key set is uniform.
+  std::vector<key_type> keys(std::size_t n, const KeyDistribution& d)
+  {
+    std::vector<key_type> result;
+    result.reserve(n);
+    if(d.kind==KeyDistribution::Uniform || d.kind==KeyDistribution::Zipfian)
+    {
+      key_type offset=engine();
+      for(std::size_t i=0; i<n; i++)
+      {
+        result.push_back(mix(offset+i));
+      }
+      return result;
+    }
+    if(d.kind==KeyDistribution::Sequential)
+    {
+      for(std::size_t i=0; i<n; i++)
+      {
+        result.push_back(i);
+      }
+      return result;
+    }
+
+    std::unordered_map<key_type,key_type> taken(2*n);
+    if(d.kind==KeyDistribution::Normal)
+    {
+      double range=8.0*n;
+      for(std::size_t i=0; i<n; i++)
+      {
+        double x=std::round(range/2+gaussian()*d.parameter*range);
+        result.push_back(claim(taken,x>0 ? static_cast<key_type>(x) : 0));
+      }
+      return result;
+    }
+    std::size_t clusters=std::max<std::size_t>(1,static_cast<std::size_t>(d.parameter));
+    key_type width=std::max<key_type>(1,4*n/clusters);
+    std::vector<key_type> centres;
+    for(std::size_t i=0; i<clusters; i++)
+    {
+      centres.push_back(engine()>>1);
+    }
+    for(std::size_t i=0; i<n; i++)
+    {
+      result.push_back(claim(taken,centres[below(clusters)]+below(width)));
+    }
+    return result;
+  }
+
+  // count keys that are not among existing, e.g. for lookups that miss.
+  std::vector<key_type> absentKeys(const std::vector<key_type>& existing, std::size_t count)
+  {
+    std::unordered_set<key_type> taken(existing.begin(),existing.end());
+    std::vector<key_type> result;
+    result.reserve(count);
+    while(result.size()<count)
+    {
+      key_type key=engine();
+      if(taken.insert(key).second)
+      {
+        result.push_back(key);
+      }
+    }
+    return result;
+  }
+
+  // count picks from keys. Uniform and Zipfian picks ignore the key order
+  // (the hottest Zipfian keys are scattered), while Sequential, Normal and
+  // Clustered ones stay local in key order: a sweep, a bell around the
+  // median and a few hot ranges respectively.
+  std::vector<key_type> accesses(const std::vector<key_type>& keys, std::size_t count,
+                                 const KeyDistribution& d)
+  {
+    if(keys.empty())
+    {
+      throw std::invalid_argument("No keys to access");
+    }
+    std::size_t n=keys.size();
+    std::vector<key_type> result;
+    result.reserve(count);
+    if(d.kind==KeyDistribution::Uniform)
+    {
+      for(std::size_t i=0; i<count; i++)
+      {
+        result.push_back(keys[below(n)]);
+      }
+      return result;
+    }
+    if(d.kind==KeyDistribution::Zipfian)
+    {
+      std::vector<key_type> byRank(keys);
+      shuffle(byRank);
+      ZipfGenerator zipf(n,d.parameter);
+      for(std::size_t i=0; i<count; i++)
+      {
+        result.push_back(byRank[zipf(unit())]);
+      }
+      return result;
+    }
+
+    std::vector<key_type> sorted(keys);
+    std::sort(sorted.begin(),sorted.end());
+    if(d.kind==KeyDistribution::Sequential)
+    {
+      for(std::size_t i=0; i<count; i++)
+      {
+        result.push_back(sorted[i%n]);
+      }
+    }
+    else if(d.kind==KeyDistribution::Normal)
+    {
+      for(std::size_t i=0; i<count; i++)
+      {
+        double x=std::round(n/2.0+gaussian()*d.parameter*n);
+        result.push_back(sorted[x<0 ? 0 : x>=n ? n-1 : static_cast<std::size_t>(x)]);
+      }
+    }
+    else
+    {
+      std::size_t clusters=std::max<std::size_t>(1,static_cast<std::size_t>(d.parameter));
+      std::size_t width=std::max<std::size_t>(1,n/(16*clusters));
+      std::vector<std::size_t> starts;
+      for(std::size_t i=0; i<clusters; i++)
+      {
+        starts.push_back(below(n-std::min(width,n)+1));
+      }
+      for(std::size_t i=0; i<count; i++)
+      {
+        result.push_back(sorted[starts[below(clusters)]+below(width)]);
+      }
+    }
+    return result;
+  }
+
+  // Each of keys exactly once, in random order.
+  std::vector<key_type> shuffled(std::vector<key_type> keys)
+  {
+    shuffle(keys);
+    return keys;
+  }
+
+  // A string of the given length for key: its keyDigits base-62 digits, so
+  // that distinct keys stay distinct and keep their order, padded with
+  // filler derived from the key.
+  static std::string stringKey(key_type key, std::size_t length)
+  {
+    if(length<keyDigits)
+    {
+      throw std::invalid_argument("String keys need at least 11 characters");
+    }
+    static const char digits[]="0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    std::string result(length,'0');
+    key_type x=key;
+    for(std::size_t i=keyDigits; i-->0;)
+    {
+      result[i]=digits[x%62];
+      x/=62;
+    }
+    key_type filler=mix(key);
+    for(std::size_t i=keyDigits; i<length; i++)
+    {
+      if(filler==0)
+      {
+        filler=mix(key+i);
+      }
+      result[i]=digits[filler%62];
+      filler/=62;
+    }
+    return result;
+  }
+
+  std::vector<std::string> stringKeys(std::size_t n, std::size_t length, const KeyDistribution& d)
+  {
+    std::vector<std::string> result;
+    result.reserve(n);
+    for(key_type key : keys(n,d))
+    {
+      result.push_back(stringKey(key,length));
+    }
+    return result;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_WORKLOAD_H */
@@ -0,0 +1,138 @@
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkReport.h"
+
+using namespace std;
+
+namespace
+{
+  vector<aisdi::BenchmarkRecord> load(const string& path)
+  {
+    std::ifstream file(path);
+    if (!file)
+    {
+      throw std::runtime_error("Cannot read "+path);
+    }
+    return aisdi::readCsv(file);
+  }
+
+  // Prints each result of records that was not compared, once.
+  void printUnmatched(const vector<aisdi::BenchmarkChange>& changes, const vector<aisdi::BenchmarkRecord>& records,
+                      const char* where)
+  {
+    for (size_t i=0; i<records.size(); i++)
+    {
+      const aisdi::BenchmarkRecord& r=records[i];
+      bool shown=false;
+      for (const auto& c : changes)
+      {
+        shown=shown || aisdi::sameResult(c.baseline, r);
+      }
+      for (size_t j=0; j<i; j++)
+      {
+        shown=shown || aisdi::sameResult(records[j], r);
+      }
+      if (!shown)
+      {
+        cout << "only in " << where << ": " << r.engine << " " << r.operation << " " << r.size << " "
+             << r.distribution << endl;
+      }
+    }
+  }
+
+  void usage(const char* name)
+  {
+    cout << "Usage: " << name << " [--threshold PERCENT] BASELINE.csv CANDIDATE.csv\n"
+         << "Compares two result files written by aisdiMaps --csv and exits with 1 if\n"
+         << "any median got significantly slower by more than PERCENT (default 5).\n"
+         << "Concatenate the files of several runs into each side: the rows of a result\n"
+         << "are pooled and tested across runs, one sample per run" << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+    double threshold=0.05;
+    vector<string> files;
+    try
+    {
+        for (int i=1; i<argc; i++)
+        {
+            string arg=argv[i];
+            if (arg=="--threshold" && i+1<argc)
+            {
+                threshold=std::stod(argv[++i])/100;
+            }
+            else if (arg.compare(0, 2, "--")==0)
+            {
+                throw std::invalid_argument(arg);
+            }
+            else
+            {
+                files.push_back(arg);
+            }
+        }
+        if (files.size()!=2 || threshold<0)
+        {
+            throw std::invalid_argument("arguments");
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    vector<aisdi::BenchmarkRecord> baseline, candidate;
+    try
+    {
+        baseline=load(files[0]);
+        candidate=load(files[1]);
+    }
+    catch (const std::runtime_error& e)
+    {
+        cerr << e.what() << endl;
+        return 2;
+    }
+
+    const vector<aisdi::BenchmarkChange> changes=aisdi::compareResults(baseline, candidate, threshold);
+    size_t regressions=0, improvements=0;
+    cout << setw(24) << left << "engine" << setw(12) << "operation" << setw(10) << "size"
+         << setw(16) << "distribution" << right << setw(12) << "baseline" << setw(12) << "candidate"
+         << setw(10) << "change" << endl;
+    for (const auto& c : changes)
+    {
+        // keep the output to what moved
+        if (!c.regression && !c.improvement)
+        {
+            continue;
+        }
+        regressions+=c.regression;
+        improvements+=c.improvement;
+        cout << setw(24) << left << c.baseline.engine << setw(12) << c.baseline.operation << setw(10) << c.baseline.size
+             << setw(16) << c.baseline.distribution << right << fixed << setprecision(1)
+             << setw(12) << c.baseline.stats.median << setw(12) << c.candidate.stats.median
+             << setw(9) << showpos << c.change*100 << noshowpos << "%"
+             << (c.regression ? "  REGRESSION" : "  improved") << endl;
+    }
+    printUnmatched(changes, baseline, "baseline");
+    printUnmatched(changes, candidate, "candidate");
+    size_t untested=0;
+    for (const auto& c : changes)
+    {
+        untested+=c.baseline.stats.runs<2 || c.candidate.stats.runs<2;
+    }
+    if (untested>0)
+    {
+        cout << untested << " results have a single run on a side and are judged by the threshold alone" << endl;
+    }
+    cout << changes.size() << " results compared at a " << threshold*100 << "% threshold: "
+         << regressions << " regressions, " << improvements << " improvements" << endl;
+    return regressions>0 ? 1 : 0;
+}
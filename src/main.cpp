@@ -1,143 +1,550 @@
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
-#include <chrono>
 #include <ctime>
 #include <random>
+#include <functional>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "Benchmark.h"
+#include "BenchmarkReport.h"
+#include "Engines.h"
+#include "Workload.h"
 #include "TreeMap.h"
 #include "HashMap.h"
+#include "ConcurrentSkipListMap.h"
 
 using namespace std;
 
 namespace
 {
-  chrono::high_resolution_clock::time_point tickTime()
+// ********************** BASIC OPERATIONS *********************************************************
+  using Key=aisdi::WorkloadGenerator::key_type;
+
+  // Keys to insert, hit lookups drawn by the chosen distribution, keys that
+  // miss and every key once more in another order for removal.
+  struct KeySet
+  {
+    vector<Key> keys;
+    vector<Key> hits;
+    vector<Key> misses;
+    vector<Key> removals;
+
+    KeySet(size_t numOfItems, const aisdi::KeyDistribution& distribution, std::uint64_t seed)
+    {
+      aisdi::WorkloadGenerator gen(seed);
+      keys=gen.keys(numOfItems, distribution);
+      hits=gen.accesses(keys, numOfItems, distribution);
+      misses=gen.absentKeys(keys, numOfItems);
+      removals=gen.shuffled(keys);
+    }
+  };
+
+  void check(bool condition, const string& what)
   {
-    return chrono::high_resolution_clock::now();
+    if (!condition)
+    {
+      throw std::runtime_error("Benchmark sanity check failed: "+what);
+    }
   }
 
-  void generateTab(size_t* table, size_t numOfItems)
+  // Insert, hit lookup, miss lookup, remove and full iteration over the keys
+  // of one KeySet, for each engine it is run with. Results are checked so
+  // that no loop can be optimized away. With latency set, each phase but the
+  // iteration also gets a round timing every operation.
+  class BasicOperations
   {
-    std::random_device rd{};
-    std::mt19937 gen{rd()};
-    std::normal_distribution<> d{50000, 40000};
+    const KeySet& set;
+    const aisdi::Benchmark& bench;
+    const bool latency;
 
-    size_t check, key;
-    for (size_t i=0; i<numOfItems; i++)
+    // op(i) is the i-th operation of the phase, finish() ends it.
+    template<typename Prepare, typename Op, typename Finish>
+    void phase(const string& engine, const string& operation, Prepare prepare, Op op, Finish finish)
     {
-      do
+      const size_t numOfItems=set.keys.size();
+      aisdi::BenchmarkResult result{engine, operation, numOfItems, aisdi::BenchmarkStats(),
+                                    aisdi::LatencyHistogram(), aisdi::PerfSample()};
+      result.stats=bench.measure(numOfItems, prepare, [&]()
       {
-        check=0;
-        key = abs(std::round(d(gen)));
-        for (size_t j = 0; j < i; ++j)
+        for (size_t i=0; i<numOfItems; i++)
         {
-          if (table[j] == key)
-          {
-            check=1;
-            break;
-          }
+          op(i);
         }
-      } while(check==1);
-      table[i]=key;
+        finish();
+      }, result.counters);
+      if (latency)
+      {
+        result.latency=bench.latencies(numOfItems, prepare, op);
+        finish();
+      }
+      results.push_back(result);
     }
-    return;
-  }
 
-  template<typename K, typename V>
-  void perfomTest(size_t numOfItems, size_t* table)
-  {
-      aisdi::TreeMap<K,V> testTree;
-      aisdi::HashMap<K,V> testMap;
+  public:
+    vector<aisdi::BenchmarkResult> results;
+
+    BasicOperations(const KeySet& keySet, const aisdi::Benchmark& benchmark, bool perOperation)
+    : set(keySet), bench(benchmark), latency(perOperation)
+    {}
 
-//********************* APPENDING ITEMS *******************
-      size_t i=0;
-      size_t numOfElToAppend=100;
-      while (i<numOfItems-numOfElToAppend)
+    template<typename Engine>
+    void run(const string& engine)
+    {
+      const size_t numOfItems=set.keys.size();
+      const string value="QWERTY";
+      std::unique_ptr<Engine> map;
+      size_t found=0;
+      auto empty=[&]()
       {
-        testTree[table[i]] = "QWERTY";
-        i++;
-      }
-      auto startT=tickTime();
-      while (i<numOfElToAppend)
+        map.reset();
+        map.reset(new Engine(numOfItems));
+      };
+      auto insert=[&](size_t i)
       {
-        testTree[table[i]] = "QWERTY";
-        i++;
-      }
-      auto endT=tickTime();
-      auto timeOfAppendToTree=(endT-startT).count();
+        map->put(Engine::keyOf(set.keys[i]), value);
+      };
+      auto loaded=[&]()
+      {
+        map->finishLoad();
+        check(map->size()==numOfItems, engine+" insert");
+      };
+      auto fill=[&]()
+      {
+        empty();
+        for (size_t i=0; i<numOfItems; i++)
+        {
+          insert(i);
+        }
+        loaded();
+      };
+      auto resetFound=[&]()
+      {
+        found=0;
+      };
 
-      i=0;
-      while (i<numOfItems-numOfElToAppend)
+      phase(engine, "insert", empty, insert, loaded);
+      phase(engine, "hit", resetFound, [&](size_t i)
       {
-        testMap[table[i]] = "QWERTY";
-        i++;
-      }
-      auto startM=tickTime();
-      while (i<numOfElToAppend)
+        found+=map->contains(Engine::keyOf(set.hits[i]));
+      }, [&]()
       {
-        testMap[table[i]] = "QWERTY";
-        i++;
-      }
-      auto endM=tickTime();
-      auto timeOfAppendToMap=(endM-startM).count();
+        check(found==numOfItems, engine+" hit lookup");
+      });
+      phase(engine, "miss", resetFound, [&](size_t i)
+      {
+        found+=map->contains(Engine::keyOf(set.misses[i]));
+      }, [&]()
+      {
+        check(found==0, engine+" miss lookup");
+      });
+      aisdi::BenchmarkResult iterate{engine, "iterate", numOfItems, aisdi::BenchmarkStats(),
+                                     aisdi::LatencyHistogram(), aisdi::PerfSample()};
+      iterate.stats=bench.measure(numOfItems, []() {}, [&]()
+      {
+        size_t count=0;
+        map->forEach([&count](const typename Engine::key_type&, const string&)
+        {
+          count++;
+        });
+        check(count==numOfItems, engine+" iteration");
+      }, iterate.counters);
+      results.push_back(iterate);
 
-// ********************** FINDING ITEM *********************************************************
-      size_t numOfElToFind=100;
-      auto startFT=tickTime();
-      for(i=0; i<numOfElToFind; i++)
+      if (Engine::writable)
       {
-        auto findedElementT = testTree.find(table[i]);
-        (void)findedElementT;
+        phase(engine, "remove", fill, [&](size_t i)
+        {
+          map->remove(Engine::keyOf(set.removals[i]));
+        }, [&]()
+        {
+          check(map->size()==0, engine+" remove");
+        });
       }
-      auto endFT=tickTime();
-      auto timeOfFindingsize_tree=(endFT-startFT).count();
+    }
+  };
 
-      auto startFM=tickTime();
-      for(i=0; i<numOfElToFind; i++)
+  void basicOperationsTest(size_t numOfItems, const vector<string>& engines,
+                           const aisdi::KeyDistribution& distribution, std::uint64_t seed,
+                           const aisdi::Benchmark& bench, bool latency, vector<aisdi::BenchmarkResult>& all)
+  {
+    const KeySet set(numOfItems, distribution, seed);
+    BasicOperations test(set, bench, latency);
+    for (const string& engine : engines)
+    {
+      aisdi::visitEngine<string>(engine, test);
+    }
+    aisdi::printTable(cout, test.results);
+    cout << endl;
+    if (latency)
+    {
+      aisdi::printLatencies(cout, test.results);
+      cout << endl;
+    }
+    aisdi::printCounters(cout, test.results);
+    all.insert(all.end(), test.results.begin(), test.results.end());
+  }
+
+// ********************** SKEWED LOOKUPS *********************************************************
+  template<typename Map>
+  aisdi::BenchmarkResult lookupRun(const string& engine, Map& map, const vector<Key>& lookups,
+                                   size_t numOfItems, const string& operation, const aisdi::Benchmark& bench)
+  {
+    aisdi::BenchmarkResult result{engine, operation, numOfItems, aisdi::BenchmarkStats(),
+                                  aisdi::LatencyHistogram(), aisdi::PerfSample()};
+    result.stats=bench.measure(lookups.size(), []() {}, [&]()
+    {
+      size_t found=0;
+      for (Key key : lookups)
       {
-        auto findedElementM = testMap.find(table[i]);
-        (void)findedElementM;
+        if (map.find(key)!=map.end())
+        {
+          found++;
+        }
       }
-      auto endFM=tickTime();
-      auto timeOfFindingInMap=(endFM-startFM).count();
+      check(found==lookups.size(), engine+" skewed lookup");
+    }, result.counters);
+    return result;
+  }
 
-// ********************** REMOVING ITEMS *********************************************************
-      size_t numOfElTORem=10;
-      auto startRT=tickTime();
-      for(i=0; i<numOfElTORem; i++)
+  // Hot keys are scattered over the whole key range, so only a tree that
+  // adapts to the access pattern keeps them close to the root. The splay
+  // tree keeps the shape the warmup rounds gave it.
+  void skewedLookupTest(size_t numOfItems, size_t numOfLookups, double exponent, const aisdi::Benchmark& bench)
+  {
+    aisdi::WorkloadGenerator gen(2024);
+    vector<Key> keys=gen.keys(numOfItems, aisdi::KeyDistribution::sequential());
+    for (Key& key : keys)
+    {
+      key*=7;
+    }
+    keys=gen.shuffled(keys);
+
+    aisdi::TreeMap<size_t,string> tree;
+    aisdi::TreeMap<size_t,string,std::less<size_t>,aisdi::NoAggregate,aisdi::SplayAccess> splayTree;
+    std::map<size_t,string> balancedTree;
+    for (Key key : keys)
+    {
+      tree[key]="QWERTY";
+      splayTree[key]="QWERTY";
+      balancedTree[key]="QWERTY";
+    }
+
+    // ranks are assigned independently of the insertion order, otherwise the
+    // hot keys would sit near the root of the unbalanced tree from the start
+    vector<Key> lookups=gen.accesses(keys, numOfLookups, aisdi::KeyDistribution::zipfian(exponent));
+
+    std::ostringstream operation;
+    operation << "zipf:" << exponent;
+    vector<aisdi::BenchmarkResult> results;
+    results.push_back(lookupRun("TreeMap", tree, lookups, numOfItems, operation.str(), bench));
+    results.push_back(lookupRun("SplayTreeMap", splayTree, lookups, numOfItems, operation.str(), bench));
+    results.push_back(lookupRun("std::map", balancedTree, lookups, numOfItems, operation.str(), bench));
+    aisdi::printTable(cout, results);
+    aisdi::printCounters(cout, results);
+    cout << endl;
+  }
+
+// ********************** CONCURRENT ACCESS *********************************************************
+  template<typename Map>
+  void put(Map& map, size_t key, const string& value)
+  {
+    map[key]=value;
+  }
+
+  // operator[] would publish the entry before the value is assigned
+  void put(aisdi::ConcurrentSkipListMap<size_t,string>& map, size_t key, const string& value)
+  {
+    map.insert(key, value);
+  }
+
+  // Mixed workload (80% find, 10% insert, 10% remove) over a shared key range,
+  // every thread running the same number of operations.
+  template<typename Map, typename Lock>
+  void concurrentRun(Map& map, Lock lock, size_t numOfThreads, size_t opsPerThread, size_t keyRange)
+  {
+    vector<thread> workers;
+    for (size_t t=0; t<numOfThreads; t++)
+    {
+      workers.push_back(thread([&map, lock, t, opsPerThread, keyRange]()
       {
-        testTree.remove(table[i]);
-      }
-      auto endRT=tickTime();
-      auto timeOfRemoveFromTree=(endRT-startRT).count();
-      auto startRM =tickTime();
-      for(i=0; i<numOfElTORem;  i++)
+        std::mt19937 gen(static_cast<unsigned>(t+1));
+        std::uniform_int_distribution<size_t> keys(0, keyRange-1);
+        std::uniform_int_distribution<int> ops(0, 9);
+        for (size_t i=0; i<opsPerThread; i++)
+        {
+          size_t key=keys(gen);
+          int op=ops(gen);
+          lock([&map, key, op]()
+          {
+            if (op==0)
+            {
+              put(map, key, "QWERTY");
+            }
+            else if (op==1)
+            {
+              auto it=map.find(key);
+              if (it!=map.end())
+              {
+                try
+                {
+                  map.remove(it);
+                }
+                catch (const std::out_of_range&)
+                {
+                  // removed concurrently by another thread
+                }
+              }
+            }
+            else
+            {
+              auto it=map.find(key);
+              (void)it;
+            }
+          });
+        }
+      }));
+    }
+    for (auto& w : workers)
+    {
+      w.join();
+    }
+  }
+
+  // Every round starts from the same half-full map. Times are wall-clock
+  // per operation over all threads, so perfect scaling halves them as the
+  // threads double. Hardware counters would only see the main thread, so
+  // none are taken.
+  template<typename Map, typename Lock>
+  aisdi::BenchmarkResult concurrentResult(const string& engine, Lock lock, size_t numOfThreads,
+                                          size_t opsPerThread, size_t keyRange, const aisdi::Benchmark& bench)
+  {
+    std::ostringstream operation;
+    operation << numOfThreads << (numOfThreads==1 ? " thread" : " threads");
+    aisdi::BenchmarkResult result{engine, operation.str(), keyRange, aisdi::BenchmarkStats(),
+                                  aisdi::LatencyHistogram(), aisdi::PerfSample()};
+    std::unique_ptr<Map> map;
+    result.stats=bench.measure(numOfThreads*opsPerThread, [&]()
+    {
+      map.reset();
+      map.reset(new Map());
+      std::mt19937 gen(12345);
+      std::uniform_int_distribution<size_t> keys(0, keyRange-1);
+      for (size_t i=0; i<keyRange/2; i++)
       {
-        testMap.remove(table[i]);
+        put(*map, keys(gen), "QWERTY");
       }
-      auto endRM=tickTime();
-      auto timeOfRemoveFromMap=(endRM-startRM).count();
-
-//  ******************************* RESULTS: *******************************************************
-      cout <<"Time of appending " << numOfElToAppend << " elements to the tree: \t" <<timeOfAppendToTree << endl;
-      cout <<"Time of appending " << numOfElToAppend << " elements to the map: \t" <<timeOfAppendToMap << endl<<endl;
-      cout <<"Time of finding " << numOfElToFind <<" elements in the tree: \t" <<timeOfFindingsize_tree << endl;
-      cout <<"Time of finding " << numOfElToFind << " elements in the map: \t" <<timeOfFindingInMap << endl<<endl;
-      cout <<"Time of removing " << numOfElTORem << " elements from the tree: \t" <<timeOfRemoveFromTree << endl;
-      cout <<"Time of removing " << numOfElTORem << " elements from the map: \t" <<timeOfRemoveFromMap << endl<<endl;
+    }, [&]()
+    {
+      concurrentRun(*map, lock, numOfThreads, opsPerThread, keyRange);
+    });
+    return result;
+  }
+
+  void concurrentTest(size_t keyRange, size_t opsPerThread, const aisdi::Benchmark& bench)
+  {
+    const size_t threadCounts[]={1, 2, 4, 8};
+    std::mutex treeMutex;
+    auto guarded=[&treeMutex](const std::function<void()>& op)
+    {
+      std::lock_guard<std::mutex> guard(treeMutex);
+      op();
+    };
+    auto unguarded=[](const std::function<void()>& op)
+    {
+      op();
+    };
+    vector<aisdi::BenchmarkResult> results;
+    for (size_t numOfThreads : threadCounts)
+    {
+      results.push_back(concurrentResult<aisdi::TreeMap<size_t,string>>("TreeMap + mutex", guarded,
+                                                                        numOfThreads, opsPerThread, keyRange, bench));
+      results.push_back(concurrentResult<aisdi::ConcurrentSkipListMap<size_t,string>>("ConcurrentSkipListMap",
+                                                                                       unguarded, numOfThreads,
+                                                                                       opsPerThread, keyRange, bench));
+    }
+    cout << opsPerThread << " operations per thread" << endl;
+    aisdi::printTable(cout, results);
+    cout << endl;
+  }
+
+  void usage(const char* name)
+  {
+    cout << "Usage: " << name << " [--sizes N,N,...] [--engines E,E,...]\n"
+         << "       [--distribution D] [--seed N] [--runs N] [--warmup N]\n"
+         << "       [--latency] [--counters] [--csv FILE] [--json FILE]\n"
+         << "       [--skip-skewed] [--skip-concurrent]\n"
+         << "D is uniform, zipf[:s], sequential, normal[:spread] or clustered[:count]\n"
+         << "E is one of";
+    for (const string& engine : aisdi::engineNames())
+    {
+      cout << " " << engine;
+    }
+    cout << endl;
   }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-    size_t keyTab[100000];
-    generateTab(keyTab,100000);
-    cout <<"Collection size 1000" <<endl;
-    perfomTest<size_t,string>(1000,keyTab);
-    cout <<"Collection size 10000" <<endl;
-    perfomTest<size_t,string>(10000,keyTab);
-    cout <<"Collection size 100000" <<endl;
-    perfomTest<size_t,string>(100000,keyTab);
+    vector<size_t> sizes={1000, 10000, 100000, 1000000};
+    vector<string> engines={"TreeMap", "HashMap", "std::map", "std::unordered_map"};
+    size_t runs=5, warmup=1;
+    aisdi::KeyDistribution distribution=aisdi::KeyDistribution::uniform();
+    std::uint64_t seed=2024;
+    bool skewed=true, concurrent=true, latency=false, counting=false;
+    string csvFile, jsonFile;
+    try
+    {
+        for (int i=1; i<argc; i++)
+        {
+            string arg=argv[i];
+            bool hasValue=i+1<argc;
+            if (arg=="--sizes" && hasValue)
+            {
+                sizes.clear();
+                std::istringstream list(argv[++i]);
+                string item;
+                while (std::getline(list, item, ','))
+                {
+                    sizes.push_back(std::stoull(item));
+                }
+            }
+            else if (arg=="--engines" && hasValue)
+            {
+                engines.clear();
+                std::istringstream list(argv[++i]);
+                string item;
+                while (std::getline(list, item, ','))
+                {
+                    const auto& names=aisdi::engineNames();
+                    if (std::find(names.begin(), names.end(), item)==names.end())
+                    {
+                        throw std::invalid_argument("Unknown engine: "+item);
+                    }
+                    engines.push_back(item);
+                }
+            }
+            else if (arg=="--distribution" && hasValue)
+            {
+                distribution=aisdi::KeyDistribution::parse(argv[++i]);
+            }
+            else if (arg=="--seed" && hasValue)
+            {
+                seed=std::stoull(argv[++i]);
+            }
+            else if (arg=="--runs" && hasValue)
+            {
+                runs=std::stoull(argv[++i]);
+            }
+            else if (arg=="--warmup" && hasValue)
+            {
+                warmup=std::stoull(argv[++i]);
+            }
+            else if (arg=="--csv" && hasValue)
+            {
+                csvFile=argv[++i];
+            }
+            else if (arg=="--json" && hasValue)
+            {
+                jsonFile=argv[++i];
+            }
+            else if (arg=="--counters")
+            {
+                counting=true;
+            }
+            else if (arg=="--latency")
+            {
+                latency=true;
+            }
+            else if (arg=="--skip-skewed")
+            {
+                skewed=false;
+            }
+            else if (arg=="--skip-concurrent")
+            {
+                concurrent=false;
+            }
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // opened up front, so that a bad path does not waste a whole run
+    std::ofstream csv, json;
+    if (!csvFile.empty())
+    {
+        csv.open(csvFile);
+    }
+    if (!jsonFile.empty())
+    {
+        json.open(jsonFile);
+    }
+    if ((!csvFile.empty() && !csv) || (!jsonFile.empty() && !json))
+    {
+        cerr << "Cannot write " << (!csv ? csvFile : jsonFile) << endl;
+        return 1;
+    }
+
+    aisdi::Benchmark bench(warmup, runs);
+    vector<aisdi::BenchmarkResult> results;
+    std::unique_ptr<aisdi::PerfCounters> counters;
+    if (counting)
+    {
+        counters.reset(new aisdi::PerfCounters());
+        if (!counters->available())
+        {
+            cout << "Hardware counters unavailable (" << counters->unavailableReason() << "), timing only" << endl;
+        }
+        else if (!counters->unavailableReason().empty())
+        {
+            cout << "Some hardware counters unavailable (" << counters->unavailableReason() << ")" << endl;
+        }
+        bench.setCounters(counters.get());
+    }
+    cout << "Basic operations on " << distribution.name() << " keys, " << warmup << " warmup and "
+         << runs << " timed runs each" << endl;
+    for (size_t numOfItems : sizes)
+    {
+        basicOperationsTest(numOfItems, engines, distribution, seed, bench, latency, results);
+    }
+    const aisdi::RunInfo info=aisdi::RunInfo::current(distribution.name(), seed, warmup, runs);
+    if (csv.is_open())
+    {
+        aisdi::writeCsv(csv, info, results);
+    }
+    if (json.is_open())
+    {
+        aisdi::writeJson(json, info, results);
+    }
+    if (skewed)
+    {
+        cout <<"Zipfian lookups, 2000000 per run" <<endl;
+        skewedLookupTest(1000000,2000000,0.99,bench);
+        skewedLookupTest(1000000,2000000,1.2,bench);
+    }
+    if (concurrent)
+    {
+        cout <<"Concurrent access, key range 100000" <<endl;
+        concurrentTest(100000,200000,bench);
+    }
     return 0;
 }
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Engines.h"
+#include "Workload.h"
+
+using namespace std;
+
+namespace
+{
+  // Every block handed out by operator new is prefixed with its size, so
+  // that operator delete can take it off the count. Counted are the bytes
+  // asked for, not the allocator's own headers and rounding.
+  const size_t headerSize=alignof(std::max_align_t);
+
+  std::atomic<size_t> liveBytes(0);
+  std::atomic<size_t> peakBytes(0);
+  std::atomic<size_t> numOfAllocations(0);
+
+  void* allocate(size_t size) noexcept
+  {
+    void* block=std::malloc(size+headerSize);
+    if (block==nullptr)
+    {
+      return nullptr;
+    }
+    *static_cast<size_t*>(block)=size;
+    size_t live=liveBytes+=size;
+    size_t peak=peakBytes.load();
+    while (live>peak && !peakBytes.compare_exchange_weak(peak, live))
+    {}
+    numOfAllocations++;
+    return static_cast<char*>(block)+headerSize;
+  }
+
+  void deallocate(void* p) noexcept
+  {
+    if (p==nullptr)
+    {
+      return;
+    }
+    void* block=static_cast<char*>(p)-headerSize;
+    liveBytes-=*static_cast<size_t*>(block);
+    std::free(block);
+  }
+
+  void* allocateOrThrow(size_t size)
+  {
+    void* p=allocate(size);
+    if (p==nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    return p;
+  }
+}
+
+void* operator new(size_t size)
+{
+  return allocateOrThrow(size);
+}
+
+void* operator new[](size_t size)
+{
+  return allocateOrThrow(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  deallocate(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+  deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  deallocate(p);
+}
+
+namespace
+{
+  using Key=aisdi::WorkloadGenerator::key_type;
+
+  struct Config
+  {
+    size_t keyLength=24;
+    size_t valueSize=32;
+    std::uint64_t seed=2024;
+  };
+
+  // Makes keys and values of a given type and tells how many bytes of
+  // payload they carry. Strings are long enough to live on the heap.
+  template<typename T>
+  struct Data;
+
+  template<>
+  struct Data<Key>
+  {
+    static const char* name()
+    {
+      return "u64";
+    }
+
+    static Key make(Key key, size_t)
+    {
+      return key;
+    }
+
+    static size_t bytes(size_t)
+    {
+      return sizeof(Key);
+    }
+  };
+
+  template<>
+  struct Data<string>
+  {
+    static const char* name()
+    {
+      return "string";
+    }
+
+    static string make(Key key, size_t length)
+    {
+      return aisdi::WorkloadGenerator::stringKey(key, length);
+    }
+
+    static size_t bytes(size_t length)
+    {
+      return length;
+    }
+  };
+
+  struct Footprint
+  {
+    size_t steady;
+    size_t peak;
+    size_t allocations;
+    size_t leaked;
+  };
+
+  // Loads a fresh engine with keys, counting what it allocates on the way;
+  // the keys themselves are made beforehand and not counted.
+  template<typename Engine>
+  Footprint measure(const vector<typename Engine::key_type>& keys, const typename Engine::mapped_type& value)
+  {
+    Footprint f;
+    size_t base=liveBytes.load();
+    size_t allocationsBefore=numOfAllocations.load();
+    peakBytes=base;
+    {
+      Engine engine(keys.size());
+      for (const auto& key : keys)
+      {
+        engine.put(key, value);
+      }
+      engine.finishLoad();
+      f.steady=liveBytes.load()-base;
+      f.peak=peakBytes.load()-base;
+      f.allocations=numOfAllocations.load()-allocationsBefore;
+    }
+    f.leaked=liveBytes.load()-base;
+    return f;
+  }
+
+  // Prints one line per engine with the footprint of numOfItems entries
+  // keyed by keyType.
+  template<typename Value>
+  class Report
+  {
+    const Config& config;
+    const size_t numOfItems;
+    const string keyType;
+
+  public:
+    Report(const Config& c, size_t n, const string& k)
+    : config(c), numOfItems(n), keyType(k)
+    {}
+
+    void skip(const string& name)
+    {
+      cout << setw(8) << keyType << setw(8) << Data<Value>::name() << setw(10) << numOfItems
+           << "  " << setw(24) << left << name << right << "skipped: no " << keyType << " keys" << endl;
+    }
+
+    template<typename Engine>
+    void run(const string& name)
+    {
+      using K=typename Engine::key_type;
+      using V=typename Engine::mapped_type;
+      if (Data<K>::name()!=keyType)
+      {
+        skip(name);
+        return;
+      }
+      aisdi::WorkloadGenerator gen(config.seed);
+      vector<K> keys;
+      keys.reserve(numOfItems);
+      for (Key key : gen.keys(numOfItems, aisdi::KeyDistribution::uniform()))
+      {
+        keys.push_back(Data<K>::make(key, config.keyLength));
+      }
+      const V value=Data<V>::make(gen.below(~Key(0)), config.valueSize);
+      Footprint f=measure<Engine>(keys, value);
+
+      double n=static_cast<double>(numOfItems);
+      double payload=Data<K>::bytes(config.keyLength)+Data<V>::bytes(config.valueSize);
+      cout << setw(8) << Data<K>::name() << setw(8) << Data<V>::name() << setw(10) << numOfItems
+           << "  " << setw(24) << left << name << right << fixed << setprecision(1)
+           << setw(10) << f.steady/n << setw(10) << f.steady/n-payload << setw(10) << f.peak/n
+           << setprecision(2) << setw(10) << f.allocations/n
+           << setw(12) << f.steady/1024 << setw(12) << f.peak/1024;
+      if (f.leaked>0)
+      {
+        cout << "  leaked " << f.leaked << " B";
+      }
+      cout << endl;
+    }
+  };
+
+  // Engines that also take string keys; the rest of the registry is
+  // keyed by integers only.
+  template<typename Value, typename Visitor>
+  bool visitStringKeyedEngine(const string& name, Visitor& visitor)
+  {
+    if (name=="TreeMap")
+    {
+      visitor.template run<aisdi::MapEngine<aisdi::TreeMap<string, Value>>>(name);
+    }
+    else if (name=="std::map")
+    {
+      visitor.template run<aisdi::MapEngine<std::map<string, Value>>>(name);
+    }
+    else if (name=="std::unordered_map")
+    {
+      visitor.template run<aisdi::MapEngine<std::unordered_map<string, Value>>>(name);
+    }
+    else if (name=="RadixTreeMap")
+    {
+      aisdi::visitEngine<Value>(name, visitor);
+    }
+    else
+    {
+      return false;
+    }
+    return true;
+  }
+
+  template<typename Value>
+  void footprintTest(const vector<string>& keyTypes, const vector<string>& engines, size_t numOfItems,
+                     const Config& config)
+  {
+    for (const string& keyType : keyTypes)
+    {
+      Report<Value> report(config, numOfItems, keyType);
+      for (const string& engine : engines)
+      {
+        if (keyType=="u64")
+        {
+          aisdi::visitEngine<Value>(engine, report);
+        }
+        else if (!visitStringKeyedEngine<Value>(engine, report))
+        {
+          report.skip(engine);
+        }
+      }
+    }
+  }
+
+  vector<string> splitList(const string& text)
+  {
+    vector<string> items;
+    std::istringstream list(text);
+    string item;
+    while (std::getline(list, item, ','))
+    {
+      items.push_back(item);
+    }
+    return items;
+  }
+
+  void usage(const char* name)
+  {
+    cout << "Usage: " << name << " [--sizes N,N,...] [--engines E,E,...] [--keys T,T,...]\n"
+         << "       [--values T,T,...] [--key-length N] [--value-size N] [--seed N]\n"
+         << "T is u64 or string; string keys work with TreeMap, RadixTreeMap, std::map\n"
+         << "and std::unordered_map\n"
+         << "E is one of";
+    for (const string& engine : aisdi::engineNames())
+    {
+      cout << " " << engine;
+    }
+    cout << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    vector<size_t> sizes={1000, 100000, 1000000};
+    vector<string> engines={"TreeMap", "HashMap", "std::map", "std::unordered_map"};
+    vector<string> keyTypes={"u64", "string"};
+    vector<string> valueTypes={"u64", "string"};
+    try
+    {
+        for (int i=1; i<argc; i++)
+        {
+            string arg=argv[i];
+            if (i+1>=argc)
+            {
+                throw std::invalid_argument(arg);
+            }
+            string value=argv[++i];
+            if (arg=="--sizes")
+            {
+                sizes.clear();
+                for (const string& n : splitList(value))
+                {
+                    sizes.push_back(std::stoull(n));
+                }
+            }
+            else if (arg=="--engines")
+            {
+                engines=splitList(value);
+                for (const string& engine : engines)
+                {
+                    const auto& names=aisdi::engineNames();
+                    if (std::find(names.begin(), names.end(), engine)==names.end())
+                    {
+                        throw std::invalid_argument(engine);
+                    }
+                }
+            }
+            else if (arg=="--keys" || arg=="--values")
+            {
+                vector<string>& types=arg=="--keys" ? keyTypes : valueTypes;
+                types=splitList(value);
+                for (const string& type : types)
+                {
+                    if (type!="u64" && type!="string")
+                    {
+                        throw std::invalid_argument(type);
+                    }
+                }
+            }
+            else if (arg=="--key-length")
+            {
+                config.keyLength=std::stoull(value);
+            }
+            else if (arg=="--value-size")
+            {
+                config.valueSize=std::stoull(value);
+            }
+            else if (arg=="--seed")
+            {
+                config.seed=std::stoull(value);
+            }
+            else
+            {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (config.keyLength<aisdi::WorkloadGenerator::keyDigits || config.valueSize<aisdi::WorkloadGenerator::keyDigits)
+        {
+            throw std::invalid_argument("length");
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    cout << "Heap footprint after loading, string keys of " << config.keyLength << " and string values of "
+         << config.valueSize << " bytes; overhead is what an entry takes beyond its key and value bytes" << endl;
+    cout << setw(8) << "keys" << setw(8) << "values" << setw(10) << "size" << "  " << setw(24) << left << "engine"
+         << right << setw(10) << "B/entry" << setw(10) << "overhead" << setw(10) << "peak B/e"
+         << setw(10) << "allocs/e" << setw(12) << "steady KiB" << setw(12) << "peak KiB" << endl;
+    for (size_t numOfItems : sizes)
+    {
+        for (const string& valueType : valueTypes)
+        {
+            if (valueType=="u64")
+            {
+                footprintTest<Key>(keyTypes, engines, numOfItems, config);
+            }
+            else
+            {
+                footprintTest<string>(keyTypes, engines, numOfItems, config);
+            }
+        }
+    }
+    return 0;
+}
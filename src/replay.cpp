@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Engines.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
+
+using namespace std;
+
+namespace
+{
+  using Clock=chrono::steady_clock;
+  using aisdi::TraceRecord;
+
+  const char* const operationNames[]={"get", "put", "remove", "scan"};
+  const int numOfOperations=4;
+
+  // A trace with what replaying it needs prepared up front: a value of the
+  // recorded size for every put.
+  struct Trace
+  {
+    vector<TraceRecord> records;
+    vector<const string*> values;
+    std::map<std::uint64_t, string> valuesBySize;
+    size_t counts[numOfOperations]={0, 0, 0, 0};
+
+    explicit Trace(std::istream& in)
+    : records(aisdi::TraceReader(in).readAll())
+    {
+      for (const TraceRecord& r : records)
+      {
+        counts[r.operation]++;
+        const string* value=nullptr;
+        if (r.operation==TraceRecord::Put)
+        {
+          auto it=valuesBySize.find(r.size);
+          if (it==valuesBySize.end())
+          {
+            it=valuesBySize.insert(make_pair(r.size, string(r.size, 'v'))).first;
+          }
+          value=&it->second;
+        }
+        values.push_back(value);
+      }
+    }
+  };
+
+  // Replays a trace against every engine, once as fast as possible for the
+  // throughput and once more with every operation timed on its own.
+  class Replay
+  {
+    const Trace& trace;
+
+  public:
+    explicit Replay(const Trace& t)
+    : trace(t)
+    {}
+
+    template<typename Engine>
+    void run(const string& name)
+    {
+      cout << setw(24) << left << name << right;
+      if (!Engine::writable && (trace.counts[TraceRecord::Put]>0 || trace.counts[TraceRecord::Remove]>0))
+      {
+        cout << "skipped: read-only engine" << endl;
+        return;
+      }
+      if (!Engine::ordered && trace.counts[TraceRecord::Scan]>0)
+      {
+        cout << "skipped: unordered engine" << endl;
+        return;
+      }
+      vector<typename Engine::key_type> keys;
+      keys.reserve(trace.records.size());
+      for (const TraceRecord& r : trace.records)
+      {
+        keys.push_back(Engine::keyOf(r.key));
+      }
+
+      size_t misses=0;
+      std::unique_ptr<Engine> engine(new Engine(trace.counts[TraceRecord::Put]));
+      auto start=Clock::now();
+      for (size_t i=0; i<trace.records.size(); i++)
+      {
+        misses+=!apply(*engine, i, keys[i]);
+      }
+      double elapsed=chrono::duration<double>(Clock::now()-start).count();
+
+      aisdi::LatencyHistogram latency[numOfOperations];
+      const Clock::duration overhead=aisdi::Benchmark::clockOverhead();
+      engine.reset(new Engine(trace.counts[TraceRecord::Put]));
+      for (size_t i=0; i<trace.records.size(); i++)
+      {
+        auto opStart=Clock::now();
+        apply(*engine, i, keys[i]);
+        auto time=Clock::now()-opStart;
+        latency[trace.records[i].operation].record(time>overhead ? time-overhead : Clock::duration::zero());
+      }
+
+      cout << setw(14) << fixed << setprecision(0) << trace.records.size()/elapsed
+           << setw(12) << trace.records.size() << setw(10) << misses << endl;
+      for (int op=0; op<numOfOperations; op++)
+      {
+        const aisdi::LatencyHistogram& h=latency[op];
+        if (h.getCount()>0)
+        {
+          cout << setw(34) << operationNames[op] << setw(10) << h.percentile(50) << setw(10) << h.percentile(90)
+               << setw(10) << h.percentile(99) << setw(10) << h.percentile(99.9) << setw(10) << h.getMax() << endl;
+        }
+      }
+    }
+
+  private:
+    // Returns false for a get or scan that found nothing or a remove of a
+    // missing key.
+    template<typename Engine>
+    bool apply(Engine& engine, size_t i, const typename Engine::key_type& key)
+    {
+      const TraceRecord& r=trace.records[i];
+      typename Engine::mapped_type out;
+      switch (r.operation)
+      {
+      case TraceRecord::Get:
+        return engine.get(key, out);
+      case TraceRecord::Put:
+        engine.put(key, *trace.values[i]);
+        return true;
+      case TraceRecord::Remove:
+        return engine.remove(key);
+      case TraceRecord::Scan:
+        return engine.scan(key, r.size, out)>0;
+      }
+      return false;
+    }
+  };
+
+  void usage(const char* name)
+  {
+    cout << "Usage: " << name << " TRACE [--engines E,E,...]\n"
+         << "Replays a trace recorded through aisdi::TracedMap against each engine\n"
+         << "E is one of";
+    for (const string& engine : aisdi::engineNames())
+    {
+      cout << " " << engine;
+    }
+    cout << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+    vector<string> engines={"TreeMap", "HashMap", "std::map", "std::unordered_map"};
+    string traceFile;
+    try
+    {
+        for (int i=1; i<argc; i++)
+        {
+            string arg=argv[i];
+            if (arg=="--engines" && i+1<argc)
+            {
+                engines.clear();
+                std::istringstream list(argv[++i]);
+                string item;
+                while (std::getline(list, item, ','))
+                {
+                    const auto& names=aisdi::engineNames();
+                    if (std::find(names.begin(), names.end(), item)==names.end())
+                    {
+                        throw std::invalid_argument(item);
+                    }
+                    engines.push_back(item);
+                }
+            }
+            else if (arg.compare(0, 2, "--")!=0 && traceFile.empty())
+            {
+                traceFile=arg;
+            }
+            else
+            {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (traceFile.empty())
+        {
+            throw std::invalid_argument("trace");
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(traceFile, std::ios::binary);
+    if (!file)
+    {
+        cerr << "Cannot read " << traceFile << endl;
+        return 1;
+    }
+    std::unique_ptr<Trace> trace;
+    try
+    {
+        trace.reset(new Trace(file));
+    }
+    catch (const std::runtime_error& e)
+    {
+        cerr << traceFile << ": " << e.what() << endl;
+        return 1;
+    }
+
+    double recorded=trace->records.empty() ? 0 : trace->records.back().time/1e9;
+    cout << trace->records.size() << " operations recorded over " << fixed << setprecision(3) << recorded << " s:";
+    for (int op=0; op<numOfOperations; op++)
+    {
+        cout << " " << trace->counts[op] << " " << operationNames[op];
+    }
+    cout << endl;
+    cout << setw(24) << left << "engine" << right << setw(14) << "ops/s" << setw(12) << "ops" << setw(10) << "misses" << endl;
+    cout << setw(34) << "latency" << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99"
+         << setw(10) << "p99.9" << setw(10) << "max [ns]" << endl;
+    Replay replay(*trace);
+    for (const string& engine : engines)
+    {
+        aisdi::visitEngine<string>(engine, replay);
+    }
+    return 0;
+}
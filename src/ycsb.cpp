@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Engines.h"
+#include "LatencyHistogram.h"
+#include "Workload.h"
+
+using namespace std;
+
+namespace
+{
+  using Key=aisdi::WorkloadGenerator::key_type;
+  using Clock=chrono::steady_clock;
+
+  // Core YCSB workloads: shares of each operation, and whether the keys read
+  // are skewed towards the latest inserted (D) rather than scrambled Zipfian.
+  struct Workload
+  {
+    char name;
+    double read;
+    double update;
+    double insert;
+    double scan;
+    double readModifyWrite;
+    bool latest;
+  };
+
+  const vector<Workload> workloads={
+    {'A', 0.50, 0.50, 0.00, 0.00, 0.00, false},
+    {'B', 0.95, 0.05, 0.00, 0.00, 0.00, false},
+    {'C', 1.00, 0.00, 0.00, 0.00, 0.00, false},
+    {'D', 0.95, 0.00, 0.05, 0.00, 0.00, true},
+    {'E', 0.00, 0.00, 0.05, 0.95, 0.00, false},
+    {'F', 0.50, 0.00, 0.00, 0.00, 0.50, false}
+  };
+
+  struct Config
+  {
+    size_t records=100000;
+    vector<size_t> threads={1, 4};
+    double seconds=2;
+    size_t valueSize=100;
+    size_t maxScanLength=100;
+    double zipfExponent=0.99;
+    std::uint64_t seed=2024;
+  };
+
+  enum Operation { Read, Update, Insert, Scan, ReadModifyWrite, numOfOperations };
+
+  const char* const operationNames[numOfOperations]={"read", "update", "insert", "scan", "rmw"};
+
+  // What one client did; clients' counts are merged after the run.
+  struct Counts
+  {
+    size_t ops=0;
+    size_t misses=0;
+    aisdi::LatencyHistogram latency[numOfOperations];
+
+    void merge(const Counts& other)
+    {
+      ops+=other.ops;
+      misses+=other.misses;
+      for (int op=0; op<numOfOperations; op++)
+      {
+        latency[op].merge(other.latency[op]);
+      }
+    }
+  };
+
+  // Runs one workload for a fixed time. Record n has key mix(n); records
+  // beyond the loaded ones are inserted in order, and reads pick among the
+  // records whose insertion has completed.
+  template<typename Engine>
+  class Run
+  {
+    const Workload& workload;
+    const Config& config;
+    const aisdi::ZipfGenerator& zipf;
+    Engine& engine;
+    std::mutex lock;
+    std::atomic<Key> nextRecord;
+    std::atomic<Key> inserted;
+    std::atomic<bool> stop;
+
+    // Runs op under the engine lock if it needs one; the latency recorded
+    // includes waiting for the lock, as a client would see it.
+    template<typename Op>
+    void locked(aisdi::LatencyHistogram& latency, Op op)
+    {
+      auto start=Clock::now();
+      if (Engine::threadSafe)
+      {
+        op();
+      }
+      else
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        op();
+      }
+      latency.record(Clock::now()-start);
+    }
+
+    Key chooseRecord(aisdi::WorkloadGenerator& gen)
+    {
+      Key count=inserted.load();
+      Key rank=zipf(gen.unit());
+      if (workload.latest)
+      {
+        return count-1-rank%count;
+      }
+      return aisdi::WorkloadGenerator::mix(rank)%count;
+    }
+
+    void client(size_t id, Counts& counts)
+    {
+      aisdi::WorkloadGenerator gen(config.seed*1000+id+1);
+      string value(config.valueSize, ' ');
+      for (char& c : value)
+      {
+        c=static_cast<char>('a'+gen.below(26));
+      }
+      typename Engine::mapped_type out;
+      while (!stop.load(std::memory_order_relaxed))
+      {
+        for (int batch=0; batch<64; batch++)
+        {
+          double op=gen.unit();
+          bool found=true;
+          if ((op-=workload.read)<0)
+          {
+            auto key=Engine::keyOf(aisdi::WorkloadGenerator::mix(chooseRecord(gen)));
+            locked(counts.latency[Read], [&]() { found=engine.get(key, out); });
+          }
+          else if ((op-=workload.update)<0)
+          {
+            auto key=Engine::keyOf(aisdi::WorkloadGenerator::mix(chooseRecord(gen)));
+            locked(counts.latency[Update], [&]() { engine.put(key, value); });
+          }
+          else if ((op-=workload.insert)<0)
+          {
+            Key record=nextRecord++;
+            auto key=Engine::keyOf(aisdi::WorkloadGenerator::mix(record));
+            locked(counts.latency[Insert], [&]() { engine.put(key, value); });
+            // publish in order, so that readers only see completed inserts
+            Key expected=record;
+            while (!inserted.compare_exchange_weak(expected, record+1))
+            {
+              expected=record;
+              std::this_thread::yield();
+            }
+          }
+          else if ((op-=workload.scan)<0)
+          {
+            auto key=Engine::keyOf(aisdi::WorkloadGenerator::mix(chooseRecord(gen)));
+            size_t length=1+gen.below(config.maxScanLength);
+            locked(counts.latency[Scan], [&]() { found=engine.scan(key, length, out)>0; });
+          }
+          else
+          {
+            auto key=Engine::keyOf(aisdi::WorkloadGenerator::mix(chooseRecord(gen)));
+            locked(counts.latency[ReadModifyWrite], [&]()
+            {
+              found=engine.get(key, out);
+              if (found)
+              {
+                out[0]=value[0];
+                engine.put(key, out);
+              }
+            });
+          }
+          counts.ops++;
+          counts.misses+=!found;
+        }
+      }
+    }
+
+  public:
+    Run(const Workload& w, const Config& c, const aisdi::ZipfGenerator& z, Engine& e)
+    : workload(w), config(c), zipf(z), engine(e), nextRecord(c.records), inserted(c.records), stop(false)
+    {}
+
+    // Returns the operations done by all clients and the elapsed seconds.
+    pair<Counts, double> operator()(size_t numOfThreads)
+    {
+      vector<Counts> counts(numOfThreads);
+      vector<thread> clients;
+      auto start=Clock::now();
+      for (size_t t=0; t<numOfThreads; t++)
+      {
+        clients.push_back(thread([this, t, &counts]() { client(t, counts[t]); }));
+      }
+      std::this_thread::sleep_for(chrono::duration<double>(config.seconds));
+      stop=true;
+      for (auto& c : clients)
+      {
+        c.join();
+      }
+      double elapsed=chrono::duration<double>(Clock::now()-start).count();
+      Counts total;
+      for (const auto& c : counts)
+      {
+        total.merge(c);
+      }
+      return make_pair(total, elapsed);
+    }
+  };
+
+  // Loads a fresh engine for every workload and thread count and prints the
+  // throughput of each run.
+  class Driver
+  {
+    const Config& config;
+    const vector<Workload>& selected;
+    const aisdi::ZipfGenerator zipf;
+
+  public:
+    Driver(const Config& c, const vector<Workload>& w)
+    : config(c), selected(w), zipf(c.records, c.zipfExponent)
+    {}
+
+    template<typename Engine>
+    void run(const string& name)
+    {
+      const string value(config.valueSize, 'x');
+      for (const Workload& workload : selected)
+      {
+        for (size_t numOfThreads : config.threads)
+        {
+          cout << setw(24) << left << name << setw(10) << workload.name << setw(8) << numOfThreads << right;
+          if (!Engine::writable && workload.read<1)
+          {
+            cout << "skipped: read-only engine" << endl;
+            continue;
+          }
+          if (!Engine::ordered && workload.scan>0)
+          {
+            cout << "skipped: unordered engine" << endl;
+            continue;
+          }
+          // room for the records inserted during the run, for engines that do not grow
+          std::unique_ptr<Engine> engine(new Engine(2*config.records));
+          for (Key record=0; record<config.records; record++)
+          {
+            engine->put(Engine::keyOf(aisdi::WorkloadGenerator::mix(record)), value);
+          }
+          engine->finishLoad();
+
+          Run<Engine> run(workload, config, zipf, *engine);
+          auto result=run(numOfThreads);
+          const Counts& counts=result.first;
+          cout << setw(14) << fixed << setprecision(0) << counts.ops/result.second
+               << setw(12) << counts.ops << setw(10) << counts.misses << endl;
+          for (int op=0; op<numOfOperations; op++)
+          {
+            const aisdi::LatencyHistogram& h=counts.latency[op];
+            if (h.getCount()>0)
+            {
+              cout << setw(42) << operationNames[op] << setw(10) << h.percentile(50) << setw(10) << h.percentile(90)
+                   << setw(10) << h.percentile(99) << setw(10) << h.percentile(99.9) << setw(10) << h.getMax() << endl;
+            }
+          }
+        }
+      }
+    }
+  };
+
+  vector<string> splitList(const string& text)
+  {
+    vector<string> items;
+    std::istringstream list(text);
+    string item;
+    while (std::getline(list, item, ','))
+    {
+      items.push_back(item);
+    }
+    return items;
+  }
+
+  void usage(const char* name)
+  {
+    cout << "Usage: " << name << " [--engines E,E,...] [--workloads A,B,...] [--threads N,N,...]\n"
+         << "       [--records N] [--duration SECONDS] [--value-size N] [--scan-length N]\n"
+         << "       [--zipf S] [--seed N]\n"
+         << "Workloads: A 50/50 read/update, B 95/5 read/update, C read-only,\n"
+         << "           D 95/5 read latest/insert, E 95/5 scan/insert, F 50/50 read/read-modify-write\n"
+         << "E is one of";
+    for (const string& engine : aisdi::engineNames())
+    {
+      cout << " " << engine;
+    }
+    cout << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    vector<string> engines={"TreeMap", "HashMap", "ConcurrentSkipListMap", "std::map", "std::unordered_map"};
+    vector<Workload> selected=workloads;
+    try
+    {
+        for (int i=1; i<argc; i++)
+        {
+            string arg=argv[i];
+            if (i+1>=argc)
+            {
+                throw std::invalid_argument(arg);
+            }
+            string value=argv[++i];
+            if (arg=="--engines")
+            {
+                engines=splitList(value);
+                for (const string& engine : engines)
+                {
+                    const auto& names=aisdi::engineNames();
+                    if (std::find(names.begin(), names.end(), engine)==names.end())
+                    {
+                        throw std::invalid_argument(engine);
+                    }
+                }
+            }
+            else if (arg=="--workloads")
+            {
+                selected.clear();
+                for (const string& name : splitList(value))
+                {
+                    auto w=std::find_if(workloads.begin(), workloads.end(), [&name](const Workload& w)
+                    {
+                        return name.size()==1 && w.name==name[0];
+                    });
+                    if (w==workloads.end())
+                    {
+                        throw std::invalid_argument(name);
+                    }
+                    selected.push_back(*w);
+                }
+            }
+            else if (arg=="--threads")
+            {
+                config.threads.clear();
+                for (const string& n : splitList(value))
+                {
+                    config.threads.push_back(std::stoull(n));
+                    if (config.threads.back()==0)
+                    {
+                        throw std::invalid_argument(n);
+                    }
+                }
+            }
+            else if (arg=="--records")
+            {
+                config.records=std::stoull(value);
+            }
+            else if (arg=="--duration")
+            {
+                config.seconds=std::stod(value);
+            }
+            else if (arg=="--value-size")
+            {
+                config.valueSize=std::stoull(value);
+            }
+            else if (arg=="--scan-length")
+            {
+                config.maxScanLength=std::stoull(value);
+            }
+            else if (arg=="--zipf")
+            {
+                config.zipfExponent=std::stod(value);
+            }
+            else if (arg=="--seed")
+            {
+                config.seed=std::stoull(value);
+            }
+            else
+            {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (config.records==0 || config.valueSize==0 || config.maxScanLength==0)
+        {
+            throw std::invalid_argument("zero");
+        }
+    }
+    catch (const std::logic_error&)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    cout << config.records << " records of " << config.valueSize << " bytes, "
+         << config.seconds << " s per run, Zipf exponent " << config.zipfExponent << endl;
+    cout << setw(24) << left << "engine" << setw(10) << "workload" << setw(8) << "threads" << right
+         << setw(14) << "ops/s" << setw(12) << "ops" << setw(10) << "misses" << endl;
+    cout << setw(42) << "latency" << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99"
+         << setw(10) << "p99.9" << setw(10) << "max [ns]" << endl;
+    Driver driver(config, selected);
+    for (const string& engine : engines)
+    {
+        aisdi::visitEngine<string>(engine, driver);
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <BenchmarkReport.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using aisdi::BenchmarkRecord;
+using aisdi::BenchmarkResult;
+using aisdi::BenchmarkStats;
+using aisdi::RunInfo;
+
+namespace
+{
+
+BenchmarkResult result(const std::string& engine, const std::string& operation, std::size_t size, double median)
+{
+  return BenchmarkResult{engine, operation, size, BenchmarkStats{median, median - 1, median, 0.5, 5},
+                         aisdi::LatencyHistogram(), aisdi::PerfSample()};
+}
+
+BenchmarkRecord record(const std::string& engine, double mean, double stddev, std::size_t runs)
+{
+  return BenchmarkRecord{engine, "hit", 1000, "uniform", BenchmarkStats{mean, mean, mean, stddev, runs}};
+}
+
+// One row per run of the same result, each with the given median and a
+// small spread between the rounds of that run.
+std::vector<BenchmarkRecord> runs(const std::string& engine, const std::vector<double>& medians)
+{
+  std::vector<BenchmarkRecord> rows;
+  for (double median : medians)
+    rows.push_back(record(engine, median, 0.1, 5));
+  return rows;
+}
+
+std::vector<BenchmarkRecord> concat(std::vector<BenchmarkRecord> a, const std::vector<BenchmarkRecord>& b)
+{
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+const RunInfo info = RunInfo{"gcc \"test\", 1.0", true, "2024-01-01T00:00:00Z", "zipf:0.99", 7, 1, 5};
+
+}
+
+BOOST_AUTO_TEST_SUITE(BenchmarkReportTests)
+
+BOOST_AUTO_TEST_CASE(GivenResults_WhenWrittenAsCsvAndReadBack_ThenTheyAreTheSame)
+{
+  std::vector<BenchmarkResult> results = {result("TreeMap", "insert", 1000, 123.456789),
+                                          result("std::map", "hit", 100000, 0.25)};
+  results[1].latency.record(40);
+  std::stringstream csv;
+  aisdi::writeCsv(csv, info, results);
+
+  const std::vector<BenchmarkRecord> records = aisdi::readCsv(csv);
+
+  BOOST_REQUIRE_EQUAL(records.size(), 2u);
+  for (std::size_t i = 0; i < records.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(records[i].engine, results[i].engine);
+    BOOST_CHECK_EQUAL(records[i].operation, results[i].operation);
+    BOOST_CHECK_EQUAL(records[i].size, results[i].size);
+    BOOST_CHECK_EQUAL(records[i].distribution, "zipf:0.99");
+    BOOST_CHECK_CLOSE(records[i].stats.median, results[i].stats.median, 1e-9);
+    BOOST_CHECK_CLOSE(records[i].stats.mean, results[i].stats.mean, 1e-9);
+    BOOST_CHECK_EQUAL(records[i].stats.runs, 5u);
+  }
+  BOOST_CHECK(csv.str().find("\"gcc \"\"test\"\", 1.0\"") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(GivenConcatenatedCsvFiles_WhenReading_ThenAllRecordsAreRead)
+{
+  std::stringstream csv;
+  aisdi::writeCsv(csv, info, {result("TreeMap", "hit", 10, 1)});
+  aisdi::writeCsv(csv, info, {result("HashMap", "hit", 10, 2)});
+
+  BOOST_CHECK_EQUAL(aisdi::readCsv(csv).size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMalformedCsv_WhenReading_ThenExceptionIsThrown)
+{
+  std::istringstream noHeader("TreeMap,hit,10,uniform,1,1,1,0,5\n");
+  std::istringstream missingColumn("engine,operation,size\nTreeMap,hit,10\n");
+  std::istringstream badNumber("engine,operation,size,distribution,median_ns,min_ns,mean_ns,stddev_ns,runs\n"
+                               "TreeMap,hit,10,uniform,fast,1,1,0,5\n");
+
+  BOOST_CHECK_THROW(aisdi::readCsv(noHeader), std::runtime_error);
+  BOOST_CHECK_THROW(aisdi::readCsv(missingColumn), std::runtime_error);
+  BOOST_CHECK_THROW(aisdi::readCsv(badNumber), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenResults_WhenWrittenAsJson_ThenBuildInfoAndLatenciesAreIncluded)
+{
+  std::vector<BenchmarkResult> results = {result("TreeMap", "insert", 1000, 10)};
+  results[0].latency.record(100);
+  results[0].counters.values[aisdi::PerfSample::Cycles] = 250;
+  results[0].counters.valid[aisdi::PerfSample::Cycles] = true;
+  std::ostringstream json;
+  aisdi::writeJson(json, info, results);
+
+  const std::string s = json.str();
+  BOOST_CHECK(s.find("\"compiler\": \"gcc \\\"test\\\", 1.0\"") != std::string::npos);
+  BOOST_CHECK(s.find("\"distribution\": \"zipf:0.99\"") != std::string::npos);
+  BOOST_CHECK(s.find("\"engine\": \"TreeMap\"") != std::string::npos);
+  BOOST_CHECK(s.find("\"p99\": 100") != std::string::npos);
+  BOOST_CHECK(s.find("\"counters_per_op\": {\"cycles\": 250}") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSlowerCandidate_WhenComparing_ThenOnlySignificantChangesBeyondThresholdAreFlagged)
+{
+  const std::vector<BenchmarkRecord> baseline =
+    concat(concat(runs("TreeMap", {100, 101, 99}), runs("HashMap", {70, 130, 100})),
+           concat(runs("std::map", {100, 101, 99}), runs("only", {1})));
+  const std::vector<BenchmarkRecord> candidate =
+    concat(concat(runs("TreeMap", {120, 121, 119}), runs("HashMap", {90, 150, 120})), runs("std::map", {103, 104, 102}));
+
+  const std::vector<aisdi::BenchmarkChange> changes = aisdi::compareResults(baseline, candidate, 0.05);
+
+  BOOST_REQUIRE_EQUAL(changes.size(), 3u);
+  BOOST_CHECK(changes[0].significant && changes[0].regression);
+  BOOST_CHECK_CLOSE(changes[0].change, 0.2, 1e-9);
+  BOOST_CHECK(!changes[1].significant && !changes[1].regression);
+  BOOST_CHECK(changes[2].significant && !changes[2].regression);
+
+  const std::vector<aisdi::BenchmarkChange> reversed = aisdi::compareResults(candidate, baseline, 0.05);
+  BOOST_CHECK(reversed[0].improvement && !reversed[0].regression);
+  BOOST_CHECK_THROW(aisdi::compareResults(baseline, candidate, -1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRepeatedRuns_WhenComparing_ThenTheyArePooledAndTestedAcrossRuns)
+{
+  const std::vector<BenchmarkRecord> baseline = runs("TreeMap", {100, 110, 95, 105});
+  const std::vector<BenchmarkRecord> candidate = runs("TreeMap", {112, 96, 104, 99});
+
+  const std::vector<aisdi::BenchmarkChange> changes = aisdi::compareResults(baseline, candidate, 0.01);
+
+  BOOST_REQUIRE_EQUAL(changes.size(), 1u);
+  BOOST_CHECK_EQUAL(changes[0].baseline.stats.runs, 4u);
+  BOOST_CHECK_EQUAL(changes[0].candidate.stats.runs, 4u);
+  BOOST_CHECK_CLOSE(changes[0].baseline.stats.median, 102.5, 1e-9);
+  BOOST_CHECK_CLOSE(changes[0].candidate.stats.median, 101.5, 1e-9);
+  BOOST_CHECK(!changes[0].significant && !changes[0].regression && !changes[0].improvement);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyResults_WhenComparing_ThenAMarginalChangeIsNotFlaggedByChance)
+{
+  std::vector<BenchmarkRecord> baseline = runs("marginal", {100, 101, 99});
+  std::vector<BenchmarkRecord> candidate = runs("marginal", {103, 104, 102});
+  BOOST_CHECK(aisdi::compareResults(baseline, candidate, 0.01)[0].regression);
+
+  for (int i = 0; i < 20; ++i)
+  {
+    baseline = concat(baseline, runs("same" + std::to_string(i), {100, 101, 99}));
+    candidate = concat(candidate, runs("same" + std::to_string(i), {99, 100, 101}));
+  }
+  const std::vector<aisdi::BenchmarkChange> changes = aisdi::compareResults(baseline, candidate, 0.01);
+
+  BOOST_REQUIRE_EQUAL(changes.size(), 21u);
+  for (const auto& c : changes)
+    BOOST_CHECK(!c.regression && !c.improvement);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKnownValues_WhenComputingPValues_ThenTheyMatchStudentsT)
+{
+  BOOST_CHECK_CLOSE(aisdi::incompleteBeta(1, 1, 0.3), 0.3, 1e-6);
+  BOOST_CHECK_CLOSE(aisdi::incompleteBeta(0.5, 0.5, 1 / (1 + 12.706 * 12.706)), 0.05, 0.1);
+  BOOST_CHECK_CLOSE(aisdi::incompleteBeta(2, 0.5, 4 / (4 + 2.776 * 2.776)), 0.05, 0.1);
+  BOOST_CHECK_CLOSE(aisdi::incompleteBeta(15, 0.5, 30 / (30 + 2.042 * 2.042)), 0.05, 0.1);
+  BOOST_CHECK_EQUAL(aisdi::welchPValue(BenchmarkStats{1, 1, 1, 0, 5}, BenchmarkStats{1, 1, 1, 0, 5}), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSingleRuns_WhenComparing_ThenThresholdAloneDecides)
+{
+  const std::vector<aisdi::BenchmarkChange> changes =
+    aisdi::compareResults({record("TreeMap", 100, 0, 1)}, {record("TreeMap", 110, 0, 1)}, 0.05);
+
+  BOOST_REQUIRE_EQUAL(changes.size(), 1u);
+  BOOST_CHECK(changes[0].regression);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,222 @@
+#include <BufferedTreeMap.h>
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::BufferedTreeMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+BOOST_AUTO_TEST_SUITE(BufferedTreeMapTests)
+
+template <typename K, typename C>
+void thenMapContainsItems(const aisdi::BufferedTreeMap<K, std::string, C>& map,
+                          const std::map<K, std::string, C>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto expectedIt = expected.begin();
+  for (const auto& item : map)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(item.first, expectedIt->first);
+    BOOST_CHECK_EQUAL(item.second, expectedIt->second);
+    ++expectedIt;
+  }
+  BOOST_CHECK(expectedIt == expected.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenLookingUp_ThenNothingIsFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  auto it = map.end();
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBlindWrites_WhenLookingUpBeforeFlushing_ThenPendingMessagesAreSeen,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 gen(17);
+  std::uniform_int_distribution<int> key(0, 50000);
+  for (int i = 0; i < 100000; ++i)
+  {
+    const K k = key(gen);
+    if (i % 5 == 4)
+    {
+      map.erase(k);
+      expected.erase(k);
+    }
+    else
+    {
+      map.insert(k, std::to_string(i));
+      expected[k] = std::to_string(i);
+    }
+    if (i % 1000 == 0)
+    {
+      const K probe = key(gen);
+      const auto e = expected.find(probe);
+      const Map<K>& constMap = map;
+      if (e == expected.end())
+        BOOST_CHECK_THROW(constMap.valueOf(probe), std::out_of_range);
+      else
+        BOOST_CHECK_EQUAL(constMap.valueOf(probe), e->second);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMixedOperations_WhenApplied_ThenMapMatchesStdMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<int> key(0, 5000);
+  for (int i = 0; i < 60000; ++i)
+  {
+    const K k = key(gen);
+    switch (i % 6)
+    {
+    case 0:
+      map[k] += "x";
+      expected[k] += "x";
+      break;
+    case 1:
+      if (expected.erase(k))
+        map.remove(k);
+      else
+        BOOST_CHECK_THROW(map.remove(k), std::out_of_range);
+      break;
+    case 2:
+    {
+      const auto it = map.find(k);
+      BOOST_REQUIRE_EQUAL(it != map.end(), expected.count(k) == 1);
+      if (it != map.end())
+        BOOST_CHECK_EQUAL(it->second, expected[k]);
+      break;
+    }
+    default:
+      map.insert(k, std::to_string(i));
+      expected[k] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+  int count = 0;
+  auto it = map.end();
+  for (auto e = expected.rbegin(); e != expected.rend() && count < 500; ++e, ++count)
+    BOOST_CHECK_EQUAL((--it)->first, e->first);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapWithPendingMessages_WhenCopyingAndMoving_ThenContentsFollow)
+{
+  aisdi::BufferedTreeMap<int, std::string, std::greater<int>> map;
+  std::map<int, std::string, std::greater<int>> expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    map.insert((i * 37) % 3000, std::to_string(i));
+    expected[(i * 37) % 3000] = std::to_string(i);
+  }
+
+  auto copy = map;
+  copy.erase(7);
+  auto moved = std::move(copy);
+  map = moved;
+  expected.erase(7);
+
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK(map == moved);
+  thenMapContainsItems(map, expected);
+  map.begin()->second = "first";
+  BOOST_CHECK_EQUAL(map.valueOf(2999), "first");
+  BOOST_CHECK(map != moved);
+}
+
+BOOST_AUTO_TEST_CASE(GivenConstMapWithPendingMessages_WhenFinding_ThenEarlierIteratorsStayValid)
+{
+  Map<int> map;
+  for (int i = 0; i < 20000; ++i)
+    map.insert(i, std::to_string(i));
+  for (int i = 0; i < 20000; i += 3)
+    map.erase(i);
+  map.insert(100, "hundred");
+  const Map<int>& constMap = map;
+
+  auto it = constMap.find(100);
+  BOOST_REQUIRE(it != constMap.end());
+  for (int i = 0; i < 200; ++i)
+    constMap.find(i);
+  BOOST_CHECK_EQUAL(it->first, 100);
+  BOOST_CHECK_EQUAL(it->second, "hundred");
+  BOOST_CHECK(constMap.find(51) == constMap.end());
+
+  ++it;
+  BOOST_CHECK_EQUAL(it->first, 101);
+  ++it;
+  BOOST_CHECK_EQUAL(it->first, 103);
+  --it;
+  --it;
+  --it;
+  BOOST_CHECK_EQUAL(it->first, 98);
+  BOOST_CHECK(constMap.find(98) == it);
+}
+
+BOOST_AUTO_TEST_CASE(GivenConstMapWithPendingMessages_WhenIterating_ThenNothingIsApplied)
+{
+  Map<int> map;
+  std::map<int, std::string> expected;
+  std::mt19937 gen(29);
+  std::uniform_int_distribution<int> key(0, 8000);
+  for (int i = 0; i < 30000; ++i)
+  {
+    const int k = key(gen);
+    if (i % 3 == 2)
+    {
+      map.erase(k);
+      expected.erase(k);
+    }
+    else
+    {
+      map.insert(k, std::to_string(i));
+      expected[k] = std::to_string(i);
+    }
+  }
+  const Map<int>& constMap = map;
+
+  const auto first = constMap.begin();
+  thenMapContainsItems(constMap, expected);
+  BOOST_CHECK(constMap.begin() == first);
+  auto it = constMap.end();
+  for (auto e = expected.rbegin(); e != expected.rend(); ++e)
+    BOOST_CHECK_EQUAL((--it)->first, e->first);
+  BOOST_CHECK(it == first);
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+
+  map.find(expected.begin()->first)->second = "changed";
+  expected.begin()->second = "changed";
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
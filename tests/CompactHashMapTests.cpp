@@ -0,0 +1,139 @@
+#include <CompactHashMap.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::CompactHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+BOOST_AUTO_TEST_SUITE(CompactHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map, const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  std::set<K> visited;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK(visited.insert(item.first).second);
+    const auto e = expected.find(item.first);
+    BOOST_REQUIRE_MESSAGE(e != expected.end(), "Unexpected key: " << item.first);
+    BOOST_CHECK_EQUAL(item.second, e->second);
+  }
+  BOOST_CHECK_EQUAL(visited.size(), expected.size());
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenLookingUp_ThenNothingIsFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  auto it = map.end();
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenApplied_ThenMapMatchesStdMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(97);
+  std::map<K, std::string> expected;
+  std::mt19937 gen(9);
+  std::uniform_int_distribution<int> key(0, 3000);
+  for (int i = 0; i < 20000; ++i)
+  {
+    const K k = key(gen);
+    if (i % 3 == 2)
+    {
+      if (expected.erase(k))
+        map.remove(k);
+      else
+        BOOST_CHECK_THROW(map.remove(k), std::out_of_range);
+    }
+    else
+    {
+      map[k] = std::to_string(i);
+      expected[k] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenIteratingBackwards_ThenForwardOrderIsReversed)
+{
+  aisdi::CompactHashMap<std::uint64_t, std::uint32_t> map(10);
+  for (std::uint64_t i = 0; i < 57; ++i)
+    map[i * 13] = static_cast<std::uint32_t>(i);
+
+  std::vector<std::uint64_t> forward;
+  for (const auto& item : map)
+    forward.push_back(item.first);
+  auto it = map.end();
+  for (auto k = forward.rbegin(); k != forward.rend(); ++k)
+    BOOST_CHECK_EQUAL((--it)->first, *k);
+  BOOST_CHECK(it == map.begin());
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK_THROW(map.end()++, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenCopyingAndMoving_ThenContentsFollow)
+{
+  Map<int> map = { { 1, "a" }, { 1001, "b" }, { 2, "c" } };
+
+  auto copy = map;
+  copy[4] = "d";
+  auto moved = std::move(copy);
+  map = moved;
+
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK(map == moved);
+  thenMapContainsItems(map, { { 1, "a" }, { 1001, "b" }, { 2, "c" }, { 4, "d" } });
+  map.remove(1001);
+  map[3] = "e";
+  BOOST_CHECK(map.find(1001) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(1), "a");
+  BOOST_CHECK(map != moved);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFreedSlots_WhenReusingCopyingAndGrowing_ThenEntriesAreIntact)
+{
+  Map<std::uint64_t> map(16);
+  std::map<std::uint64_t, std::string> expected;
+  for (std::uint64_t i = 0; i < 50; ++i)
+    map[i] = std::string(40, 'a' + i % 26);
+  for (std::uint64_t i = 0; i < 50; i += 3)
+    map.remove(i);
+
+  const auto copy = map;
+  for (std::uint64_t i = 100; i < 300; ++i)
+    map[i] = std::to_string(i);
+  for (const auto& item : copy)
+    expected[item.first] = item.second;
+  for (std::uint64_t i = 100; i < 300; ++i)
+    expected[i] = std::to_string(i);
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(copy.getSize(), 33u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+#include <CompactTreeMap.h>
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::CompactTreeMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+BOOST_AUTO_TEST_SUITE(CompactTreeMapTests)
+
+template <typename K, typename C>
+void thenMapContainsItems(const aisdi::CompactTreeMap<K, std::string, C>& map,
+                          const std::map<K, std::string, C>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto expectedIt = expected.begin();
+  for (const auto& item : map)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(item.first, expectedIt->first);
+    BOOST_CHECK_EQUAL(item.second, expectedIt->second);
+    ++expectedIt;
+  }
+  BOOST_CHECK(expectedIt == expected.end());
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenLookingUp_ThenNothingIsFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  auto it = map.end();
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenApplied_ThenMapMatchesStdMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> key(0, 3000);
+  for (int i = 0; i < 20000; ++i)
+  {
+    const K k = key(gen);
+    if (i % 3 == 2)
+    {
+      if (expected.erase(k))
+        map.remove(k);
+      else
+        BOOST_CHECK_THROW(map.remove(k), std::out_of_range);
+    }
+    else
+    {
+      map[k] = std::to_string(i);
+      expected[k] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingBackwards_ThenItemsAreInReverseOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[(i * 31) % 100] = std::to_string(i);
+
+  int expected = 100;
+  auto it = map.end();
+  while (it != map.begin())
+  {
+    --it;
+    BOOST_CHECK_EQUAL(it->first, --expected);
+  }
+  BOOST_CHECK_EQUAL(expected, 0);
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK_THROW(map.end()++, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRemovedEntries_WhenInserting_ThenIteratorsToOtherEntriesStayValid)
+{
+  aisdi::CompactTreeMap<std::uint64_t, std::uint32_t> map;
+  map.reserve(4);
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i * 7 % 100] = static_cast<std::uint32_t>(i);
+
+  for (std::uint64_t i = 0; i < 100; i += 2)
+    map.remove(i);
+  for (std::uint64_t i = 1000; i < 1050; ++i)
+    map[i] = 1;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100u);
+  BOOST_CHECK_EQUAL(map.valueOf(1049), 1u);
+  BOOST_CHECK(map.find(42) == map.end());
+  const auto odd = map.find(43);
+  map[2000] = 2;
+  BOOST_CHECK_EQUAL(odd->first, 43u);
+  BOOST_CHECK_EQUAL(odd->second, map.valueOf(43));
+}
+
+BOOST_AUTO_TEST_CASE(GivenFreedSlotsWithStringKeys_WhenReusingCopyingAndGrowing_ThenEntriesAreIntact)
+{
+  aisdi::CompactTreeMap<std::string, std::string> map;
+  std::map<std::string, std::string> expected;
+  for (int i = 0; i < 50; ++i)
+    map[std::string(40, 'a' + i % 26) + std::to_string(i)] = std::string(30, 'v');
+  for (int i = 0; i < 50; i += 3)
+    map.remove(std::string(40, 'a' + i % 26) + std::to_string(i));
+
+  const auto copy = map;
+  for (int i = 0; i < 200; ++i)
+    map["k" + std::to_string(i)] = std::to_string(i);
+  for (const auto& item : copy)
+    expected[item.first] = item.second;
+  for (int i = 0; i < 200; ++i)
+    expected["k" + std::to_string(i)] = std::to_string(i);
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(copy.getSize(), 33u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenCopyingAndMoving_ThenContentsFollow)
+{
+  aisdi::CompactTreeMap<int, std::string, std::greater<int>> map = { { 1, "a" }, { 3, "c" }, { 2, "b" } };
+
+  auto copy = map;
+  copy[4] = "d";
+  auto moved = std::move(copy);
+  map = moved;
+
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK(map == moved);
+  const std::map<int, std::string, std::greater<int>> expected = { { 4, "d" }, { 3, "c" }, { 2, "b" }, { 1, "a" } };
+  thenMapContainsItems(map, expected);
+  map.begin()->second = "x";
+  BOOST_CHECK_EQUAL(map.valueOf(4), "x");
+  BOOST_CHECK(map != moved);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
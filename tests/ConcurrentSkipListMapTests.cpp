@@ -0,0 +1,269 @@
+#include <ConcurrentSkipListMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <map>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::ConcurrentSkipListMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(ConcurrentSkipListMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto expectedIt = expected.begin();
+  for (const auto& item : map)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(item.first, expectedIt->first);
+    BOOST_CHECK_EQUAL(item.second, expectedIt->second);
+    ++expectedIt;
+  }
+  BOOST_CHECK(expectedIt == expected.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenQueried_ThenNothingIsFound,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(1) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(--map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingAndChangingItems_ThenTheyAreInMapInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  map[13] = "Chuck";
+  map[42] = "Dave";
+  map.find(27)->second = "Eve";
+  BOOST_CHECK(map.insert(7, "Frank"));
+  BOOST_CHECK(!map.insert(7, "Grace"));
+
+  thenMapContainsItems(map, { { 7, "Frank" }, { 13, "Chuck" }, { 27, "Eve" }, { 42, "Dave" } });
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Dave");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingItems_ThenTheyAreNoLongerInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 500; ++i)
+  {
+    map[(i * 7) % 500] = std::to_string(i);
+    expected[(i * 7) % 500] = std::to_string(i);
+  }
+  for (int key = 0; key < 500; key += 2)
+  {
+    map.remove(key);
+    expected.erase(key);
+  }
+  map.remove(map.find(1));
+  expected.erase(1);
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingBackwards_ThenItemsAreInReverseOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  int expectedKey = 100;
+  for (auto it = map.end(); it != map.begin();)
+  {
+    --it;
+    --expectedKey;
+    BOOST_CHECK_EQUAL(it->first, expectedKey);
+  }
+  BOOST_CHECK_EQUAL(expectedKey, 0);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenScanningRange_ThenOnlyKeysInRangeAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; i += 5)
+    map[i] = std::to_string(i);
+
+  std::vector<int> visited;
+  map.forEachInRange(12, 40, [&visited](const typename Map<K>::value_type& item)
+  {
+    visited.push_back(static_cast<int>(item.first));
+  });
+
+  BOOST_CHECK((visited == std::vector<int>{ 15, 20, 25, 30, 35 }));
+  BOOST_CHECK_EQUAL(map.lowerBound(95)->first, 95);
+  BOOST_CHECK(map.lowerBound(96) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyKeptIterators_WhenStepping_ThenEachOneSeeksFromItsKey,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  std::vector<typename Map<K>::const_iterator> found;
+  for (int i = 0; i < 1000; ++i)
+    found.push_back(map.find(i));
+  for (int i = 0; i < 1000; i += 2)
+    map.remove(i);
+
+  for (int i = 0; i < 1000; i += 2)
+  {
+    ++found[i];
+    BOOST_CHECK_EQUAL(found[i]->first, i + 1);
+  }
+  BOOST_CHECK_EQUAL((--found[501])->first, 499);
+  BOOST_CHECK(++found[999] == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenVisitingKeys_ThenOnlyPresentOnesAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" }, { 2, "b" }, { 4, "d" } };
+
+  BOOST_CHECK(map.visit(2, [](std::string& value) { value += "!"; }));
+  BOOST_CHECK(!map.visit(3, [](std::string& value) { value = "c"; }));
+  std::vector<int> visited;
+  map.forEachFrom(2, [&visited](const typename Map<K>::value_type& item)
+  {
+    visited.push_back(static_cast<int>(item.first));
+    return item.second != "b!";
+  });
+
+  BOOST_CHECK((visited == std::vector<int>{ 2 }));
+  BOOST_CHECK_EQUAL(map.valueOf(2), "b!");
+  BOOST_CHECK(map.find(3) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyGuardsHeldAtOnce_WhenPinning_ThenTheDomainGrows)
+{
+  BOOST_CHECK(std::is_nothrow_move_constructible<aisdi::EpochGuard>::value);
+  aisdi::EpochDomain domain;
+  std::vector<aisdi::EpochGuard> guards;
+  for (int i = 0; i < 1000; ++i)
+    guards.emplace_back(domain);
+  BOOST_CHECK_EQUAL(guards.size(), 1000u);
+  guards.clear();
+  aisdi::EpochGuard again(domain);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopyingAndMoving_ThenItemsAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+
+  Map<K> copied{map};
+  Map<K> moved{std::move(map)};
+  copied[1410] = "Grunwald";
+
+  thenMapContainsItems(moved, { { 753, "Rome" }, { 1789, "Paris" } });
+  thenMapContainsItems(copied, { { 753, "Rome" }, { 1410, "Grunwald" }, { 1789, "Paris" } });
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(copied != moved);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenInsertingDisjointKeys_ThenAllKeysArePresent)
+{
+  Map<int> map;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t)
+    threads.push_back(std::thread([&map, t]()
+    {
+      for (int i = t; i < 8000; i += 8)
+        map[i] = std::to_string(i);
+    }));
+  for (auto& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(map.getSize(), 8000);
+  int expectedKey = 0;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expectedKey);
+    ++expectedKey;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenInsertingAndRemovingSameKeys_ThenMapStaysConsistent)
+{
+  Map<int> map;
+  std::atomic<int> wrongValues(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t)
+    threads.push_back(std::thread([&map, &wrongValues, t]()
+    {
+      for (int round = 0; round < 2000; ++round)
+      {
+        const int key = (round * 13 + t) % 64;
+        if ((round + t) % 2)
+          map.insert(key, "x");
+        else
+        {
+          try
+          {
+            map.remove(key);
+          }
+          catch (const std::out_of_range&)
+          {
+          }
+        }
+        map.forEachInRange(key, key + 4, [&wrongValues](const Map<int>::value_type& item)
+        {
+          wrongValues += (item.second != "x");
+        });
+      }
+    }));
+  for (auto& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(wrongValues.load(), 0);
+  std::size_t counted = 0;
+  int previous = -1;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK(item.first > previous);
+    previous = item.first;
+    ++counted;
+  }
+  BOOST_CHECK_EQUAL(map.getSize(), counted);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include <TreeMap.h>
+#include <FrozenTreeMap.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::TreeMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+BOOST_AUTO_TEST_SUITE(FrozenTreeMapTests)
+
+template <typename K>
+void thenFrozenMapContainsItems(const aisdi::FrozenTreeMap<K, std::string>& frozen,
+                                const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(frozen.getSize(), expected.size());
+
+  auto expectedIt = expected.begin();
+  for (auto it = frozen.begin(); it != frozen.end(); ++it)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(it->first, expectedIt->first);
+    BOOST_CHECK_EQUAL((*it).second, expectedIt->second);
+    ++expectedIt;
+  }
+  BOOST_CHECK(expectedIt == expected.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenFrozen_ThenFrozenMapIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK(frozen.isEmpty());
+  BOOST_CHECK(frozen.begin() == frozen.end());
+  BOOST_CHECK(frozen.find(1) == frozen.end());
+  BOOST_CHECK(frozen.lowerBound(1) == frozen.end());
+  BOOST_CHECK_THROW(frozen.valueOf(1), std::out_of_range);
+  auto it = frozen.end();
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsOfEverySize_WhenFrozen_ThenAllItemsAreFoundInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  // every shape of the last, partially filled level
+  for (int size = 1; size <= 70; ++size)
+  {
+    Map<K> map;
+    std::map<K, std::string> expected;
+    for (int i = 0; i < size; ++i)
+    {
+      const int key = (i * 37) % size * 2;
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+
+    const auto frozen = map.freeze();
+
+    thenFrozenMapContainsItems(frozen, expected);
+    for (const auto& item : expected)
+    {
+      BOOST_CHECK_EQUAL(frozen.valueOf(item.first), item.second);
+      BOOST_CHECK(frozen.find(item.first) != frozen.end());
+      BOOST_CHECK(frozen.find(item.first + 1) == frozen.end());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenLookingForLowerBound_ThenFirstNotLessKeyIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 1; i <= 50; ++i)
+    map[i * 10] = std::to_string(i);
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK_EQUAL(frozen.lowerBound(0)->first, 10);
+  BOOST_CHECK_EQUAL(frozen.lowerBound(10)->first, 10);
+  BOOST_CHECK_EQUAL(frozen.lowerBound(11)->first, 20);
+  BOOST_CHECK_EQUAL(frozen.lowerBound(499)->second, "50");
+  BOOST_CHECK(frozen.lowerBound(501) == frozen.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenIteratingBackwards_ThenItemsAreInReverseOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[(i * 31) % 100] = std::to_string(i);
+  const auto frozen = map.freeze();
+
+  int expected = 100;
+  auto it = frozen.end();
+  while (it != frozen.begin())
+  {
+    --it;
+    BOOST_CHECK_EQUAL(it->first, --expected);
+  }
+  BOOST_CHECK_EQUAL(expected, 0);
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK_THROW(frozen.end()++, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFrozenMap_WhenSourceIsChanged_ThenFrozenMapIsNotAffected)
+{
+  aisdi::TreeMap<std::string, int> map = { { "delta", 4 }, { "alpha", 1 }, { "charlie", 3 } };
+  const auto frozen = map.freeze();
+
+  map["bravo"] = 2;
+  map.remove("alpha");
+
+  BOOST_CHECK_EQUAL(frozen.getSize(), 3u);
+  BOOST_CHECK_EQUAL(frozen.valueOf("alpha"), 1);
+  BOOST_CHECK(frozen.find("bravo") == frozen.end());
+  BOOST_CHECK_EQUAL(frozen.lowerBound("b")->first, "charlie");
+  BOOST_CHECK(frozen != map.freeze());
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenFrozen_ThenOrderIsKept)
+{
+  aisdi::TreeMap<int, std::string, std::greater<int>> map;
+  for (int i = 0; i < 20; ++i)
+    map[i] = std::to_string(i);
+  const auto frozen = map.freeze();
+
+  int expected = 19;
+  for (const auto& item : frozen)
+    BOOST_CHECK_EQUAL(item.first, expected--);
+  BOOST_CHECK_EQUAL(frozen.lowerBound(7)->first, 7);
+  BOOST_CHECK_EQUAL(frozen.valueOf(3), "3");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
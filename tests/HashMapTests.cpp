@@ -1,6 +1,8 @@
 #include <HashMap.h>
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <map>
 
@@ -788,6 +790,44 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE(GivenMap_WhenScanningInParallel_ThenEveryEntryIsVisitedOnce)
+{
+  aisdi::HashMap<int, int> map(97);
+  long long expectedSum = 0;
+  for (int i = 0; i < 5000; ++i)
+  {
+    map[i * 3] = i;
+    expectedSum += i * 3;
+  }
+
+  for (unsigned threads : { 1u, 4u, 64u })
+  {
+    std::atomic<long long> sum(0);
+    map.parallelForEach([&sum](const std::pair<const int, int>& item) { sum += item.first; }, threads);
+    BOOST_CHECK_EQUAL(sum.load(), expectedSum);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenNonCommutativeCombine_WhenReducingInParallel_ThenIterationOrderIsKept)
+{
+  aisdi::HashMap<int, int> map(50);
+  for (int i = 0; i < 700; ++i)
+    map[(i * 31) % 701] = i;
+  std::string expected = "<";
+  for (const auto& item : map)
+    expected += std::to_string(item.second) + ",";
+
+  const auto result = map.parallelReduce(std::string("<"),
+                                         [](const std::pair<const int, int>& item) { return std::to_string(item.second) + ","; },
+                                         [](const std::string& a, const std::string& b) { return a + b; },
+                                         8);
+
+  BOOST_CHECK_EQUAL(result, expected);
+  const aisdi::HashMap<int, int> empty;
+  const auto one = [](const std::pair<const int, int>&) { return 1; };
+  BOOST_CHECK_EQUAL(empty.parallelReduce(5, one, std::plus<int>(), 2), 5);
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 
@@ -0,0 +1,112 @@
+#include <LatencyHistogram.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using aisdi::LatencyHistogram;
+
+BOOST_AUTO_TEST_SUITE(LatencyHistogramTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyHistogram_WhenAskingForStatistics_ThenZeroIsReturned)
+{
+  const LatencyHistogram h;
+
+  BOOST_CHECK_EQUAL(h.getCount(), 0u);
+  BOOST_CHECK_EQUAL(h.getMin(), 0u);
+  BOOST_CHECK_EQUAL(h.getMax(), 0u);
+  BOOST_CHECK_EQUAL(h.getMean(), 0);
+  BOOST_CHECK_EQUAL(h.percentile(99), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSmallValues_WhenRecording_ThenPercentilesAreExact)
+{
+  LatencyHistogram h;
+  for (std::uint64_t v = 1; v <= 100; ++v)
+    h.record(v);
+
+  BOOST_CHECK_EQUAL(h.getCount(), 100u);
+  BOOST_CHECK_EQUAL(h.getMin(), 1u);
+  BOOST_CHECK_EQUAL(h.getMax(), 100u);
+  BOOST_CHECK_EQUAL(h.getMean(), 50.5);
+  BOOST_CHECK_EQUAL(h.percentile(0), 1u);
+  BOOST_CHECK_EQUAL(h.percentile(50), 50u);
+  BOOST_CHECK_EQUAL(h.percentile(99), 99u);
+  BOOST_CHECK_EQUAL(h.percentile(100), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenWideRangeOfValues_WhenAskingForPercentiles_ThenTheyAreWithinBucketPrecision)
+{
+  std::mt19937_64 random(17);
+  std::vector<std::uint64_t> values;
+  LatencyHistogram h;
+  for (int i = 0; i < 100000; ++i)
+  {
+    const std::uint64_t v = random() >> (random() % 64);
+    values.push_back(v);
+    h.record(v);
+  }
+  std::sort(values.begin(), values.end());
+
+  for (double p : {1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0})
+  {
+    const std::uint64_t exact = values[static_cast<std::size_t>(std::ceil(p / 100 * values.size())) - 1];
+    const std::uint64_t approximate = h.percentile(p);
+    BOOST_CHECK_GE(approximate, exact);
+    BOOST_CHECK_LE(approximate - exact, exact / 64);
+  }
+  BOOST_CHECK_EQUAL(h.getMax(), values.back());
+  BOOST_CHECK_EQUAL(h.getMin(), values.front());
+  BOOST_CHECK_EQUAL(LatencyHistogram().percentile(50), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTwoHistograms_WhenMerging_ThenResultIsAsIfRecordedTogether)
+{
+  LatencyHistogram first, second, both;
+  for (std::uint64_t v = 0; v < 5000; ++v)
+  {
+    first.record(v * 7);
+    second.record(v * 1000 + 3);
+    both.record(v * 7);
+    both.record(v * 1000 + 3);
+  }
+  first.merge(second);
+
+  BOOST_CHECK_EQUAL(first.getCount(), both.getCount());
+  BOOST_CHECK_EQUAL(first.getMin(), both.getMin());
+  BOOST_CHECK_EQUAL(first.getMax(), both.getMax());
+  BOOST_CHECK_CLOSE(first.getMean(), both.getMean(), 1e-9);
+  for (double p = 0; p <= 100; p += 2.5)
+    BOOST_CHECK_EQUAL(first.percentile(p), both.percentile(p));
+
+  first.clear();
+  BOOST_CHECK_EQUAL(first.getCount(), 0u);
+  BOOST_CHECK_EQUAL(first.percentile(50), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDurations_WhenRecording_ThenTheyAreCountedInNanoseconds)
+{
+  LatencyHistogram h;
+  h.record(std::chrono::microseconds(3));
+  h.record(std::chrono::nanoseconds(-5));
+
+  BOOST_CHECK_EQUAL(h.getMax(), 3000u);
+  BOOST_CHECK_EQUAL(h.getMin(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenPercentileOutsideRange_WhenAsking_ThenExceptionIsThrown)
+{
+  LatencyHistogram h;
+  h.record(1);
+
+  BOOST_CHECK_THROW(h.percentile(100.5), std::out_of_range);
+  BOOST_CHECK_THROW(h.percentile(-1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+#include <PerfCounters.h>
+#include <Benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using aisdi::PerfCounters;
+using aisdi::PerfSample;
+
+namespace
+{
+
+volatile std::uint64_t sink;
+
+void busyLoop(std::uint64_t n)
+{
+  std::uint64_t x = 0;
+  for (std::uint64_t i = 0; i < n; ++i)
+    sink = x += i;
+}
+
+PerfSample sample(double cycles, bool instructionsCounted)
+{
+  PerfSample s;
+  s.values[PerfSample::Cycles] = cycles;
+  s.valid[PerfSample::Cycles] = true;
+  s.values[PerfSample::Instructions] = 10;
+  s.valid[PerfSample::Instructions] = instructionsCounted;
+  return s;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(PerfCountersTests)
+
+BOOST_AUTO_TEST_CASE(GivenAnyMachine_WhenOpeningCounters_ThenEitherTheyCountOrTheReasonIsGiven)
+{
+  PerfCounters counters;
+  counters.start();
+  busyLoop(1000000);
+  const PerfSample s = counters.stop();
+
+  BOOST_CHECK_EQUAL(counters.available(), s.any());
+  if (!counters.available())
+    BOOST_CHECK(!counters.unavailableReason().empty());
+  if (s.valid[PerfSample::Instructions])
+    BOOST_CHECK_GE(s.values[PerfSample::Instructions], 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRounds_WhenAveragingPerOperation_ThenEventsMissingInAnyRoundAreInvalid)
+{
+  const std::vector<PerfSample> rounds = {sample(100, true), sample(300, false)};
+
+  const PerfSample mean = PerfSample::perOperation(rounds, 10);
+
+  BOOST_CHECK(mean.valid[PerfSample::Cycles]);
+  BOOST_CHECK_EQUAL(mean.values[PerfSample::Cycles], 20);
+  BOOST_CHECK(!mean.valid[PerfSample::Instructions]);
+  BOOST_CHECK(!mean.valid[PerfSample::LLCMisses]);
+  BOOST_CHECK(!PerfSample::perOperation({}, 10).any());
+}
+
+BOOST_AUTO_TEST_CASE(GivenBenchmarkWithCounters_WhenMeasuring_ThenCountsAreGivenOnlyIfAvailable)
+{
+  PerfCounters counters;
+  aisdi::Benchmark bench(0, 2);
+  PerfSample perOp;
+
+  bench.measure(1000, []() {}, []() { busyLoop(1000); }, perOp);
+  BOOST_CHECK(!perOp.any());
+
+  bench.setCounters(&counters);
+  bench.measure(1000, []() {}, []() { busyLoop(1000); }, perOp);
+  BOOST_CHECK_EQUAL(perOp.any(), counters.available());
+  if (perOp.valid[PerfSample::Instructions])
+    BOOST_CHECK_GE(perOp.values[PerfSample::Instructions], 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,188 @@
+#include <PersistentTreeMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+template <typename K>
+using Map = aisdi::PersistentTreeMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(PersistentTreeMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto expectedIt = expected.begin();
+  for (const auto& item : map)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(item.first, expectedIt->first);
+    BOOST_CHECK_EQUAL(item.second, expectedIt->second);
+    ++expectedIt;
+  }
+  BOOST_CHECK(expectedIt == expected.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAddingAndChangingItems_ThenTheyAreInMapInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  map[13] = "Chuck";
+  map[42] = "Dave";
+
+  thenMapContainsItems(map, { { 13, "Chuck" }, { 27, "Bob" }, { 42, "Dave" } });
+  BOOST_CHECK_EQUAL(map.valueOf(27), "Bob");
+  BOOST_CHECK(map.find(99) == map.end());
+  BOOST_CHECK_EQUAL(map.find(13)->second, "Chuck");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingBackwards_ThenItemsAreInReverseOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 500; ++i)
+    map[i] = std::to_string(i);
+
+  int expectedKey = 500;
+  for (auto it = map.end(); it != map.begin();)
+  {
+    --it;
+    --expectedKey;
+    BOOST_CHECK_EQUAL(it->first, expectedKey);
+  }
+  BOOST_CHECK_EQUAL(expectedKey, 0);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+  BOOST_CHECK_THROW(++map.end(), std::out_of_range);
+  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingItems_ThenTheyAreNoLongerInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 300; ++i)
+  {
+    map[(i * 7) % 300] = std::to_string(i);
+    expected[(i * 7) % 300] = std::to_string(i);
+  }
+  for (int key = 0; key < 300; key += 2)
+  {
+    map.remove(key);
+    expected.erase(key);
+  }
+  map.remove(map.find(1));
+  expected.erase(1);
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenMapIsUpdated_ThenSnapshotIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } };
+
+  const Map<K> snapshot = map.snapshot();
+  map[753] = "Roma";
+  map.valueOf(1789) = "Lutetia";
+  map.remove(1410);
+  map[1066] = "Hastings";
+
+  thenMapContainsItems(snapshot, { { 753, "Rome" }, { 1410, "Grunwald" }, { 1789, "Paris" } });
+  thenMapContainsItems(map, { { 753, "Roma" }, { 1066, "Hastings" }, { 1789, "Lutetia" } });
+  BOOST_CHECK(snapshot != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenSnapshotIsUpdated_ThenOriginalIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  Map<K> snapshot = map.snapshot();
+  BOOST_CHECK(snapshot == map);
+  snapshot[42] = "Chuck";
+
+  thenMapContainsItems(map, { { 27, "Bob" }, { 42, "Alice" } });
+  thenMapContainsItems(snapshot, { { 27, "Bob" }, { 42, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManySnapshots_WhenTheyAreDropped_ThenLatestVersionSurvives,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::vector<Map<K>> versions;
+  for (int i = 0; i < 100; ++i)
+  {
+    map[i] = std::to_string(i);
+    versions.push_back(map.snapshot());
+  }
+
+  for (std::size_t i = 0; i < versions.size(); ++i)
+    BOOST_CHECK_EQUAL(versions[i].getSize(), i + 1);
+  versions.clear();
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  BOOST_CHECK_EQUAL(map.valueOf(99), "99");
+}
+
+BOOST_AUTO_TEST_CASE(GivenSnapshotReadByOtherThread_WhenWriterUpdatesMap_ThenReaderSeesSnapshot)
+{
+  Map<int> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = "v0";
+
+  const Map<int> snapshot = map.snapshot();
+  std::size_t readerMatches = 0;
+  std::thread reader([&snapshot, &readerMatches]()
+  {
+    for (int round = 0; round < 20; ++round)
+      for (const auto& item : snapshot)
+        readerMatches += (item.second == "v0");
+  });
+  for (int i = 0; i < 1000; ++i)
+  {
+    map[i] = "v1";
+    if (i % 2)
+      map.remove(i);
+  }
+  reader.join();
+
+  BOOST_CHECK_EQUAL(readerMatches, 20 * 1000);
+  BOOST_CHECK_EQUAL(map.getSize(), 500);
+  BOOST_CHECK_EQUAL(snapshot.getSize(), 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
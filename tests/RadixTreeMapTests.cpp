@@ -0,0 +1,183 @@
+#include <RadixTreeMap.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using Map = aisdi::RadixTreeMap<int>;
+
+BOOST_AUTO_TEST_SUITE(RadixTreeMapTests)
+
+void thenMapContainsItems(const Map& map, const std::map<std::string, int>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  auto expectedIt = expected.begin();
+  for (const auto& item : map)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(item.first, expectedIt->first);
+    BOOST_CHECK_EQUAL(item.second, expectedIt->second);
+    ++expectedIt;
+  }
+  BOOST_CHECK(expectedIt == expected.end());
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+  }
+}
+
+std::string randomUrl(std::mt19937& gen)
+{
+  static const char* hosts[] = { "http://example.com/", "http://example.org/", "https://example.com/" };
+  std::uniform_int_distribution<int> host(0, 2);
+  std::uniform_int_distribution<int> length(0, 12);
+  std::uniform_int_distribution<int> letter('a', 'e');
+  std::string url = hosts[host(gen)];
+  const int n = length(gen);
+  for (int i = 0; i < n; ++i)
+    url.push_back(static_cast<char>(letter(gen)));
+  return url;
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty)
+{
+  const Map map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find("a") == map.end());
+  BOOST_CHECK(map.lowerBound("") == map.end());
+  BOOST_CHECK_THROW(map.valueOf("a"), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeysThatArePrefixesOfEachOther_WhenAdding_ThenTheyAreKeptInOrder)
+{
+  Map map = { { "abc", 3 }, { "a", 1 }, { "abcd", 4 }, { "", 0 }, { "ab", 2 }, { "b", 5 } };
+  map[std::string("ab\0", 3)] = 6;
+  map["\xff"] = 7;
+
+  thenMapContainsItems(map, { { "", 0 }, { "a", 1 }, { "ab", 2 }, { std::string("ab\0", 3), 6 },
+                              { "abc", 3 }, { "abcd", 4 }, { "b", 5 }, { "\xff", 7 } });
+  BOOST_CHECK(map.find("abcde") == map.end());
+  BOOST_CHECK(map.find("abd") == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyChildrenOfOneNode_WhenAddingAndRemoving_ThenNodesGrowAndShrink)
+{
+  Map map;
+  std::map<std::string, int> expected;
+  for (int b = 255; b >= 0; --b)
+  {
+    const std::string key = std::string("metric.") + static_cast<char>(b) + "x";
+    map[key] = b;
+    expected[key] = b;
+  }
+  thenMapContainsItems(map, expected);
+
+  for (int b = 0; b < 256; b += 2)
+  {
+    const std::string key = std::string("metric.") + static_cast<char>(b) + "x";
+    map.remove(key);
+    expected.erase(key);
+    if (b % 32 == 0)
+      thenMapContainsItems(map, expected);
+  }
+  thenMapContainsItems(map, expected);
+
+  for (int b = 1; b < 256; b += 2)
+    map.remove(std::string("metric.") + static_cast<char>(b) + "x");
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenRandomUrls_WhenMixingOperations_ThenMapMatchesStdMap)
+{
+  Map map;
+  std::map<std::string, int> expected;
+  std::mt19937 gen(11);
+  for (int i = 0; i < 20000; ++i)
+  {
+    const std::string key = randomUrl(gen);
+    if (i % 3 == 2)
+    {
+      if (expected.erase(key))
+        map.remove(key);
+      else
+        BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+    }
+    else
+    {
+      map[key] = i;
+      expected[key] = i;
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenScanningRanges_ThenKeysBetweenBoundsAreVisited)
+{
+  Map map;
+  std::map<std::string, int> expected;
+  std::mt19937 gen(5);
+  for (int i = 0; i < 2000; ++i)
+  {
+    const std::string key = randomUrl(gen);
+    map[key] = i;
+    expected[key] = i;
+  }
+
+  for (int i = 0; i < 200; ++i)
+  {
+    std::string lo = randomUrl(gen);
+    std::string hi = randomUrl(gen);
+    if (hi < lo)
+      std::swap(lo, hi);
+
+    const auto bound = expected.lower_bound(lo);
+    const auto it = map.lowerBound(lo);
+    BOOST_REQUIRE_EQUAL(it == map.end(), bound == expected.end());
+    if (it != map.end())
+      BOOST_CHECK_EQUAL(it->first, bound->first);
+
+    std::vector<std::string> visited;
+    map.forEachInRange(lo, hi, [&visited](const Map::value_type& item) { visited.push_back(item.first); });
+    std::vector<std::string> inRange;
+    for (auto e = bound; e != expected.end() && e->first < hi; ++e)
+      inRange.push_back(e->first);
+    BOOST_CHECK(visited == inRange);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenCopyingAndMoving_ThenContentsFollow)
+{
+  Map map = { { "cpu.load", 1 }, { "cpu.user", 2 }, { "mem.free", 3 } };
+
+  Map copy(map);
+  copy["cpu.idle"] = 4;
+  Map moved(std::move(copy));
+  map = moved;
+
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK(map == moved);
+  thenMapContainsItems(map, { { "cpu.idle", 4 }, { "cpu.load", 1 }, { "cpu.user", 2 }, { "mem.free", 3 } });
+
+  auto it = map.end();
+  --it;
+  BOOST_CHECK_EQUAL(it->first, "mem.free");
+  map.remove(it);
+  it = map.begin();
+  it->second = 10;
+  BOOST_CHECK_EQUAL(map.valueOf("cpu.idle"), 10);
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK(map != moved);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
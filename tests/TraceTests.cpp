@@ -0,0 +1,132 @@
+#include <Trace.h>
+#include <HashMap.h>
+#include <TreeMap.h>
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+
+using aisdi::TraceReader;
+using aisdi::TraceRecord;
+using aisdi::TraceWriter;
+
+namespace
+{
+
+template <typename K, typename V>
+using TreeMap = aisdi::TreeMap<K, V>;
+
+template <typename K, typename V>
+using HashMap = aisdi::HashMap<K, V>;
+
+using TracedTypes = boost::mpl::list<aisdi::TracedMap<TreeMap<std::uint64_t, std::string>>,
+                                     aisdi::TracedMap<HashMap<std::uint64_t, std::string>>>;
+
+}
+
+BOOST_AUTO_TEST_SUITE(TraceTests)
+
+BOOST_AUTO_TEST_CASE(GivenRecords_WhenWrittenAndReadBack_ThenTheyAreTheSame)
+{
+  const std::vector<TraceRecord> records = {
+    {TraceRecord::Put, 42, 100, 5},
+    {TraceRecord::Get, ~std::uint64_t(0), 0, 5},
+    {TraceRecord::Scan, 7, 300, 1000000000000ull},
+    {TraceRecord::Remove, 0, 0, 1000000000001ull}
+  };
+  std::stringstream stream;
+  {
+    TraceWriter writer(stream);
+    for (const auto& r : records)
+      writer.write(r);
+    BOOST_CHECK_EQUAL(writer.getCount(), 4u);
+  }
+
+  const std::vector<TraceRecord> read = TraceReader(stream).readAll();
+
+  BOOST_REQUIRE_EQUAL(read.size(), records.size());
+  for (std::size_t i = 0; i < read.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(read[i].operation, records[i].operation);
+    BOOST_CHECK_EQUAL(read[i].key, records[i].key);
+    BOOST_CHECK_EQUAL(read[i].size, records[i].size);
+    BOOST_CHECK_EQUAL(read[i].time, records[i].time);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyRecords_WhenWritten_ThenEachTakesFewBytes)
+{
+  std::ostringstream stream;
+  {
+    TraceWriter writer(stream);
+    for (std::uint64_t i = 0; i < 100000; ++i)
+      writer.write(TraceRecord{TraceRecord::Get, i * 7919, 64, i * 300});
+  }
+
+  BOOST_CHECK_LE(stream.str().size(), 5 + 100000 * 12u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenBadInput_WhenReading_ThenExceptionIsThrown)
+{
+  std::istringstream notATrace("AISR\x01");
+  BOOST_CHECK_THROW(TraceReader reader(notATrace), std::runtime_error);
+
+  std::stringstream stream;
+  {
+    TraceWriter writer(stream);
+    writer.write(TraceRecord{TraceRecord::Put, 1, 2, 3});
+  }
+  const std::string bytes = stream.str();
+
+  std::istringstream truncated(bytes.substr(0, bytes.size() - 1));
+  TraceReader truncatedReader(truncated);
+  BOOST_CHECK_THROW(truncatedReader.readAll(), std::runtime_error);
+
+  std::istringstream badOperation(bytes.substr(0, 5) + "\x09" + bytes.substr(6));
+  TraceReader badReader(badOperation);
+  BOOST_CHECK_THROW(badReader.readAll(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTracedMap_WhenUsed_ThenOperationsAreRecordedInOrder,
+                              Map, TracedTypes)
+{
+  std::stringstream stream;
+  {
+    TraceWriter writer(stream);
+    Map map(writer);
+    map.put(1, "one");
+    map.put(2, std::string(200, 'x'));
+    BOOST_CHECK_EQUAL(map.valueOf(1), "one");
+    BOOST_CHECK(map.find(3) == map.base().end());
+    BOOST_CHECK_THROW(map.valueOf(3), std::out_of_range);
+    std::size_t visited = 0;
+    map.scan(1, 10, [&visited](const std::uint64_t&, const std::string&) { visited++; });
+    map.remove(1);
+    BOOST_CHECK_EQUAL(map.getSize(), 1u);
+    BOOST_CHECK_GE(visited, 1u);
+  }
+
+  const std::vector<TraceRecord> read = TraceReader(stream).readAll();
+
+  const std::vector<TraceRecord::Operation> operations = {TraceRecord::Put, TraceRecord::Put, TraceRecord::Get,
+                                                          TraceRecord::Get, TraceRecord::Get, TraceRecord::Scan,
+                                                          TraceRecord::Remove};
+  const std::vector<std::uint64_t> keys = {1, 2, 1, 3, 3, 1, 1};
+  const std::vector<std::uint64_t> sizes = {3, 200, 3, 0, 0, 10, 0};
+  BOOST_REQUIRE_EQUAL(read.size(), operations.size());
+  for (std::size_t i = 0; i < read.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(read[i].operation, operations[i]);
+    BOOST_CHECK_EQUAL(read[i].key, keys[i]);
+    BOOST_CHECK_EQUAL(read[i].size, sizes[i]);
+    if (i > 0)
+      BOOST_CHECK_GE(read[i].time, read[i - 1].time);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
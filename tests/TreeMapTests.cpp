@@ -1,7 +1,13 @@
 #include <TreeMap.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <map>
 
 #include <boost/test/unit_test.hpp>
@@ -128,6 +134,7 @@ template <typename K>
 using Map = aisdi::TreeMap<K, std::string>;
 
 using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t, OperationCountingObject>;
+using IntegralKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
 using std::begin;
 using std::end;
 
@@ -575,6 +582,28 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenAssigningToOther_ThenAllEleme
   thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLargeMap_WhenCopying_ThenShapeAndItemsArePreserved,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 7919) % 1000] = std::to_string(i);
+  for (int i = 1000; i < 3000; ++i)
+    map[i] = std::to_string(i);
+
+  const Map<K> copied{map};
+  Map<K> assigned = { { 42, "Alice" } };
+  assigned = map;
+
+  BOOST_CHECK(copied == map);
+  BOOST_CHECK(assigned == map);
+  BOOST_CHECK_EQUAL(copied.getSize(), 3000);
+  BOOST_CHECK_EQUAL(copied.getRoot()->data.first, map.getRoot()->data.first);
+  BOOST_CHECK_EQUAL(assigned.getRoot()->data.first, map.getRoot()->data.first);
+  BOOST_CHECK(copied.getRoot() != map.getRoot());
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSelfAssigning_ThenNothingHappens,
                               K,
                               TestedKeyTypes)
@@ -786,6 +815,863 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapAfterRemovals_WhenIteratingBothWays_ThenItemsAreInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 200; ++i)
+  {
+    const int key = (i * 37) % 200;
+    map[key] = std::to_string(i);
+    expected[key] = std::to_string(i);
+  }
+  for (int key = 0; key < 200; key += 3)
+  {
+    map.remove(key);
+    expected.erase(key);
+  }
+  Map<K> copied{map};
+
+  auto expectedIt = expected.begin();
+  for (auto it = copied.begin(); it != copied.end(); ++it, ++expectedIt)
+  {
+    BOOST_REQUIRE(expectedIt != expected.end());
+    BOOST_CHECK_EQUAL(it->first, expectedIt->first);
+  }
+  auto expectedRit = expected.rbegin();
+  for (auto it = map.end(); it != map.begin(); ++expectedRit)
+  {
+    --it;
+    BOOST_CHECK_EQUAL(it->first, expectedRit->first);
+  }
+  BOOST_CHECK(expectedRit == expected.rend());
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+}
+
+template <typename K>
+void thenKeysAreInRange(const Map<K>& map, int from, int to)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), to - from);
+  int expectedKey = from;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expectedKey);
+    ++expectedKey;
+  }
+  BOOST_CHECK_EQUAL(expectedKey, to);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSplittingAtKey_ThenGreaterOrEqualKeysAreMovedOut,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[(i * 31) % 100] = std::to_string(i);
+
+  Map<K> upper = map.split(40);
+
+  thenKeysAreInRange(map, 0, 40);
+  thenKeysAreInRange(upper, 40, 100);
+  BOOST_CHECK(map.find(40) == map.end());
+  BOOST_CHECK(upper.find(39) == upper.end());
+  BOOST_CHECK_EQUAL(upper.valueOf(40), "40");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSplittingOutsideKeyRange_ThenOnePartIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+
+  Map<K> all = map.split(5);
+  Map<K> none = all.split(31);
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(none.isEmpty());
+  thenMapContainsItems(all, { { 10, "a" }, { 20, "b" }, { 30, "c" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenSplitMap_WhenSizeIsReadFromThreadsAndThenChanged_ThenItStaysExact)
+{
+  Map<int> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  Map<int> upper = map.split(600);
+  const Map<int>& shared = upper;
+
+  std::vector<std::size_t> sizes(4);
+  std::vector<std::thread> readers;
+  for (std::size_t t = 0; t < sizes.size(); ++t)
+    readers.emplace_back([&shared, &sizes, t]() { sizes[t] = shared.getSize(); });
+  for (auto& r : readers)
+    r.join();
+
+  for (std::size_t size : sizes)
+    BOOST_CHECK_EQUAL(size, 400u);
+  upper[1000] = "1000";
+  upper.remove(600);
+  map.remove(0);
+  BOOST_CHECK_EQUAL(upper.getSize(), 400u);
+  BOOST_CHECK_EQUAL(map.getSize(), 599u);
+  BOOST_CHECK_EQUAL(Map<int>::join(std::move(map), std::move(upper)).getSize(), 999u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenSplittingAndJoining_ThenSizeIsUnknownUntilCounted)
+{
+  Map<int> map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+  BOOST_CHECK(map.isSizeKnown());
+
+  Map<int> empty = map.split(200);
+  BOOST_CHECK(map.isSizeKnown());
+  BOOST_CHECK(empty.isSizeKnown());
+
+  Map<int> upper = map.split(30);
+  BOOST_CHECK(!map.isSizeKnown());
+  BOOST_CHECK(!upper.isSizeKnown());
+  BOOST_CHECK_EQUAL(upper.getSize(), 70u);
+  BOOST_CHECK(upper.isSizeKnown());
+
+  Map<int> joined = Map<int>::join(std::move(map), std::move(upper));
+  BOOST_CHECK(!joined.isSizeKnown());
+  BOOST_CHECK_EQUAL(joined.getSize(), 100u);
+
+  Map<int> lower = joined.split(50);
+  BOOST_CHECK_EQUAL(lower.getSize(), 50u);
+  BOOST_CHECK_EQUAL(joined.getSize(), 50u);
+  BOOST_CHECK(Map<int>::join(std::move(joined), std::move(lower)).isSizeKnown());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoDisjointMaps_WhenJoining_ThenAllItemsAreInResult,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[(i * 31) % 100] = std::to_string(i);
+  Map<K> upper = map.split(55);
+
+  Map<K> joined = Map<K>::join(std::move(map), std::move(upper));
+  joined[100] = "100";
+
+  thenKeysAreInRange(joined, 0, 101);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(upper.isEmpty());
+  BOOST_CHECK_EQUAL((--joined.end())->first, 100);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenOverlappingMaps_WhenJoining_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "a" }, { 30, "c" } };
+  Map<K> other = { { 20, "b" } };
+
+  BOOST_CHECK_THROW(Map<K>::join(std::move(map), std::move(other)), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSumAggregate_WhenMapIsUpdated_ThenRangeAggregatesFollow)
+{
+  aisdi::TreeMap<int, long, std::less<int>, aisdi::SumAggregate<long>> map;
+  std::map<int, long> expected;
+  for (int i = 0; i < 300; ++i)
+  {
+    const int key = (i * 37) % 300;
+    map[key] = key * 2;
+    expected[key] = key * 2;
+  }
+  for (int key = 0; key < 300; key += 7)
+  {
+    map.remove(key);
+    expected.erase(key);
+  }
+  map.valueOf(10) = 1000;
+  expected[10] = 1000;
+  map.find(11)->second += 5;
+  expected[11] += 5;
+
+  for (int lo = -5; lo < 310; lo += 23)
+    for (int hi = lo; hi < 320; hi += 41)
+    {
+      long sum = 0;
+      for (auto it = expected.lower_bound(lo); it != expected.end() && it->first < hi; ++it)
+        sum += it->second;
+      BOOST_CHECK_EQUAL(map.aggregate(lo, hi), sum);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(GivenSumAggregate_WhenValuesChangeBetweenQueries_ThenAssignAndUpdateKeepItExact)
+{
+  aisdi::TreeMap<int, long, std::less<int>, aisdi::SumAggregate<long>> map;
+  for (int key = 0; key < 5; ++key)
+    map[key] = key;
+  BOOST_CHECK_EQUAL(map.aggregate(0, 10), 10);
+
+  map.update(4, [](long& v) { v = 100; });
+  BOOST_CHECK_EQUAL(map.aggregate(0, 10), 106);
+  map.assign(2, 20);
+  map.assign(7, 1);
+  BOOST_CHECK_EQUAL(map.aggregate(0, 10), 125);
+  BOOST_CHECK_EQUAL(map.aggregate(3, 10), 104);
+  BOOST_CHECK_THROW(map.update(5, [](long& v) { v = 1; }), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMinAndMaxAggregates_WhenQueryingRanges_ThenExtremesAreReturned)
+{
+  aisdi::TreeMap<int, int, std::less<int>, aisdi::MinAggregate<int>> minMap;
+  aisdi::TreeMap<int, int, std::less<int>, aisdi::MaxAggregate<int>> maxMap;
+  for (int key = 0; key < 100; ++key)
+  {
+    minMap[key] = (key * 53) % 101;
+    maxMap[key] = (key * 53) % 101;
+  }
+
+  int expectedMin = 1000, expectedMax = -1;
+  for (int key = 20; key < 60; ++key)
+  {
+    expectedMin = std::min(expectedMin, (key * 53) % 101);
+    expectedMax = std::max(expectedMax, (key * 53) % 101);
+  }
+  BOOST_CHECK_EQUAL(minMap.aggregate(20, 60), expectedMin);
+  BOOST_CHECK_EQUAL(maxMap.aggregate(20, 60), expectedMax);
+  BOOST_CHECK_EQUAL(minMap.aggregate(200, 300), std::numeric_limits<int>::max());
+}
+
+BOOST_AUTO_TEST_CASE(GivenNonCommutativeAggregate_WhenSplittingAndJoining_ThenKeyOrderIsKept)
+{
+  using ConcatMap = aisdi::TreeMap<int, std::string, std::less<int>, aisdi::SumAggregate<std::string>>;
+  ConcatMap map;
+  const std::string letters = "abcdefghijklmnopqrstuvwxyz";
+  for (int i = 0; i < 26; ++i)
+    map[(i * 7) % 26] = letters.substr((i * 7) % 26, 1);
+  const ConcatMap copied{map};
+
+  ConcatMap upper = map.split(13);
+  BOOST_CHECK_EQUAL(map.aggregate(), "abcdefghijklm");
+  BOOST_CHECK_EQUAL(upper.aggregate(3, 20), "nopqrst");
+
+  ConcatMap joined = ConcatMap::join(std::move(map), std::move(upper));
+  BOOST_CHECK_EQUAL(joined.aggregate(), letters);
+  BOOST_CHECK_EQUAL(joined.aggregate(5, 9), "fghi");
+  BOOST_CHECK_EQUAL(copied.aggregate(0, 26), letters);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndHint_WhenAppendingIncreasingKeys_ThenItemsAreInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  for (int i = 0; i < 5000; ++i)
+    map.emplaceHint(map.end(), i, std::to_string(i));
+
+  thenKeysAreInRange(map, 0, 5000);
+  BOOST_CHECK_EQUAL(map.valueOf(4999), "4999");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenAnyHint_WhenInsertingItems_ThenTheyLandInTheirPlace,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  auto hint = map.begin();
+  for (int i = 0; i < 400; ++i)
+  {
+    const int key = (i * 97) % 400;
+    hint = map.insert(hint, { key, std::to_string(i) });
+    expected.insert({ key, std::to_string(i) });
+    BOOST_CHECK_EQUAL(hint->first, key);
+    if (i % 3 == 0)
+      hint = map.begin();
+  }
+
+  thenMapContainsItems(map, expected);
+  thenKeysAreInRange(map, 0, 400);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenExistingKey_WhenInsertingWithHint_ThenValueIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+
+  auto it = map.insert(map.find(30), { 20, "x" });
+  auto other = map.emplaceHint(map.end(), 10, "y");
+
+  BOOST_CHECK_EQUAL(it->second, "b");
+  BOOST_CHECK_EQUAL(other->second, "a");
+  thenMapContainsItems(map, { { 10, "a" }, { 20, "b" }, { 30, "c" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenAggregate_WhenInsertingWithHints_ThenAggregateIsUpdated)
+{
+  aisdi::TreeMap<int, long, std::less<int>, aisdi::SumAggregate<long>> map;
+  for (int i = 0; i < 100; ++i)
+    map.emplaceHint(map.end(), i * 2, i);
+  map.emplaceHint(map.begin(), 51, 1000);
+
+  BOOST_CHECK_EQUAL(map.aggregate(), 4950 + 1000);
+  BOOST_CHECK_EQUAL(map.aggregate(50, 54), 25 + 1000 + 26);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSplayMap_WhenKeyIsAccessed_ThenItBecomesRoot)
+{
+  aisdi::TreeMap<int, std::string, std::less<int>, aisdi::NoAggregate, aisdi::SplayAccess> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  BOOST_CHECK_EQUAL(map.getRoot()->data.first, 999);
+
+  BOOST_CHECK_EQUAL(map.find(3)->second, "3");
+  BOOST_CHECK_EQUAL(map.getRoot()->data.first, 3);
+  BOOST_CHECK_EQUAL(map.valueOf(700), "700");
+  BOOST_CHECK_EQUAL(map.getRoot()->data.first, 700);
+
+  const auto& constMap = map;
+  BOOST_CHECK_EQUAL(constMap.find(5)->second, "5");
+  BOOST_CHECK_EQUAL(map.getRoot()->data.first, 700);
+
+  int expected = 0;
+  for (auto it = constMap.begin(); it != constMap.end(); ++it, ++expected)
+    BOOST_CHECK_EQUAL(it->first, expected);
+  BOOST_CHECK_EQUAL(expected, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSplayMap_WhenMixingOperations_ThenItMatchesStdMap)
+{
+  aisdi::TreeMap<int, long, std::less<int>, aisdi::SumAggregate<long>, aisdi::SplayAccess> map;
+  std::map<int, long> expected;
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> keys(0, 299);
+  for (int i = 0; i < 5000; ++i)
+  {
+    const int key = keys(gen);
+    if (i % 4 == 3 && expected.count(key))
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+    else if (i % 4 == 2)
+    {
+      map.emplaceHint(map.begin(), key, i);
+      expected.insert({ key, i });
+    }
+    else
+    {
+      map[key] += i;
+      expected[key] += i;
+    }
+    if (i % 500 == 0)
+    {
+      long sum = 0;
+      for (const auto& item : expected)
+        if (item.first >= 100 && item.first < 200)
+          sum += item.second;
+      BOOST_CHECK_EQUAL(map.aggregate(100, 200), sum);
+    }
+  }
+
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    ++it;
+  }
+  long total = 0;
+  for (const auto& item : expected)
+    total += item.second;
+  BOOST_CHECK_EQUAL(map.aggregate(), total);
+}
+
+BOOST_AUTO_TEST_CASE(GivenReversedComparator_WhenUsingMap_ThenKeysAreDescending)
+{
+  using ReversedMap = aisdi::TreeMap<int, std::string, std::greater<int>>;
+  ReversedMap map = { { 1, "a" }, { 5, "e" }, { 3, "c" }, { 4, "d" }, { 2, "b" } };
+
+  std::string values;
+  for (const auto& item : map)
+    values += item.second;
+  BOOST_CHECK_EQUAL(values, "edcba");
+  BOOST_CHECK_EQUAL(map.valueOf(3), "c");
+  BOOST_CHECK(map.find(6) == map.end());
+
+  ReversedMap lower = map.split(3);
+  BOOST_CHECK_EQUAL(map.getSize(), 2u);
+  BOOST_CHECK_EQUAL(lower.begin()->first, 3);
+  ReversedMap joined = ReversedMap::join(std::move(map), std::move(lower));
+  BOOST_CHECK_EQUAL(joined.getSize(), 5u);
+  BOOST_CHECK_EQUAL(joined.begin()->first, 5);
+}
+
+namespace
+{
+
+// Keys carry the first bytes of the string packed into an integer, so most
+// comparisons are settled without touching the string itself.
+struct PrefixedKey
+{
+  std::uint64_t prefix;
+  std::string text;
+
+  PrefixedKey(const std::string& s)
+  : prefix(0), text(s)
+  {
+    for (std::size_t i = 0; i < sizeof(prefix); ++i)
+      prefix = (prefix << 8) | (i < s.size() ? static_cast<unsigned char>(s[i]) : 0);
+  }
+};
+
+struct PrefixCompare
+{
+  static int calls;
+
+  int compare(const PrefixedKey& a, const PrefixedKey& b) const
+  {
+    ++calls;
+    if (a.prefix != b.prefix)
+      return a.prefix < b.prefix ? -1 : 1;
+    return a.text.compare(b.text);
+  }
+
+  bool operator()(const PrefixedKey& a, const PrefixedKey& b) const
+  {
+    return compare(a, b) < 0;
+  }
+};
+
+int PrefixCompare::calls = 0;
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(GivenThreeWayComparator_WhenSearching_ThenOneComparisonPerLevelIsMade)
+{
+  aisdi::TreeMap<PrefixedKey, int, PrefixCompare> map;
+  map[std::string("mmmmmmmm-a")] = 1;
+  map[std::string("ffffffff")] = 2;
+  map[std::string("mmmmmmmm-b")] = 3;
+  map[std::string("mmmmmmmm-c")] = 4;
+
+  PrefixCompare::calls = 0;
+  BOOST_CHECK_EQUAL(map.valueOf(std::string("mmmmmmmm-c")), 4);
+  BOOST_CHECK_EQUAL(PrefixCompare::calls, 3);
+
+  PrefixCompare::calls = 0;
+  BOOST_CHECK(map.find(std::string("zz")) == map.end());
+  BOOST_CHECK_EQUAL(PrefixCompare::calls, 3);
+
+  PrefixCompare::calls = 0;
+  map[std::string("ffffffff")] = 5;
+  BOOST_CHECK_EQUAL(PrefixCompare::calls, 2);
+  BOOST_CHECK_EQUAL(map.begin()->second, 5);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenWrittenAsSortedRunAndReadBack_ThenItIsEqual,
+                              K,
+                              IntegralKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 3000; ++i)
+    map[(i * 7919) % 100003] = std::to_string(i);
+  std::stringstream stream;
+
+  map.writeSortedRun(stream, 256);
+  const Map<K> loaded = Map<K>::readSortedRun(stream);
+
+  BOOST_CHECK(loaded == map);
+  BOOST_CHECK(std::is_sorted(loaded.begin(), loaded.end(),
+                             [](const typename Map<K>::value_type& a, const typename Map<K>::value_type& b)
+                             { return a.first < b.first; }));
+  BOOST_CHECK_LT(stream.str().size(), 3000u * 7);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSignedAndDescendingKeys_WhenRoundTripped_ThenKeysAreKept)
+{
+  aisdi::TreeMap<std::int64_t, double, std::greater<std::int64_t>> map;
+  map[std::numeric_limits<std::int64_t>::min()] = 1.5;
+  map[std::numeric_limits<std::int64_t>::max()] = 2.5;
+  map[-1] = 3.5;
+  map[0] = 4.5;
+  std::stringstream stream;
+
+  map.writeSortedRun(stream, 1);
+  auto loaded = decltype(map)::readSortedRun(stream);
+
+  BOOST_CHECK(loaded == map);
+  BOOST_CHECK_EQUAL(loaded.begin()->first, std::numeric_limits<std::int64_t>::max());
+  BOOST_CHECK_EQUAL(loaded.valueOf(-1), 3.5);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSortedRun_WhenReadingKeyRange_ThenOnlyKeysInRangeAreLoaded)
+{
+  aisdi::TreeMap<std::uint32_t, std::string> map;
+  for (std::uint32_t i = 0; i < 10000; ++i)
+    map[i * 3] = std::string(i % 5, 'x');
+  std::stringstream stream;
+  map.writeSortedRun(stream, 512);
+
+  auto part = aisdi::TreeMap<std::uint32_t, std::string>::readSortedRun(stream, 1000, 2000);
+  BOOST_CHECK_EQUAL(part.getSize(), 333u);
+  BOOST_CHECK_EQUAL(part.begin()->first, 1002u);
+  BOOST_CHECK_EQUAL((--part.end())->first, 1998u);
+
+  auto none = aisdi::TreeMap<std::uint32_t, std::string>::readSortedRun(stream, 40000, 50000);
+  BOOST_CHECK(none.isEmpty());
+  auto head = aisdi::TreeMap<std::uint32_t, std::string>::readSortedRun(stream, 0, 4);
+  BOOST_CHECK_EQUAL(head.getSize(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRunAmongOtherData_WhenReadingKeyRange_ThenOffsetsCountFromTheRun)
+{
+  aisdi::TreeMap<std::uint32_t, std::string> map;
+  for (std::uint32_t i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  std::stringstream stream;
+  stream << "prefix";
+  map.writeSortedRun(stream, 64);
+  stream << "and some data after the run";
+
+  stream.seekg(6);
+  auto part = aisdi::TreeMap<std::uint32_t, std::string>::readSortedRun(stream, 100, 200);
+  BOOST_CHECK_EQUAL(part.getSize(), 100u);
+  BOOST_CHECK_EQUAL(part.begin()->first, 100u);
+  BOOST_CHECK_EQUAL(part.valueOf(199), "199");
+
+  stream.clear();
+  stream.seekg(6);
+  const auto all = aisdi::TreeMap<std::uint32_t, std::string>::readSortedRun(stream);
+  BOOST_CHECK(all == map);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyOrDamagedRun_WhenReading_ThenResultIsEmptyOrExceptionIsThrown)
+{
+  using IntMap = aisdi::TreeMap<int, std::string>;
+  IntMap empty;
+  std::stringstream stream;
+  empty.writeSortedRun(stream);
+  BOOST_CHECK(IntMap::readSortedRun(stream).isEmpty());
+
+  IntMap map = { { 1, "a" }, { 2, "b" } };
+  std::stringstream full;
+  map.writeSortedRun(full);
+  std::stringstream truncated(full.str().substr(0, 12));
+  BOOST_CHECK_THROW(IntMap::readSortedRun(truncated), std::runtime_error);
+  std::stringstream garbage("not a sorted run");
+  BOOST_CHECK_THROW(IntMap::readSortedRun(garbage), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenScanningInParallel_ThenEveryEntryIsVisitedOnce)
+{
+  aisdi::TreeMap<int, int> map;
+  long long expectedSum = 0;
+  for (int i = 0; i < 20000; ++i)
+  {
+    const int key = (i * 7919) % 20011;
+    map[key] = key % 10;
+    expectedSum += key;
+  }
+
+  for (unsigned threads : { 1u, 3u, 8u })
+  {
+    std::atomic<long long> sum(0);
+    std::atomic<int> count(0);
+    map.parallelForEach([&sum, &count](const std::pair<const int, int>& item)
+    {
+      sum += item.first;
+      ++count;
+    }, threads);
+    BOOST_CHECK_EQUAL(sum.load(), expectedSum);
+    BOOST_CHECK_EQUAL(count.load(), 20000);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenNonCommutativeCombine_WhenReducingInParallel_ThenKeyOrderIsKept)
+{
+  aisdi::TreeMap<int, int> balanced;
+  aisdi::TreeMap<int, int> degenerate;
+  std::string expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    balanced[(i * 1103) % 3001] = 0;
+    degenerate[i] = 0;
+  }
+  for (const auto& item : balanced)
+    expected += std::to_string(item.first) + ",";
+  const auto keyText = [](const std::pair<const int, int>& item) { return std::to_string(item.first) + ","; };
+  const auto concat = [](const std::string& a, const std::string& b) { return a + b; };
+
+  BOOST_CHECK_EQUAL(balanced.parallelReduce(std::string(">"), keyText, concat, 4), ">" + expected);
+  BOOST_CHECK_EQUAL(degenerate.parallelReduce(0L, [](const std::pair<const int, int>& item) { return long(item.first); },
+                                              std::plus<long>(), 4), 2999L * 3000 / 2);
+  const aisdi::TreeMap<int, int> empty;
+  BOOST_CHECK_EQUAL(empty.parallelReduce(std::string("e"), keyText, concat), "e");
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingFunction_WhenScanningInParallel_ThenExceptionIsRethrown)
+{
+  aisdi::TreeMap<int, int> map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 17) % 1000] = i;
+
+  BOOST_CHECK_THROW(map.parallelForEach([](const std::pair<const int, int>& item)
+  {
+    if (item.first == 500)
+      throw std::out_of_range("stop");
+  }, 4), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTwoMaps_WhenCombining_ThenResultsMatchSetAlgebraOnStdMaps)
+{
+  aisdi::TreeMap<int, int> left;
+  aisdi::TreeMap<int, int> right;
+  std::map<int, int> l;
+  std::map<int, int> r;
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> key(0, 999);
+  for (int i = 0; i < 600; ++i)
+  {
+    const int a = key(gen);
+    const int b = key(gen);
+    left[a] = l[a] = i;
+    right[b] = r[b] = -i;
+  }
+  std::map<int, int> sum;
+  std::map<int, int> common;
+  std::map<int, int> onlyLeft;
+  std::map<int, int> onlyOne;
+  for (const auto& item : l)
+  {
+    const auto other = r.find(item.first);
+    if (other == r.end())
+    {
+      sum[item.first] = onlyLeft[item.first] = onlyOne[item.first] = item.second;
+    }
+    else
+    {
+      sum[item.first] = item.second + other->second;
+      common[item.first] = item.second;
+    }
+  }
+  for (const auto& item : r)
+    if (l.count(item.first) == 0)
+      sum[item.first] = onlyOne[item.first] = item.second;
+  const auto add = [](int a, int b) { return a + b; };
+
+  const auto united = left.unionWith(right, add);
+  const auto intersected = left.intersectWith(right);
+  const auto difference = left.difference(right);
+  const auto symmetric = left.symmetricDiff(right);
+
+  const auto toTree = [](const std::map<int, int>& items)
+  {
+    aisdi::TreeMap<int, int> tree;
+    for (const auto& item : items)
+      tree[item.first] = item.second;
+    return tree;
+  };
+  BOOST_CHECK(united == toTree(sum));
+  BOOST_CHECK(intersected == toTree(common));
+  BOOST_CHECK(difference == toTree(onlyLeft));
+  BOOST_CHECK(symmetric == toTree(onlyOne));
+  BOOST_CHECK_EQUAL(symmetric.getSize(), onlyOne.size());
+  BOOST_CHECK(left.unionWith(left) == left);
+  BOOST_CHECK(left.intersectWith(aisdi::TreeMap<int, int>()).isEmpty());
+  BOOST_CHECK(left.difference(left).isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenOverlappingKeys_WhenIntersecting_ThenResolverPicksValue)
+{
+  const aisdi::TreeMap<std::string, int> prices = { { "apple", 3 }, { "kiwi", 7 }, { "pear", 5 } };
+  const aisdi::TreeMap<std::string, int> offers = { { "kiwi", 6 }, { "pear", 9 }, { "plum", 1 } };
+
+  const auto cheapest = prices.intersectWith(offers, [](int a, int b) { return std::min(a, b); });
+  const auto merged = prices.unionWith(offers);
+
+  const aisdi::TreeMap<std::string, int> expectedCheapest = { { "kiwi", 6 }, { "pear", 5 } };
+  const aisdi::TreeMap<std::string, int> expectedMerged = { { "apple", 3 }, { "kiwi", 7 }, { "pear", 5 }, { "plum", 1 } };
+  BOOST_CHECK(cheapest == expectedCheapest);
+  BOOST_CHECK(merged == expectedMerged);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapsOfDifferentShapes_WhenComparing_ThenOnlyContentsMatter)
+{
+  aisdi::TreeMap<int, int> degenerate;
+  aisdi::TreeMap<int, int> shuffled;
+  for (int i = 0; i < 2000; ++i)
+  {
+    degenerate[i] = i;
+    shuffled[(i * 1103) % 2000] = (i * 1103) % 2000;
+  }
+
+  BOOST_CHECK(degenerate == shuffled);
+  shuffled[1999] = 0;
+  BOOST_CHECK(degenerate != shuffled);
+  shuffled.remove(1999);
+  BOOST_CHECK(degenerate != shuffled);
+  BOOST_CHECK(shuffled != degenerate);
+}
+
+using ScapegoatMap = aisdi::TreeMap<int, int, std::less<int>, aisdi::NoAggregate, aisdi::ScapegoatAccess>;
+
+std::size_t treeHeight(const ScapegoatMap& map)
+{
+  using NodePtr = decltype(map.getRoot());
+  std::function<std::size_t(NodePtr)> height = [&height](NodePtr n) -> std::size_t
+  {
+    return n == nullptr ? 0 : 1 + std::max(height(n->left), height(n->right));
+  };
+  return height(map.getRoot());
+}
+
+BOOST_AUTO_TEST_CASE(GivenScapegoatMap_WhenInsertingInOrder_ThenTreeStaysShallow)
+{
+  ScapegoatMap map;
+  for (int i = 0; i < 10000; ++i)
+    map[i] = i;
+  for (int i = 20000; i > 10000; --i)
+    map.emplaceHint(map.begin(), i, i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 20000u);
+  // log1.5(20000) is about 24.4
+  BOOST_CHECK_LE(treeHeight(map), 26u);
+  int expected = 0;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expected);
+    expected = (expected == 9999 ? 10001 : expected + 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenScapegoatMap_WhenRemovingAndReinserting_ThenMapMatchesStdMap)
+{
+  ScapegoatMap map;
+  std::map<int, int> expected;
+  std::mt19937 gen(21);
+  std::uniform_int_distribution<int> key(0, 2000);
+  for (int i = 0; i < 30000; ++i)
+  {
+    const int k = key(gen);
+    if (i % 2)
+    {
+      if (expected.erase(k))
+        map.remove(k);
+      else
+        BOOST_CHECK_THROW(map.remove(k), std::out_of_range);
+    }
+    else if (i % 4 == 0)
+    {
+      map[k] = i;
+      expected[k] = i;
+    }
+    else
+    {
+      const auto it = map.emplaceHint(map.end(), k, i);
+      BOOST_CHECK_EQUAL(it->second, expected.emplace(k, i).first->second);
+    }
+  }
+
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  BOOST_CHECK(std::equal(expected.begin(), expected.end(), map.begin(),
+                         [](const std::pair<const int, int>& a, const std::pair<const int, int>& b)
+                         { return a == b; }));
+  auto it = map.end();
+  for (auto e = expected.rbegin(); e != expected.rend(); ++e)
+    BOOST_CHECK_EQUAL((--it)->first, e->first);
+  for (int k = 0; k <= 2000; ++k)
+    BOOST_CHECK_EQUAL(map.find(k) != map.end(), expected.count(k) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenScapegoatMapWithTombstones_WhenCopyingSplittingAndClearing_ThenOnlyEntriesRemain)
+{
+  ScapegoatMap map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 7) % 1000] = i;
+  for (int i = 0; i < 1000; i += 3)
+    map.remove(i);
+
+  const ScapegoatMap copy(map);
+  auto upper = map.split(500);
+  BOOST_CHECK_EQUAL(map.getSize() + upper.getSize(), 666u);
+  BOOST_CHECK_EQUAL(upper.begin()->first, 500);
+  auto joined = ScapegoatMap::join(std::move(map), std::move(upper));
+  BOOST_CHECK(joined == copy);
+
+  for (int i = 0; i < 1000; ++i)
+    if (i % 3)
+      joined.remove(i);
+  BOOST_CHECK(joined.isEmpty());
+  BOOST_CHECK(joined.getRoot() == nullptr);
+  auto it = joined.end();
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  joined[5] = 5;
+  BOOST_CHECK_EQUAL(joined.getSize(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRunOfTombstones_WhenReinsertingDescending_ThenEachKeyLandsInPlace)
+{
+  // Every key revived or attached next to the run of tombstones once
+  // searched for its live predecessor across all of them.
+  const int n = 40000;
+  ScapegoatMap map;
+  for (int i = 0; i < 2 * n; ++i)
+    map[i] = i;
+  for (int i = n; i < 2 * n; ++i)
+    map.remove(i);
+  for (int i = 2 * n - 1; i >= n; i -= 2)
+    map[i] = -i;
+  for (int i = 2 * n - 2; i >= n; i -= 2)
+    map.emplaceHint(map.find(i + 1), i, -i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), static_cast<std::size_t>(2 * n));
+  int expected = 0;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.first, expected);
+    BOOST_CHECK_EQUAL(item.second, expected < n ? expected : -expected);
+    ++expected;
+  }
+  BOOST_CHECK_EQUAL(expected, 2 * n);
+  BOOST_CHECK_EQUAL((--map.end())->first, 2 * n - 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenScapegoatMap_WhenPoppingFromBothEnds_ThenEndsSkipNoTombstones)
+{
+  // Without the live ends kept apart, begin() and --end() walked over every
+  // tombstone left by the previous pops.
+  const int n = 40000;
+  ScapegoatMap map;
+  for (int i = 0; i < n; ++i)
+    map[i] = i;
+
+  for (int i = 0; i < n / 4; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(map.begin()->first, i);
+    map.remove(map.begin());
+    BOOST_REQUIRE_EQUAL((--map.end())->first, n - 1 - i);
+    map.remove(--map.end());
+  }
+  map[0] = 0;
+  map[n - 1] = n - 1;
+
+  BOOST_CHECK_EQUAL(map.getSize(), static_cast<std::size_t>(n / 2 + 2));
+  BOOST_CHECK_EQUAL(map.begin()->first, 0);
+  BOOST_CHECK_EQUAL((++map.begin())->first, n / 4);
+  BOOST_CHECK_EQUAL((--map.end())->first, n - 1);
+  BOOST_CHECK_EQUAL((--(--map.end()))->first, n - 1 - n / 4);
+  BOOST_CHECK_THROW(--map.begin(), std::out_of_range);
+  for (int i = 0; i < n; ++i)
+    if (map.find(i) != map.end())
+      map.remove(i);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 
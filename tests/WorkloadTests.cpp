@@ -0,0 +1,107 @@
+#include <Workload.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using aisdi::KeyDistribution;
+using aisdi::WorkloadGenerator;
+using Keys = std::vector<WorkloadGenerator::key_type>;
+
+BOOST_AUTO_TEST_SUITE(WorkloadTests)
+
+const std::vector<KeyDistribution> distributions = {
+  KeyDistribution::uniform(), KeyDistribution::zipfian(), KeyDistribution::sequential(),
+  KeyDistribution::normal(0.01), KeyDistribution::clustered(4)
+};
+
+BOOST_AUTO_TEST_CASE(GivenAnyDistribution_WhenGeneratingKeys_ThenTheyAreDistinctAndReproducible)
+{
+  for (const auto& d : distributions)
+  {
+    const Keys keys = WorkloadGenerator(7).keys(50000, d);
+
+    BOOST_CHECK_EQUAL(keys.size(), 50000u);
+    BOOST_CHECK_MESSAGE(std::set<std::uint64_t>(keys.begin(), keys.end()).size() == keys.size(),
+                        "Duplicate keys for " << d.name());
+    BOOST_CHECK(WorkloadGenerator(7).keys(50000, d) == keys);
+    if (d.kind != KeyDistribution::Sequential)
+      BOOST_CHECK(WorkloadGenerator(8).keys(50000, d) != keys);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeys_WhenDrawingAccesses_ThenOnlyExistingKeysAreHit)
+{
+  WorkloadGenerator gen(3);
+  const Keys keys = gen.keys(10000, KeyDistribution::uniform());
+  const std::set<std::uint64_t> existing(keys.begin(), keys.end());
+
+  for (const auto& d : distributions)
+    for (auto key : gen.accesses(keys, 20000, d))
+      BOOST_REQUIRE(existing.count(key) == 1);
+  for (auto key : gen.absentKeys(keys, 10000))
+    BOOST_REQUIRE(existing.count(key) == 0);
+  const Keys shuffled = gen.shuffled(keys);
+  BOOST_CHECK(shuffled != keys);
+  BOOST_CHECK(std::set<std::uint64_t>(shuffled.begin(), shuffled.end()) == existing);
+}
+
+BOOST_AUTO_TEST_CASE(GivenZipfianAccesses_WhenCounting_ThenFewKeysTakeMostOfThem)
+{
+  WorkloadGenerator gen(11);
+  const Keys keys = gen.keys(10000, KeyDistribution::uniform());
+  std::map<std::uint64_t, int> counts;
+  for (auto key : gen.accesses(keys, 100000, KeyDistribution::zipfian(1.2)))
+    counts[key]++;
+
+  std::vector<int> sorted;
+  for (const auto& c : counts)
+    sorted.push_back(c.second);
+  std::sort(sorted.rbegin(), sorted.rend());
+  int top = 0;
+  for (std::size_t i = 0; i < 100; ++i)
+    top += sorted[i];
+  BOOST_CHECK_GT(top, 60000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDistributionName_WhenParsing_ThenItRoundTrips)
+{
+  for (const auto& d : distributions)
+  {
+    const KeyDistribution parsed = KeyDistribution::parse(d.name());
+    BOOST_CHECK(parsed.kind == d.kind);
+    BOOST_CHECK_EQUAL(parsed.parameter, d.parameter);
+  }
+  BOOST_CHECK_EQUAL(KeyDistribution::parse("zipf").parameter, 0.99);
+  BOOST_CHECK_THROW(KeyDistribution::parse("gaussian"), std::invalid_argument);
+  BOOST_CHECK_THROW(KeyDistribution::parse("uniform:2"), std::invalid_argument);
+  BOOST_CHECK_THROW(KeyDistribution::parse("clustered:2.5"), std::invalid_argument);
+  BOOST_CHECK_THROW(KeyDistribution::parse("normal:x"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeys_WhenConvertingToStrings_ThenOrderAndLengthAreKept)
+{
+  WorkloadGenerator gen(5);
+  Keys keys = gen.keys(20000, KeyDistribution::uniform());
+  std::sort(keys.begin(), keys.end());
+
+  std::string previous;
+  for (auto key : keys)
+  {
+    const std::string s = WorkloadGenerator::stringKey(key, 24);
+    BOOST_REQUIRE_EQUAL(s.size(), 24u);
+    BOOST_REQUIRE_LT(previous, s);
+    previous = s;
+  }
+  BOOST_CHECK_EQUAL(WorkloadGenerator::stringKey(61, 11), "0000000000z");
+  BOOST_CHECK_EQUAL(WorkloadGenerator(5).stringKeys(3, 16, KeyDistribution::sequential())[2].substr(0, 11),
+                    "00000000002");
+  BOOST_CHECK_THROW(WorkloadGenerator::stringKey(1, 10), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()